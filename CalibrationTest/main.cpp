@@ -85,6 +85,7 @@ int main() {
 	double leadin = 5;
 	double leadout = 5;
 	PrintOptions printOpts(leadin);
+	ScanOptions scanOpts;
 
 	cv::Mat imSeg;
 
@@ -187,14 +188,16 @@ int main() {
 #ifdef DEBUG_SCANNING
 			makePath(raster, wayptSpc, 0, initPos, initVel, initExt, segments, path);
 			q_scanMsg.push(true);
-			t_CollectScans(raster);
+			scanOpts.recordFile = outDir + "scans.rlog";
+			t_CollectScans(raster, path, scanOpts);
 			return 0;
 #endif // DEBUG_SCANNING
 
 			// start scanning
 			printOpts.extrude = false;
 			printOpts.disposal = false;
-			t_scan = std::thread{ t_CollectScans, raster };
+			scanOpts.recordFile = outDir + "scans.rlog";
+			t_scan = std::thread{ t_CollectScans, raster, path, scanOpts };
 			t_control = std::thread{ t_noController, path };
 			t_print = std::thread{ t_printQueue, path[0][0], printOpts };
 			t_scan.join();
@@ -19,6 +19,7 @@ namespace fs = std::filesystem;
 #include "A3200.h"
 
 #include "constants.h"
+#include "resolution.h"
 #include "myTypes.h"
 #include "myGlobals.h"
 #include "scanning.h"
@@ -74,6 +75,7 @@ int main() {
 	// setting the print options
 	double leadin = 10;
 	PrintOptions printOpts(leadin);
+	ScanOptions scanOpts;
 	printOpts.extrude = true;
 	printOpts.disposal = false;
 	printOpts.asyncTheta = 32;
@@ -90,6 +92,11 @@ int main() {
 	std::cin >> lineNum;
 
 	TableInput input(infile, lineNum);
+	// Setting the resolution of the layer images before anything is made in [px]. Prints without a res column use the default
+	if (input.res != 0 && !resolution.set(input.res)) {
+		system("pause");
+		return 0;
+	}
 	// copy the table to the output folder
 	try { fs::copy(infile, outDir, fs::copy_options::overwrite_existing); }
 	catch (std::exception& e) { std::cout << e.what(); }
@@ -113,7 +120,8 @@ int main() {
 
 #ifdef DEBUG_SCANNING
 	q_scanMsg.push(true);
-	t_CollectScans(raster);
+	scanOpts.recordFile = outDir + "scans.rlog";
+	t_CollectScans(raster, path, scanOpts);
 	return 0;
 #endif // DEBUG_SCANNING
 
@@ -166,7 +174,8 @@ int main() {
 			path = scaffold.path;
 			ctrlPath = scaffold.path;
 
-			t_scan = std::thread{ t_CollectScans, raster };
+			scanOpts.recordFile = outDir + "scans.rlog";
+			t_scan = std::thread{ t_CollectScans, raster, path, scanOpts };
 			t_process = std::thread{ t_GetMatlErrors, raster, path };
 			t_print = std::thread{ t_printQueue, path[0][0], printOpts };
 			t_control = std::thread{ t_controller, std::ref(ctrlPath), std::ref(controller) };
@@ -184,7 +193,8 @@ int main() {
 			segments = scaffold.segmentsScan;
 			path = scaffold.pathScan;
 			ctrlPath = scaffold.pathScan;
-			t_scan = std::thread{ t_CollectScans, raster };
+			scanOpts.recordFile = outDir + "scans.rlog";
+			t_scan = std::thread{ t_CollectScans, raster, path, scanOpts };
 			t_print = std::thread{ t_printQueue, path[0][0], printOpts };
 			t_control = std::thread{ t_noController, ctrlPath };
 
@@ -19,6 +19,7 @@ namespace fs = std::filesystem;
 #include "A3200.h"
 
 #include "constants.h"
+#include "resolution.h"
 #include "myTypes.h"
 #include "myGlobals.h"
 #include "scanning.h"
@@ -32,6 +33,8 @@ namespace fs = std::filesystem;
 #include "controlCalib.h"
 #include "input.h"
 #include "multiLayer.h"
+#include "edgeStore.h"
+#include "errors.h"
 
 std::string datetime(std::string format = "%Y.%m.%d-%H.%M.%S");
 
@@ -79,6 +82,7 @@ int main() {
 	// setting the print options
 	double leadin = 10;
 	PrintOptions printOpts(leadin);
+	ScanOptions scanOpts;
 	printOpts.extrude = true;
 	printOpts.disposal = false;
 	double omegaMax = 100;
@@ -98,6 +102,11 @@ int main() {
 
 	// Reading the input parameters
 	TableInput input(infile, lineNum);
+	// Setting the resolution of the layer images before anything is made in [px]. Prints without a res column use the default
+	if (input.res != 0 && !resolution.set(input.res)) {
+		system("pause");
+		return 0;
+	}
 	// copy the table to the output folder
 	try { fs::copy(infile, outDir, fs::copy_options::overwrite_existing); }
 	catch (std::exception& e) { std::cout << e.what(); }
@@ -209,7 +218,8 @@ int main() {
 
 #ifdef DEBUG_SCANNING
 	q_scanMsg.push(true);
-	t_CollectScans(raster);
+	scanOpts.recordFile = outDir + "scans.rlog";
+	t_CollectScans(raster, path, scanOpts);
 	return 0;
 #endif // DEBUG_SCANNING
 
@@ -221,7 +231,8 @@ int main() {
 		outDir.append("print_");
 		ctrlPath = path;
 
-		t_scan = std::thread{ t_CollectScans, raster };
+		scanOpts.recordFile = outDir + "scans.rlog";
+		t_scan = std::thread{ t_CollectScans, raster, path, scanOpts };
 		t_process = std::thread{ t_GetMatlErrors, raster, path };
 		t_print = std::thread{ t_printQueue, path[0][0], printOpts };
 		t_control = std::thread{ t_controller, std::ref(ctrlPath), std::ref(controller), true };
@@ -235,7 +246,8 @@ int main() {
 		outDir.append("printNC_");
 		ctrlPath = path;
 
-		t_scan = std::thread{ t_CollectScans, raster };
+		scanOpts.recordFile = outDir + "scans.rlog";
+		t_scan = std::thread{ t_CollectScans, raster, path, scanOpts };
 		t_process = std::thread{ t_GetMatlErrors, raster, path };
 		t_print = std::thread{ t_printQueue, path[0][0], printOpts };
 		t_control = std::thread{ t_noController, ctrlPath };
@@ -281,7 +293,8 @@ int main() {
 			path = scaffold.path;
 			ctrlPath = scaffold.path;
 
-			t_scan = std::thread{ t_CollectScans, raster };
+			scanOpts.recordFile = outDir + "scans.rlog";
+			t_scan = std::thread{ t_CollectScans, raster, path, scanOpts };
 			t_process = std::thread{ t_GetMatlErrors, raster, path };
 			t_print = std::thread{ t_printQueue, path[0][0], printOpts };
 			t_control = std::thread{ t_controller, std::ref(ctrlPath), std::ref(controller), true };
@@ -299,7 +312,8 @@ int main() {
 			segments = scaffold.segmentsScan;
 			path = scaffold.pathScan;
 			ctrlPath = scaffold.pathScan;
-			t_scan = std::thread{ t_CollectScans, raster };
+			scanOpts.recordFile = outDir + "scans.rlog";
+			t_scan = std::thread{ t_CollectScans, raster, path, scanOpts };
 			t_print = std::thread{ t_printQueue, path[0][0], printOpts };
 			t_control = std::thread{ t_noController, ctrlPath };
 
@@ -315,12 +329,18 @@ int main() {
 
 			// Purge all existing edge messages
 			edgeMsg edgemsg;
-			while (!q_edgeMsg.empty()) { q_edgeMsg.wait_and_pop(edgemsg); }
-			cv::Mat edges = edgemsg.edges();
+			std::vector<cv::Point2f> edgePts;
+			while (!q_edgeMsg.empty()) { 
+				q_edgeMsg.wait_and_pop(edgemsg); 
+				edgePts.insert(edgePts.end(), edgemsg.edges().begin(), edgemsg.edges().end());
+			}
+			// Refile the edges under the new segments
+			EdgeStore edgeStore(segments, MATL_EDGE_MARGIN);
+			edgeStore.add(edgePts, segments.front().layer());
 			// Load the new edge messages
 			for (int i = 0; i < segments.size(); i++) 
 			{ 
-				edgemsg.addEdges(edges, i, (i == segments.size() - 1)); 
+				edgemsg.addEdges(edgeStore.points(i), i, (i == segments.size() - 1)); 
 				q_edgeMsg.push(edgemsg);
 			}
 
@@ -19,6 +19,7 @@ namespace fs = std::filesystem;
 #include "A3200.h"
 
 #include "constants.h"
+#include "resolution.h"
 #include "myTypes.h"
 #include "myGlobals.h"
 #include "scanning.h"
@@ -32,6 +33,8 @@ namespace fs = std::filesystem;
 #include "controlCalib.h"
 #include "input.h"
 #include "multiLayer.h"
+#include "edgeStore.h"
+#include "errors.h"
 
 std::string datetime(std::string format = "%Y.%m.%d-%H.%M.%S");
 
@@ -79,6 +82,11 @@ int main() {
 
 
 	TableInput input(infile, lineNum);
+	// Setting the resolution of the layer images before anything is made in [px]. Prints without a res column use the default
+	if (input.res != 0 && !resolution.set(input.res)) {
+		system("pause");
+		return 0;
+	}
 	// copy the table to the output folder
 	try { fs::copy(infile, outDir, fs::copy_options::overwrite_existing); }
 	catch (std::exception& e) { std::cout << e.what(); }
@@ -117,8 +125,8 @@ int main() {
 	cv::imwrite(outDir + "reference.png", refM);
 
 	// Making the images
-	int ptSize = MM2PIX(0.18);
-	int lnSize = ptSize;// MM2PIX(0.1);
+	int ptSize = resolution.toPix(0.18);
+	int lnSize = ptSize;// resolution.toPix(0.1);
 	cv::Mat ptKern = cv::Mat::ones(ptSize, ptSize, CV_8UC1);
 	cv::Mat wpMaskpx = cv::Mat::zeros(raster.size(), CV_8UC1);
 	cv::Mat wpMask = cv::Mat::zeros(raster.size(), CV_8UC1);
@@ -155,15 +163,19 @@ int main() {
 
 	//image = cv::Mat::zeros(raster.size(segments.back().layer()), CV_8UC3);
 	//raster.draw(image, image, segments.back().layer());
-	//raster.drawBdry(image, image, segments.back().layer(), cv::Scalar(255, 0, 0), MM2PIX(0.05));
-	//drawEdges(image, image, edges, cv::Scalar(0, 0, 255), MM2PIX(0.1));
+	//raster.drawBdry(image, image, segments.back().layer(), cv::Scalar(255, 0, 0), resolution.toPix(0.05));
+	//drawEdges(image, image, edges, cv::Scalar(0, 0, 255), resolution.toPix(0.1));
 	//cv::imwrite(outDir + "edges_" + ".png", image);
 
 	// draw the material
 	edgeMsg edgemsg;
+	std::vector<cv::Point> edgePts;
+	cv::findNonZero(edges, edgePts);
+	EdgeStore edgeStore(segments, MATL_EDGE_MARGIN);
+	edgeStore.add(edgePts, segments.front().layer());
 	for (int i = 0; i < segments.size(); i++)
 	{
-		edgemsg.addEdges(edges, i, (i == segments.size() - 1));
+		edgemsg.addEdges(edgeStore.points(i), i, (i == segments.size() - 1));
 		q_edgeMsg.push(edgemsg);
 	}
 
@@ -173,7 +185,7 @@ int main() {
 	// draw inner and outer edges
 	cv::Mat lredges = 255 * cv::Mat::ones(raster.size(), CV_8UC1);
 	cv::cvtColor(lredges, lredges, cv::COLOR_GRAY2BGR);
-	//int thick = MM2PIX(0.1);
+	//int thick = resolution.toPix(0.1);
 	//thick = ptSize;
 	raster.draw(lredges, lredges, 0, cv::Scalar(0, 0, 0), lnSize);
 
@@ -186,7 +198,7 @@ int main() {
 	wpcolor = cv::Scalar(0, 0, 0);
 
 	//// Make a mask for the waypoints
-	//cv::Mat ptKern = cv::Mat::ones(MM2PIX(0.1), MM2PIX(0.1), CV_8UC1);
+	//cv::Mat ptKern = cv::Mat::ones(resolution.toPix(0.1), resolution.toPix(0.1), CV_8UC1);
 	//cv::Mat wpMask = cv::Mat::zeros(raster.size(), CV_8UC1);
 	//for (auto it = segments.begin(); it != segments.end(); ++it) {
 	//	for (auto it2 = (*it).waypoints().begin(); it2 != (*it).waypoints().end(); ++it2) {
@@ -8,9 +8,6 @@
 #define TASK_PRINT TASKID_01
 #define AXES_ALL (AXISMASK)(AXISMASK_00 | AXISMASK_01 | AXISMASK_02 | AXISMASK_03)
 
-#define RESOLUTION 0.02/*0.05*/  // 1 pixel = RESOLUTION mm
-#define PIX2MM(pix)  (pix)*RESOLUTION
-#define MM2PIX(mm)  std::lround( (mm) / RESOLUTION)
 #define PI 3.14159265
 
 #define SCAN_OFFSET_X -15.21
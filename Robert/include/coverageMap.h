@@ -0,0 +1,54 @@
+#pragma once
+#include <opencv2/core.hpp>
+
+#ifndef COVERAGE_MAP_H
+#define COVERAGE_MAP_H
+
+///////////////////////////////////////  CoverageMap  ///////////////////////////////////////
+// Bitmap of the pixels of a layer that have been swept by valid scans. The area between consecutive scans is
+// filled in, so the fraction of a segment's ROI that has been seen by the scanner can be looked up at any time.
+class CoverageMap
+{
+public:
+	CoverageMap() : _maxGap(0), _prevT(0), _hasPrev(false) {}
+
+	/**
+	 * @param[in] size Size of the raster image of the layer
+	 * @param[in] maxGap Maximum distance in [px] between the ends of consecutive scans for the area between them to count as swept
+	*/
+	CoverageMap(cv::Size size, int maxGap)
+		: _map(cv::Mat::zeros(size, CV_8UC1)), _maxGap(maxGap), _prevT(0), _hasPrev(false) {}
+
+	/// @brief Clears the map for a new layer
+	void reset(cv::Size size);
+
+	/**
+	 * @brief Adds a valid scan to the map and fills in the area swept since the previous scan
+	 * @param[in] start, end Ends of the scan in the raster image as found by scan2ROI()
+	 * @param[in] T Angle of the scanner in [deg]
+	*/
+	void addScan(const cv::Point& start, const cv::Point& end, double T);
+
+	/// @brief Clears the swept pixels in the ROI, e.g. when the segment in it starts being printed
+	void clear(const cv::Rect& roi);
+
+	/// @brief Starts a new sweep, e.g. after a scan that was skipped or failed
+	void breakSweep() { _hasPrev = false; }
+
+	/**
+	 * @brief Fraction of the pixels in the ROI that have been swept. Only the part of the ROI inside the raster image is counted
+	 * @return Fraction in [0, 1], or 1 if the ROI does not overlap the raster image
+	*/
+	double fraction(const cv::Rect& roi) const;
+
+	const cv::Mat& map() const { return _map; }
+
+private:
+	cv::Mat _map;
+	int _maxGap;
+	cv::Point _prevStart, _prevEnd;
+	double _prevT;
+	bool _hasPrev;
+};
+
+#endif // COVERAGE_MAP_H
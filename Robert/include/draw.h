@@ -24,6 +24,11 @@ void addScale(cv::Mat& image, double length = 1, cv::Point offset = cv::Point(25
 
 void drawEdges(cv::Mat src, cv::Mat& dst, cv::Mat edges, const cv::Scalar& color, const int pointSz = 1);
 
+/**
+ * @brief Same as drawEdges() above, but the edges are given as points, e.g. from TiledImage::findNonZero()
+*/
+void drawEdges(cv::Mat src, cv::Mat& dst, const std::vector<cv::Point>& edgePts, const cv::Scalar& color, const int pointSz = 1);
+
 void drawErrors(cv::Mat src, cv::Mat& dst, std::vector<Segment>& seg, int layer = 0);
 
 void drawMaterial(cv::Mat src, cv::Mat& dst, std::vector<Segment>& seg, std::vector<std::vector<Path>> path, int layer = 0);
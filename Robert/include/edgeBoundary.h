@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <opencv2/core.hpp>
+
+#ifndef EDGE_BOUNDARY_H
+#define EDGE_BOUNDARY_H
+
+class Raster;
+
+///////////////////////////////////////  EdgeBoundary  ///////////////////////////////////////
+// Where the edges of a layer are searched for. Holds the dilated raster path both as a mask image and as the rectangles and round
+// caps of its lines, so the windows where a scan crosses the rods can be found analytically instead of walking the mask
+class EdgeBoundary
+{
+public:
+	EdgeBoundary() : _halfWidth(0), _binLength(1), _numPrior(0) {}
+
+	/**
+	 * @brief Boundary around the raster path of a layer, the same as Raster::boundaryMask()
+	 * @param[in] raster Raster of the print
+	 * @param[in] layer Layer of the print
+	*/
+	EdgeBoundary(const Raster& raster, int layer);
+
+	/**
+	 * @brief Boundary given only by a mask. The windows are found by walking the mask
+	 * @param[in] mask Mask indicating where to search for the edges
+	*/
+	explicit EdgeBoundary(const cv::Mat& mask) : _mask(mask), _halfWidth(0), _binLength(1), _numPrior(0) {}
+
+	/// @brief Mask indicating where to search for the edges
+	const cv::Mat& mask() const { return _mask; }
+
+	/// @brief TRUE if the windows are found from the geometry of the rods
+	bool analytic() const { return !_rods.empty(); }
+
+	/**
+	 * @brief Narrows the window of each rod to the edges measured on an earlier layer with the same path, i.e. layer - 2.
+	 * Each rod is split into bins about one rod width long, and the window of a bin spans the median of the earlier edges on
+	 * each side of the rod. Bins without earlier edges on both sides, and the ends of the rods, keep the full window.
+	 * The mask is narrowed the same way. Only works on a boundary made from a raster
+	 * @param[in] priorEdges Edge points of the earlier layer in [px]
+	 * @param[in] margin Distance in [px] the windows reach past the earlier edges
+	 * @return Number of bins that were narrowed
+	*/
+	int setPrior(const std::vector<cv::Point2f>& priorEdges, int margin);
+
+	/// @brief TRUE if any of the windows have been narrowed by setPrior()
+	bool hasPrior() const { return _numPrior > 0; }
+
+	/**
+	 * @brief Finds the windows where a scan crosses the boundary. Windows that the scan starts or ends in are dropped
+	 * @param[in] scanStart Pixel coordinates of the start of the scan
+	 * @param[in] scanEnd Pixel coordinates of the end of the scan
+	 * @param[out] windowPts Index of the first point inside and the first point after each window, in the order of a
+	 * cv::LineIterator from scanStart to scanEnd with 8-connectivity
+	*/
+	void windows(cv::Point scanStart, cv::Point scanEnd, std::vector<int>& windowPts) const;
+
+private:
+	struct Rod {
+		cv::Rect2d body; // pixel centers covered across the line of the raster path drawn with the rod width
+		bool horizontal; // TRUE if the line runs along x
+		double start; // coordinate along the line where the first bin starts
+		std::vector<cv::Vec2f> bins; // narrowed [low, high] coordinates across the line of each bin. Empty bins have low > high
+	};
+
+	void _maskWindows(cv::Point scanStart, cv::Point scanEnd, std::vector<int>& windowPts) const;
+
+	cv::Mat _mask;
+	std::vector<Rod> _rods; // lines of the raster path
+	std::vector<cv::Point> _corners; // ends of the lines of the raster path, where the lines are drawn with round caps
+	double _halfWidth; // half of the rod width in [px]
+	int _binLength; // length in [px] of the bins along the rods that setPrior() narrows
+	int _numPrior; // number of narrowed bins
+};
+
+#endif // !EDGE_BOUNDARY_H
@@ -0,0 +1,153 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <opencv2/core.hpp>
+#include "myTypes.h"
+#include "scanning.h"
+#include "edgeBoundary.h"
+#include "profile1D.h"
+
+#ifndef EDGE_DETECTOR_H
+#define EDGE_DETECTOR_H
+
+// Abstract base edge detector class. Finds the material edges in a single scan
+class EdgeDetector
+{
+public:
+	EdgeDetector() : _filter(profileFilter::NONE), _filterRadius(5), _numFiltered(0) {}
+	virtual ~EdgeDetector() {}
+
+	/**
+	 * @brief Finds the material edges in a single scan
+	 * @param[in] edgeBoundary Where to search for the edges. Typically it is a dialated raster path
+	 * @param[in] scanStart Pixel coordinates of the start of the scan
+	 * @param[in] scanEnd Pixel coordinates of the end of the scan
+	 * @param[in] scanROI Profile from the scanner that is within the print ROI
+	 * @param[out] edgePts Coordinates of the edges found on the scan in the pixel coordinates of edgeBoundary
+	*/
+	virtual void find(const EdgeBoundary& edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, std::vector<cv::Point2f>& edgePts) = 0;
+
+	// one of edgeMethod::method
+	virtual int method() const = 0;
+	const char* name() const { return edgeMethod::name(method()); }
+
+	/**
+	 * @brief Sets the filter applied to each scan ROI before the edges are searched for
+	 * @param[in] filter One of profileFilter::filter
+	 * @param[in] radius Half width of the filter window in [px]
+	*/
+	void setPrefilter(int filter, int radius = 5) {
+		if (filter < profileFilter::NONE || filter > profileFilter::HAMPEL) {
+			std::cout << "Unknown profile filter " << filter << ". Using " << profileFilter::name(profileFilter::NONE) << "." << std::endl;
+			filter = profileFilter::NONE;
+		}
+		_filter = filter;
+		_filterRadius = (radius < 1) ? 1 : radius;
+	}
+	int prefilter() const { return _filter; }
+
+	// number of samples replaced by the Hampel prefilter since the detector was made
+	long long numFiltered() const { return _numFiltered; }
+
+protected:
+	/**
+	 * @brief Applies the prefilter to a scan ROI
+	 * @return The filtered profile, or scanROI itself if there is no prefilter. Valid until the next call
+	*/
+	cv::Mat& _prefilter(cv::Mat& scanROI) {
+		int n = (int)scanROI.total();
+
+		if (_filter == profileFilter::NONE || n == 0 || !scanROI.isContinuous()) { return scanROI; }
+		// the buffer is only reallocated when the depth changes or a longer ROI comes in, so filtering does not allocate per scan
+		if (_buf.cols < n || _buf.type() != scanROI.type()) { _buf.create(1, std::max(n, NUM_DATA_SAMPLES), scanROI.type()); }
+		_filtered = _buf.colRange(0, n);
+		_ws.reserve(n);
+
+		if (scanROI.depth() == CV_32F) {
+			if (_filter == profileFilter::MEDIAN) { medianFilter1D(scanROI.ptr<float>(), _filtered.ptr<float>(), n, _filterRadius, _ws); }
+			else { _numFiltered += hampel1D(scanROI.ptr<float>(), _filtered.ptr<float>(), n, _filterRadius, 3, _ws); }
+		}
+		else {
+			if (_filter == profileFilter::MEDIAN) { medianFilter1D(scanROI.ptr<double>(), _filtered.ptr<double>(), n, _filterRadius, _ws); }
+			else { _numFiltered += hampel1D(scanROI.ptr<double>(), _filtered.ptr<double>(), n, _filterRadius, 3, _ws); }
+		}
+		return _filtered;
+	}
+
+private:
+	int _filter; // one of profileFilter::filter
+	int _filterRadius; // half width of the filter window in [px]
+	long long _numFiltered;
+	cv::Mat _buf, _filtered;
+	ProfileWorkspace _ws;
+};
+
+// Recursive Otsu thresholding of the profile
+class OtsuEdgeDetector : public EdgeDetector
+{
+public:
+	OtsuEdgeDetector() {}
+
+	void find(const EdgeBoundary& edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, std::vector<cv::Point2f>& edgePts)
+	{
+		findEdges2(edgeBoundary.mask(), scanStart, scanEnd, _prefilter(scanROI), edgePts);
+	}
+
+	int method() const { return edgeMethod::OTSU; }
+};
+
+// Extrema of the derivative of the profile within the windows where the scan crosses the edge boundary. The windows are found
+// from the rod geometry of the boundary when it has one, so the mask is not walked
+class DerivativeEdgeDetector : public EdgeDetector
+{
+public:
+	DerivativeEdgeDetector()
+		: _order(1), _heightThresh(0.1) {}
+	DerivativeEdgeDetector(int order, double heightThresh = 0.1)
+		: _order(order), _heightThresh(heightThresh) {}
+
+	void find(const EdgeBoundary& edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, std::vector<cv::Point2f>& edgePts)
+	{
+		findEdges(edgeBoundary, scanStart, scanEnd, _prefilter(scanROI), edgePts, _heightThresh, _order);
+	}
+
+	int method() const { return (_order == 2) ? edgeMethod::DERIVATIVE2 : edgeMethod::DERIVATIVE; }
+
+private:
+	int _order; // order of the derivative, 1 or 2
+	double _heightThresh; // edges where the profile is below this height in [mm] are ignored
+};
+
+/**
+ * @brief Makes the edge detector for a method. Unknown methods fall back to edgeMethod::OTSU
+ * @param[in] method One of edgeMethod::method
+ * @param[in] prefilter Filter applied to each scan ROI before the edges are searched for, one of profileFilter::filter
+ * @param[in] prefilterRadius Half width of the prefilter window in [px]
+*/
+inline std::unique_ptr<EdgeDetector> makeEdgeDetector(int method, int prefilter = profileFilter::NONE, int prefilterRadius = 5)
+{
+	std::unique_ptr<EdgeDetector> detector;
+
+	switch (method)
+	{
+	case edgeMethod::OTSU:
+		detector = std::make_unique<OtsuEdgeDetector>();
+		break;
+	case edgeMethod::DERIVATIVE:
+		detector = std::make_unique<DerivativeEdgeDetector>(1);
+		break;
+	case edgeMethod::DERIVATIVE2:
+		detector = std::make_unique<DerivativeEdgeDetector>(2);
+		break;
+	default:
+		std::cout << "Unknown edge detector " << method << ". Using " << edgeMethod::name(edgeMethod::OTSU) << "." << std::endl;
+		detector = std::make_unique<OtsuEdgeDetector>();
+		break;
+	}
+	detector->setPrefilter(prefilter, prefilterRadius);
+	return detector;
+}
+
+#endif // !EDGE_DETECTOR_H
@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <opencv2/core.hpp>
+#include "myTypes.h"
+#include "tiledImage.h"
+#include "segmentIndex.h"
+
+#ifndef EDGE_STORE_H
+#define EDGE_STORE_H
+
+///////////////////////////////////////  EdgeStore  ///////////////////////////////////////
+// Sparse store of the edge points found by the scanner. Each point is filed into the bucket of every segment whose ROI
+// (grown by a margin) contains it. The segments are found through an R-tree over the segment ROIs of each layer
+// (see SegmentIndex), so adding a point visits O(log n) nodes whatever the size and spacing of the ROIs.
+class EdgeStore
+{
+public:
+	EdgeStore() : _margin(0), _firstLayer(0) {}
+
+	/**
+	 * @param[in] segments Segments of the print. Their ROIs are in the pixel coordinates of the raster image of their layer
+	 * @param[in] margin Distance in [px] the ROIs are grown by, so points just outside a ROI are also available to the segment
+	*/
+	EdgeStore(const std::vector<Segment>& segments, int margin);
+
+	/**
+	 * @brief Adds edge points found in a layer
+	 * @param[in] pts Sub-pixel points in the pixel coordinates of the raster image of the layer. A point belongs to the pixel it rounds to
+	*/
+	void add(const std::vector<cv::Point2f>& pts, int layer);
+	void add(const std::vector<cv::Point>& pts, int layer);
+
+	/**
+	 * @brief Edge points of a segment with one point per pixel, sorted by the row then column of the pixel (the order of cv::findNonZero).
+	 * The points of several scans that round to the same pixel are merged into their mean
+	*/
+	const std::vector<cv::Point2f>& points(int segNum);
+
+	/// @brief Every edge point added to a layer, including the points that are not near a segment. May contain duplicates
+	const std::vector<cv::Point2f>& layerPoints(int layer) const;
+
+	/// @brief Marks the pixels of the edge points of a layer on an 8 bit image
+	void draw(TiledImage& image, int layer) const;
+
+private:
+	int _margin;
+	int _firstLayer;
+	std::vector<std::vector<cv::Point2f>> _buckets; // edge points of each segment as they were added
+	std::vector<std::vector<cv::Point2f>> _merged; // edge points of each segment merged into one per pixel
+	std::vector<bool> _sorted; // true if the merged points are up to date with the bucket
+	std::vector<SegmentIndex> _indexes; // index of the grown ROIs of each layer starting from _firstLayer
+	std::vector<std::vector<int>> _layerSegs; // segment number of each id of the layer's index
+	std::vector<std::vector<cv::Point2f>> _layerPts; // every point of each layer starting from _firstLayer
+};
+
+#endif // EDGE_STORE_H
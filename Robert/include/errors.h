@@ -1,10 +1,14 @@
 #pragma once
 #include <vector>
 #include <opencv2/core.hpp>
+#include "constants.h"
+#include "resolution.h"
 
 #ifndef ERRORS_H
 #define ERRORS_H
 
+#define MATL_EDGE_MARGIN resolution.toPix(0.25) // size in [px] of the mask around the smoothed edges that keeps the raw edge points
+
 /**
  * @brief Finds the left and right edges of the material and smooths them
  * @param[in] segmentROI Rectangle specifying the region of the image to search for the edges
@@ -13,7 +17,18 @@
  * @param[out] lEdgePts Filtered points that make up the edge in the left half of the ROI
  * @param[out] rEdgePts Filtered points that make up the edge in the right half of the ROI
 */
-void getMatlEdges(const cv::Rect& segmentROI, const int dir, const cv::Mat& gblEdges, std::vector<cv::Point>& lEdgePts, std::vector<cv::Point>& rEdgePts);
+void getMatlEdges(const cv::Rect& segmentROI, const int dir, const cv::Mat& gblEdges, std::vector<cv::Point2f>& lEdgePts, std::vector<cv::Point2f>& rEdgePts);
+
+/**
+ * @brief Finds the left and right edges of the material from the edge points of the segment and smooths them
+ * @param[in] segmentROI Rectangle specifying the region of the image to search for the edges
+ * @param[in] dir Direction of the segment
+ * @param[in] edgePts Sub-pixel edge points within MATL_EDGE_MARGIN of the ROI, without duplicates and sorted by row then column
+ * like the output of cv::findNonZero or EdgeStore::points()
+ * @param[out] lEdgePts Filtered points that make up the edge in the left half of the ROI
+ * @param[out] rEdgePts Filtered points that make up the edge in the right half of the ROI
+*/
+void getMatlEdges(const cv::Rect& segmentROI, const int dir, const std::vector<cv::Point2f>& edgePts, std::vector<cv::Point2f>& lEdgePts, std::vector<cv::Point2f>& rEdgePts);
 
 /**
  * @brief Calculates the material centerline and width errors.
@@ -40,4 +55,19 @@ void getMatlErrors(std::vector<cv::Point>& centerline, double width, cv::Size ra
 */
 void getErrorsAt(std::vector<cv::Point>& waypoints, std::vector<double>targetWidths, const int dir, cv::Size rasterSize, const std::vector<cv::Point>& lEdgePts, const std::vector<cv::Point>& rEdgePts, std::vector<double>& errCL, std::vector<double>& errWD);
 
+/**
+ * @brief Calculates the material centerline and width errors at the input waypoints from sub-pixel edges.
+ * The distances to the edges are measured to the edge polylines directly instead of with a distance transform
+ * of the raster image, so they are not rounded to whole pixels. Only the lines of the edges near each waypoint are measured,
+ * found through an index over runs of the lines (see SegmentIndex)
+ * @param[in] waypoints Vector of waypoints in pixel coordinates where the errors should be calculated
+ * @param[in] targetWidths Vecor of desired width of the material in mm
+ * @param[in] direction of the segment
+ * @param[in] lEdgePts Sub-pixel points making up the left edge of the rod
+ * @param[in] rEdgePts Sub-pixel points making up the right edge of the rod
+ * @param[out] errCL Material centerline error in mm
+ * @param[out] errWD Material width error in mm
+*/
+void getErrorsAt(const std::vector<cv::Point>& waypoints, std::vector<double>targetWidths, const int dir, const std::vector<cv::Point2f>& lEdgePts, const std::vector<cv::Point2f>& rEdgePts, std::vector<double>& errCL, std::vector<double>& errWD);
+
 #endif // !ERRORS_H
\ No newline at end of file
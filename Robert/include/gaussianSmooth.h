@@ -6,7 +6,9 @@
 #define GAUSSIAN_SMOOTH_H
 
 void gaussianSmoothX(const std::vector<cv::Point>& unfiltPts, std::vector<cv::Point>& filtPts, int kSize, double sig);
+void gaussianSmoothX(const std::vector<cv::Point2f>& unfiltPts, std::vector<cv::Point2f>& filtPts, int kSize, double sig);
 
 void gaussianSmoothY(const std::vector<cv::Point>& unfiltPts, std::vector<cv::Point>& filtPts, int kSize, double sig);
+void gaussianSmoothY(const std::vector<cv::Point2f>& unfiltPts, std::vector<cv::Point2f>& filtPts, int kSize, double sig);
 
 #endif // GAUSSIAN_SMOOTH_H
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <limits>
+#include <opencv2/core.hpp>
+#include "tiledImage.h"
+
+#ifndef HEIGHT_MAP_H
+#define HEIGHT_MAP_H
+
+///////////////////////////////////////  HeightMap  ///////////////////////////////////////
+// Heights of a layer in the pixel coordinates of its raster image, built up from the resampled profiles of the scans.
+// The map is a CV_32F TiledImage whose tiles are only allocated once a scan crosses them, so it costs memory in
+// proportion to the scanned area and adding a scan costs time in proportion to its length.
+class HeightMap
+{
+public:
+	HeightMap() : _map(cv::Size(0, 0), CV_32F, cv::Scalar(std::numeric_limits<float>::quiet_NaN())) {}
+
+	/**
+	 * @param[in] size Size of the raster image of the layer
+	 * @param[in] tileSize Width and height of the tiles in [px]
+	*/
+	HeightMap(cv::Size size, int tileSize = 64);
+
+	/// @brief Clears the map for a new layer
+	void reset(cv::Size size);
+
+	/**
+	 * @brief Writes the heights of a scan into the map, replacing the heights of earlier scans at the same pixels
+	 * @param[in] start, end Ends of the scan in the raster image as found by scan2ROI()
+	 * @param[in] heights Height in [mm] at each point of a cv::LineIterator from start to end, i.e. the scanROI output by scan2ROI()
+	*/
+	void addScan(const cv::Point& start, const cv::Point& end, const std::vector<float>& heights);
+	void addScan(const cv::Point& start, const cv::Point& end, const cv::Mat& scanROI);
+
+	/// @brief Height in [mm] at a pixel. NaN if the pixel has not been scanned or is outside the map
+	float at(const cv::Point& pt) const;
+
+	/**
+	 * @brief Copies the heights in a region to a dense CV_32F image. Pixels that have not been scanned are NaN
+	 * @param[in] roi Region of the map. The parts outside the map are NaN
+	*/
+	void copyTo(const cv::Rect& roi, cv::Mat& dst) const;
+
+	/**
+	 * @brief Heights along a line, e.g. the cross section of a rod
+	 * @param[out] heights Height at each point of a cv::LineIterator from start to end. NaN where not scanned
+	*/
+	void profile(const cv::Point& start, const cv::Point& end, std::vector<float>& heights) const;
+
+	cv::Size size() const { return _map.size(); }
+
+	/// @brief Number of tiles that have been allocated
+	int numTiles() const { return _map.numTiles(); }
+
+	/// @brief Memory used by the allocated tiles in [bytes]
+	size_t bytes() const { return _map.bytes(); }
+
+private:
+	TiledImage _map; // NaN where not scanned
+};
+
+#endif // !HEIGHT_MAP_H
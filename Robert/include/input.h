@@ -17,6 +17,7 @@ public:
 
 	int printNum, layers, startLayer;
 	double length, width, height, rodSpc, wayptSpc, F, E;
+	double res; // size of the pixels of the layer images in [mm]. 0 if the table does not set it
 	double range[2];
 	char type, method;
 	cv::Point3d initPos;
@@ -27,11 +28,12 @@ private:
 };
 
 TableInput::TableInput()
-	: printNum(0), layers(0), length(0), width(0), height(0), rodSpc(0), wayptSpc(0), startLayer(0), F(0), E(0), range{ 0, 0 }, type(0), method(0) {}
+	: printNum(0), layers(0), length(0), width(0), height(0), rodSpc(0), wayptSpc(0), startLayer(0), F(0), E(0), res(0), range{ 0, 0 }, type(0), method(0) {}
 
 inline TableInput::TableInput(std::string filename, int printNumber)
 {
 	printNum = printNumber;
+	res = 0;
 	_readTable(filename);
 }
 
@@ -74,6 +76,7 @@ inline void TableInput::_readTable(std::string filename)
 						else if (str.compare("rodspc") == 0) { rodSpc = std::stod(value); }
 						else if (str.compare("wptspc") == 0) { wayptSpc = std::stod(value); }
 						else if (str.compare("layer0") == 0) { startLayer = std::stoi(value); }
+						else if (str.compare("res") == 0) { res = std::stod(value); }
 							
 						// Functionally generated scaffold parameters
 						else if (str.compare("type") == 0) { type = value[0]; }
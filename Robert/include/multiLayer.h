@@ -2,6 +2,7 @@
 #include <vector>
 #include "myTypes.h"
 #include "raster.h"
+#include "resolution.h"
 #include <opencv2/core.hpp>
 #include "MaterialModel.h"
 #include "input.h"
@@ -107,7 +108,7 @@ inline void MultiLayerScaffold::_interpPathPoints(std::vector<cv::Point2i> inPts
 	for (auto it = inPts.begin(); it != std::prev(inPts.end(), 1); ++it) {
 		diff = *std::next(it, 1) - *it;
 		L = cv::norm(diff);
-		delta = (diff / L) * (double)MM2PIX(wayptSpc);
+		delta = (diff / L) * (double)resolution.toPix(wayptSpc);
 		for (int i = 0; cv::norm(i * delta) < L; i++) {
 			outPts.push_back(*it + cv::Point2i(i * delta));
 		}
@@ -120,7 +121,7 @@ inline void MultiLayerScaffold::_makePath(TableInput input, Raster _raster, doub
 	std::vector<cv::Point2i> wp_px;
 	std::vector<cv::Point2d> wp_mm;
 	cv::Point2d scanDonePt;
-	int pixRodWth = MM2PIX(_raster.rodWidth());
+	int pixRodWth = resolution.toPix(_raster.rodWidth());
 	int direction = 1;
 	cv::Point2d origin = _raster.origin();
 	std::vector<Path> tmp;
@@ -171,7 +172,7 @@ inline void MultiLayerScaffold::_makePath(TableInput input, Raster _raster, doub
 
 			// making the path
 			wp_mm.resize(wp_px.size());
-			std::transform(wp_px.begin(), wp_px.end(), wp_mm.begin(), [&origin](cv::Point& pt) {return (PIX2MM(cv::Point2d(pt)) + origin); });
+			std::transform(wp_px.begin(), wp_px.end(), wp_mm.begin(), [&origin](cv::Point& pt) {return (resolution.toMM(cv::Point2d(pt)) + origin); });
 			for (auto it2 = wp_mm.begin(); it2 != wp_mm.end(); ++it2) 
 			{
 				//if ((std::distance(wp_mm.begin(), it2) > 0) || (std::distance(_raster.px(layer).begin(), it) % 2 == 0)){
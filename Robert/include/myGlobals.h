@@ -9,6 +9,7 @@
 #include <opencv2/core.hpp>
 #include "threadsafeQueue.h"
 #include "extrusion.h"
+#include "positionService.h"
 
 #ifndef MY_GLOBALS_H
 #define MY_GLOBALS_H
@@ -26,6 +27,9 @@ extern threadsafe_queue<pathMsg> q_pathMsg;
 
 extern std::string outDir;
 
+extern ScanStats scanStats;
+extern PositionService positionService;
+
 extern std::mutex mut_cmd;
 
 #endif // MY_GLOBALS_H
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <string>
 #include <cmath>
 #include <algorithm>
+#include <atomic>
 #include <opencv2/core.hpp>
 
 #ifndef MY_TYPES_H
@@ -79,6 +80,11 @@ public:
 		_lEdgePts = lEdgePts;
 		_rEdgePts = rEdgePts;
 	}
+	// sub-pixel edges are rounded to the nearest pixel for drawing
+	void addEdges(const std::vector<cv::Point2f>& lEdgePts, const std::vector<cv::Point2f>& rEdgePts) {
+		_lEdgePts.assign(lEdgePts.begin(), lEdgePts.end());
+		_rEdgePts.assign(rEdgePts.begin(), rEdgePts.end());
+	}
 	void addErrors(std::vector<double> errCL, std::vector<double> errWD) {
 		_errCL = errCL;
 		_errWD = errWD;
@@ -112,7 +118,7 @@ private:
 ///////////////////////////////////////  edgeMsg  ///////////////////////////////////////
 class edgeMsg {
 private:
-	cv::Mat _edges;
+	std::vector<cv::Point2f> _edges; // sub-pixel edge points of the segment in the pixel coordinates of the raster image
 	int _segmentNum;
 	bool _doneScanning;
 public:
@@ -120,13 +126,13 @@ public:
 		_segmentNum = 0;
 		_doneScanning = false;
 	}
-	void addEdges(cv::Mat edges, int segmentNum, bool doneScanning) {
+	void addEdges(const std::vector<cv::Point2f>& edges, int segmentNum, bool doneScanning) {
 		_edges = edges;
 		_segmentNum = segmentNum;
 		_doneScanning = doneScanning;
 	}
 	// Get values
-	const cv::Mat& edges() const { return _edges; }
+	const std::vector<cv::Point2f>& edges() const { return _edges; }
 	const int& segmentNum() const { return _segmentNum; }
 	const bool& doneScanning() const { return _doneScanning; }
 };
@@ -195,6 +201,103 @@ inline PrintOptions::PrintOptions()
 inline PrintOptions::PrintOptions(double _leadin, double _leadout, bool _extrude, bool _disposal, double _asyncTheta)
 	: leadin(_leadin), leadout(_leadout), extrude(_extrude), disposal(_disposal), asyncTheta(_asyncTheta) {}
 
+///////////////////////////////////////  EdgeMethod  ///////////////////////////////////////
+class edgeMethod
+{
+public:
+	edgeMethod() {}
+
+	enum method : int
+	{
+		OTSU = 0, // recursive Otsu thresholding of the profile, findEdges2()
+		DERIVATIVE = 1, // extrema of the first derivative of the profile in the edge boundary, findEdges() with order 1
+		DERIVATIVE2 = 2, // maxima of the second derivative of the profile in the edge boundary, findEdges() with order 2
+	};
+
+	static const char* name(int method) {
+		switch (method) {
+		case OTSU: return "otsu";
+		case DERIVATIVE: return "derivative";
+		case DERIVATIVE2: return "derivative2";
+		default: return "unknown";
+		}
+	}
+
+private:
+};
+
+///////////////////////////////////////  ProfileFilter  ///////////////////////////////////////
+class profileFilter
+{
+public:
+	profileFilter() {}
+
+	enum filter : int
+	{
+		NONE = 0, // the profile goes straight to the edge detector
+		MEDIAN = 1, // sliding median of the profile, medianFilter1D()
+		HAMPEL = 2, // samples far from the sliding median are replaced by it, hampel1D()
+	};
+
+	static const char* name(int filter) {
+		switch (filter) {
+		case NONE: return "none";
+		case MEDIAN: return "median";
+		case HAMPEL: return "hampel";
+		default: return "unknown";
+		}
+	}
+
+private:
+};
+
+///////////////////////////////////////  ScanOptions  ///////////////////////////////////////
+class ScanOptions
+{
+public:
+	std::string recordFile; // if set, every block of collected scanner data is appended to this scan log
+	std::string replayFile; // if set, the scanner data is read from this scan log instead of the A3200
+	double replaySpeed; // replay speed relative to the recording. Values <= 0 replay the log as fast as possible
+	bool buffered; // if true, the scanner data is collected on its own thread while the previous scan is processed
+	int bufferSize; // number of blocks of scanner data in the acquisition ring when buffered
+	int triggersPerCollection; // number of scanner triggers (profiles) in each data collection window
+	int scanDepth; // depth of the scan processing, CV_64F or CV_32F. CV_32F halves the memory traffic and doubles the SIMD width
+	double scanPitch; // distance between scans along the rod in [mm], timed from the planned feed rate. Values <= 0 scan as fast as possible
+	double coverage; // fraction of a segment's ROI that must be swept by valid scans taken after the printer reached it before the segment is released for processing. Values <= 0 only use the scanDonePt
+	double positionPeriod; // period in [ms] of the position feedback polling used to release segments and schedule scans. Values <= 0 use the scan positions only
+	int edgeDetector; // edge detector run on each scan, one of edgeMethod::method
+	double priorMargin; // margin in [mm] around the edges measured on layer - 2 that the edges of a rod are searched within. Values <= 0 search the whole edge boundary
+	int scanWorkers; // number of threads processing the scans when buffered. The results are still applied in acquisition order. 1 processes the scans on the scanning thread
+	int prefilter; // filter applied to each profile before the edge detector to remove the dropout spikes, one of profileFilter::filter
+	int prefilterRadius; // half width of the prefilter window in [px]
+
+	ScanOptions();
+	ScanOptions(std::string _recordFile, std::string _replayFile = "", double _replaySpeed = 1);
+
+private:
+
+};
+inline ScanOptions::ScanOptions()
+	: replaySpeed(1), buffered(true), bufferSize(3), triggersPerCollection(1), scanDepth(CV_64F), scanPitch(-1), coverage(0.95), positionPeriod(1), edgeDetector(edgeMethod::OTSU), priorMargin(0.25), scanWorkers(1), prefilter(profileFilter::NONE), prefilterRadius(5) {}
+
+inline ScanOptions::ScanOptions(std::string _recordFile, std::string _replayFile, double _replaySpeed)
+	: recordFile(_recordFile), replayFile(_replayFile), replaySpeed(_replaySpeed), buffered(true), bufferSize(3), triggersPerCollection(1), scanDepth(CV_64F), scanPitch(-1), coverage(0.95), positionPeriod(1), edgeDetector(edgeMethod::OTSU), priorMargin(0.25), scanWorkers(1), prefilter(profileFilter::NONE), prefilterRadius(5) {}
+
+
+///////////////////////////////////////  ScanStats  ///////////////////////////////////////
+class ScanStats
+{
+public:
+	std::atomic<int> collected; // number of profiles received from the scanner
+	std::atomic<int> skipped; // number of profiles skipped because the scanner was outside the print ROI
+
+	ScanStats() : collected(0), skipped(0) {}
+
+	void reset() {
+		collected = 0;
+		skipped = 0;
+	}
+};
 
 ///////////////////////////////////////  PrintDir  ///////////////////////////////////////
 class printDir
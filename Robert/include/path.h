@@ -24,4 +24,16 @@ void readPath(std::string filename, double& rodLen, double& rodSpc, double& wayp
 
 void readTheta(std::string filename, std::deque<double>& theta);
 
+/**
+ * @brief Finds the segment that a position is on from the nearest waypoint of the segments ahead of a given segment
+ * @param[in] path Waypoints of each segment
+ * @param[in] pos Position in [mm]
+ * @param[in] first First segment to search
+ * @param[in] numSegs Number of segments to search
+ * @param[in] maxDist Maximum distance in [mm] from the nearest waypoint for the position to be on the segment
+ * @param[out] waypoint Index of the nearest waypoint in its segment
+ * @return Segment of the nearest waypoint. -1 if no waypoint of the searched segments is within maxDist
+*/
+int findPathSegment(const std::vector<std::vector<Path>>& path, const cv::Point2d& pos, int first, int numSegs, double maxDist, int& waypoint);
+
 #endif // !PATH_H
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "myTypes.h"
+
+#ifndef POSITION_SERVICE_H
+#define POSITION_SERVICE_H
+
+///////////////////////////////////////  PositionService  ///////////////////////////////////////
+// Polls the X, Y, Z and TH position feedback from the A3200 on its own thread and publishes the latest pose
+// through a sequence lock. Any number of threads can read the pose without locking and without slowing down the poller.
+class PositionService
+{
+public:
+	PositionService();
+	~PositionService();
+
+	/**
+	 * @brief Starts polling the position feedback
+	 * @param[in] period Time between polls in [ms]
+	 * @return FALSE if the service is already running or the period is not positive
+	*/
+	bool start(double period);
+
+	/// @brief Stops polling and waits for the polling thread to finish. The last published pose can still be read
+	void stop();
+
+	bool running() const { return _run; }
+
+	/**
+	 * @brief Gets the latest published pose
+	 * @param[out] pos Position feedback in [mm] and [deg]
+	 * @param[out] time Time the position was read from the A3200
+	 * @return FALSE if no pose has been published yet
+	*/
+	bool read(Coords& pos) const;
+	bool read(Coords& pos, std::chrono::steady_clock::time_point& time) const;
+
+	/// @brief Number of poses published since the service was started
+	long long count() const { return _count; }
+
+private:
+	void _poll(double period);
+	void _publish(const Coords& pos, std::chrono::steady_clock::time_point time);
+
+	std::atomic<unsigned> _seq; // odd while a pose is being written
+	std::atomic<double> _x, _y, _z, _T;
+	std::atomic<std::chrono::steady_clock::rep> _time;
+	std::atomic<long long> _count;
+	std::atomic<bool> _run;
+	std::thread _thread;
+};
+
+#endif // POSITION_SERVICE_H
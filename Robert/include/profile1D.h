@@ -0,0 +1,150 @@
+#pragma once
+#include <vector>
+#include <opencv2/core.hpp>
+
+#ifndef PROFILE_1D_H
+#define PROFILE_1D_H
+
+// 1D kernels for processing a single scanner profile. Each kernel gives the same result as the OpenCV
+// operation on a 1xN row that getScan() uses, without the 2D filter setup and the temporary matrices.
+// The AVX2 versions are used when the CPU supports them, the same as the OpenCV dispatcher.
+
+///////////////////////////////////////  ProfileWorkspace  ///////////////////////////////////////
+class ProfileWorkspace
+{
+public:
+	ProfileWorkspace() {}
+	ProfileWorkspace(int length) { reserve(length); }
+
+	/// @brief Grows the buffers to fit a profile with the given number of samples. Does nothing if they are already large enough
+	void reserve(int length) {
+		if (length <= (int)profile.size()) { return; }
+		dil.resize(length);
+		morph.resize(length);
+		profile.resize(length);
+		profile32.resize(length);
+		norm.resize(length);
+		mask.resize(length);
+		dilMask.resize(length);
+		quant.resize(length);
+		quantMed.resize(length);
+		rankHist.resize(RANK_BINS);
+	}
+
+	static const int RANK_LEVELS = 4096; // levels the median filters quantize the signal to
+	static const int RANK_BINS = 16 + 256 + RANK_LEVELS; // bins of the three level histogram of the median filters
+
+	std::vector<double> dil; // dilated profile
+	std::vector<double> morph; // closed profile / blackhat of the profile
+	std::vector<double> profile; // scan output by getScan()
+	std::vector<float> profile32; // scan output by getScan() when using CV_32F
+	std::vector<uchar> norm; // profile normalized to [0, 255]
+	std::vector<uchar> mask; // thresholded profile
+	std::vector<uchar> dilMask; // dilated threshold mask
+	std::vector<ushort> quant; // profile quantized to RANK_LEVELS levels
+	std::vector<ushort> quantMed; // sliding median of the quantized profile
+	std::vector<int> rankHist; // histogram of the median filter window
+};
+
+/**
+ * @brief Enables or disables the AVX2 kernels. They are enabled by default when the CPU supports them
+ * @return TRUE if the AVX2 kernels will be used
+*/
+bool setProfileSIMD(bool enable);
+bool profileSIMD();
+
+/**
+ * @brief Index of the first maximum of the signal. Same as cv::minMaxIdx on a row
+*/
+int argMax1D(const double* src, int n);
+
+/**
+ * @brief Sliding window maximum / minimum with the window [i - radius, i + radius] clipped to the signal.
+ * Same as cv::dilate / cv::erode of a row with a rectangular kernel of width 2*radius + 1
+*/
+void maxFilter1D(const double* src, double* dst, int n, int radius);
+void minFilter1D(const double* src, double* dst, int n, int radius);
+void maxFilter1D(const uchar* src, uchar* dst, int n, int radius);
+
+/**
+ * @brief Black hat of the signal, i.e. closing - signal
+ * @param[in] radius Radius of the closing window. A 5x5 rectangle with 2 iterations has a radius of 4
+ * @param[out] dst Black hat of the signal. Uses ws.dil as scratch space, so dst may be ws.morph
+ * @param[in] ws Workspace reserved for at least n samples
+*/
+void blackhat1D(const double* src, double* dst, int n, int radius, ProfileWorkspace& ws);
+
+/**
+ * @brief Sliding window median with the window [i - radius, i + radius] clipped to the signal. The signal is quantized to
+ * ProfileWorkspace::RANK_LEVELS levels between its minimum and maximum and the window is kept in a three level histogram,
+ * so each sample costs the same whatever the radius. The output is within (max - min) / 8190 of the exact median
+ * @param[out] dst Median of the signal. May be src
+ * @param[in] ws Workspace reserved for at least n samples
+*/
+void medianFilter1D(const double* src, double* dst, int n, int radius, ProfileWorkspace& ws);
+void medianFilter1D(const float* src, float* dst, int n, int radius, ProfileWorkspace& ws);
+
+/**
+ * @brief Hampel filter. Replaces the samples that are further than k scaled MADs from the sliding median of medianFilter1D() with the
+ * median. The MAD is of the whole signal from its sliding median, so the scale is found once and each sample still costs the same
+ * @param[in] k Number of scaled MADs (1.4826 * MAD, the standard deviation of normal noise) a sample must be from the median to be replaced
+ * @param[out] dst Filtered signal. May be src
+ * @param[in] ws Workspace reserved for at least n samples
+ * @return Number of samples replaced
+*/
+int hampel1D(const double* src, double* dst, int n, int radius, double k, ProfileWorkspace& ws);
+int hampel1D(const float* src, float* dst, int n, int radius, double k, ProfileWorkspace& ws);
+
+/**
+ * @brief Scales the signal to [0, 255]. Same as cv::normalize with cv::NORM_MINMAX and CV_8U output
+*/
+void normalize1D(const double* src, uchar* dst, int n);
+
+/**
+ * @brief Otsu threshold of an 8 bit signal. Same as the threshold computed by cv::threshold with cv::THRESH_OTSU
+*/
+int otsu1D(const uchar* src, int n);
+
+/**
+ * @brief Otsu threshold from a 256 bin histogram of an 8 bit signal with n values
+*/
+int otsuHist1D(const int* hist, int n);
+
+/**
+ * @brief Recursive Otsu thresholding of findEdges2(). Each level finds the Otsu threshold and floors the values at or below it
+ * to threshold / level. Every level is found from one histogram that is updated in place when the values are floored.
+ * Same as repeating cv::threshold with cv::THRESH_BINARY_INV + cv::THRESH_OTSU and setting the masked values to the floor
+ * @param[in] maxLevels Maximum number of levels. Stops early once the floor value drops below 1
+ * @return Highest threshold of the levels, so the union of the level masks is src <= threshold. -1 if no level was applied
+*/
+int multiOtsu1D(const uchar* src, int n, int maxLevels);
+
+/**
+ * @brief Binary threshold. dst = 255 where src > thresh, otherwise 0
+*/
+void threshold1D(const uchar* src, uchar* dst, int n, int thresh);
+
+/**
+ * @brief Finds the points where the second derivative of an 8 bit signal is positive.
+ * Same as the non-zero points of cv::Sobel with dx = 2, ksize = 3, CV_8U output and cv::BORDER_REPLICATE
+ * @param[out] idx Indices of the first maxPts points
+ * @return Total number of points found
+*/
+int edgePoints1D(const uchar* src, int n, int* idx, int maxPts);
+
+/**
+ * @brief Sub-pixel position of a level crossing between two neighbouring samples by linear interpolation
+ * @param[in] v0 Value of the sample on one side of the crossing
+ * @param[in] v1 Value of the sample on the other side of the crossing
+ * @return Fraction of the way from the v0 sample to the v1 sample where the signal equals the level, clipped to [0, 1]
+*/
+double crossing1D(double v0, double v1, double level);
+
+/**
+ * @brief Sub-pixel position of a local extremum from the parabola through the extreme sample and its two neighbours
+ * @param[in] vPrev, v, vNext Values of the samples before, at and after the extreme sample
+ * @return Offset of the vertex of the parabola from the extreme sample, clipped to [-0.5, 0.5]. 0 if the samples are on a line
+*/
+double peak1D(double vPrev, double v, double vNext);
+
+#endif // PROFILE_1D_H
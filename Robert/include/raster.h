@@ -6,10 +6,13 @@
 #include <vector>
 #include <iterator>
 #include <algorithm>
+#include <array>
+#include <memory>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 
 #include "constants.h"
+#include "resolution.h"
 #include "myTypes.h"
 #include "myGlobals.h"
 
@@ -18,18 +21,24 @@
 
 class Raster {
 private:
+    // geometry of the raster rotated for a layer. Layers with the same layer % 4 have the same geometry
+    struct Geometry {
+        cv::Size size;
+        cv::Rect2d roi;
+        std::vector<cv::Point> px;
+        std::vector<cv::Point2d> mm;
+        cv::Mat boundaryMask;
+    };
+
     cv::Size _sz;
     cv::Mat _mat;
     cv::Rect2d _roi;
-    cv::Mat _boundaryMask;
     std::vector<cv::Point> _boundaryPoints;
     std::vector<cv::Point> _cornersPix;
     std::vector<cv::Point2d> _cornersMM;
-    // variables for the rotated versions of the base variables - used when making a multi-layer raster
-    cv::Mat _Rmat;
-    cv::Mat _RboundaryMask;
-    std::vector<cv::Point> _RcornersPix;
-    std::vector<cv::Point2d> _RcornersMM;
+    // geometry of the four orientations of a multi-layer raster. It is made when the raster is made or offset and never changed
+    // after, so the copies of the raster passed to the threads share it and can read it at the same time
+    std::shared_ptr<const std::array<Geometry, 4>> _geometry;
     double _rodWidth;
     double _length;
     double _width;
@@ -37,6 +46,8 @@ private:
     double _border;
 
     void _makeRaster(double length, double width, double rodSpacing, double rodWidthMax, double border);
+    void _makeGeometry();
+    const Geometry& _layer(int layer) const { return (*_geometry)[((layer % 4) + 4) % 4]; }
 
 public:
     // default constructor
@@ -59,17 +70,19 @@ public:
     */
     Raster(double length, double width, double rodSpacing, double rodWidthMax, double border );
 
-    const cv::Rect2d& roi(int layer = 0);
-    const cv::Mat& boundaryMask(int layer = 0);
-    const std::vector<cv::Point>& px(int layer = 0);
-    const std::vector<cv::Point2d>& mm(int layer = 0);
-    const cv::Size& size(int layer = 0);
-    const double& rodWidth() { return _rodWidth; }
-    const double& length() { return _length; }
-    const double& width() { return _width; }
-    const double& spacing() { return _spacing; }
-    const double& border() { return _border; }
-    const cv::Point2d& origin() { return _roi.tl(); }
+    // The layer geometry is looked up from the cache, so the references stay valid until the raster is offset or reassigned
+    const cv::Rect2d& roi(int layer = 0) const { return _layer(layer).roi; }
+    // Shared by every copy of the raster. Clone it before drawing on it
+    const cv::Mat& boundaryMask(int layer = 0) const { return _layer(layer).boundaryMask; }
+    const std::vector<cv::Point>& px(int layer = 0) const { return _layer(layer).px; }
+    const std::vector<cv::Point2d>& mm(int layer = 0) const { return _layer(layer).mm; }
+    const cv::Size& size(int layer = 0) const { return _layer(layer).size; }
+    const double& rodWidth() const { return _rodWidth; }
+    const double& length() const { return _length; }
+    const double& width() const { return _width; }
+    const double& spacing() const { return _spacing; }
+    const double& border() const { return _border; }
+    cv::Point2d origin() const { return _roi.tl(); }
     
     void offset(cv::Point2d);
     const cv::Mat& draw(int layer = 0);
@@ -78,7 +91,9 @@ public:
 };
 
 inline Raster::Raster()
-    : _rodWidth(0), _length(0), _width(0), _spacing(0), _border(0) {}
+    : _rodWidth(0), _length(0), _width(0), _spacing(0), _border(0) {
+    _makeGeometry();
+}
 
 inline Raster::Raster(double length, double rodSpacing, double rodWidthMax, double border) {
     _makeRaster(length, length, rodSpacing, rodWidthMax, border);
@@ -88,47 +103,38 @@ inline Raster::Raster(double length, double width, double rodSpacing, double rod
     _makeRaster(length, width, rodSpacing, rodWidthMax, border);
 }
 
-inline const cv::Rect2d& Raster::roi(int layer) {
-    if (layer % 2 == 0) { return _roi; }
-    else { return cv::Rect2d(_roi.tl().x, _roi.tl().y, _roi.height, _roi.width); }
-}
-
-inline const cv::Mat& Raster::boundaryMask(int layer){
-    _boundaryMask = cv::Mat::zeros(size(layer), CV_8UC1);
-    cv::polylines(_boundaryMask, px(layer), false, cv::Scalar(255), MM2PIX(_rodWidth), 8);
-    return _boundaryMask;
-}
-
-inline const std::vector<cv::Point>& Raster::px(int layer){
-    cv::Point2d offset = -cv::Point2d(_sz / 2) + cv::Point2d(size(layer)) / 2;
-    cv::Mat T = (cv::Mat_<double>(2, 3) << 1, 0, offset.x, 0, 1, offset.y);
-    cv::Mat R = cv::getRotationMatrix2D(cv::Point2d(_sz / 2), static_cast<__int64>(layer) * 90, 1);
-
-    cv::transform(_cornersPix, _RcornersPix, R); 
-    cv::transform(_RcornersPix, _RcornersPix, T);
-
-    return _RcornersPix;
-}
-
-inline const std::vector<cv::Point2d>& Raster::mm(int layer){
-    cv::transform(_cornersMM, _RcornersMM, cv::getRotationMatrix2D(cv::Point2f((_roi.tl() + _roi.br()) * 0.5), static_cast<__int64>(layer) * 90, 1));
-    return _RcornersMM;
-}
-
-inline const cv::Size& Raster::size(int layer) {
-    if (layer % 2 == 0) { return _sz; }
-    else { return cv::Size(_sz.height, _sz.width); }
+inline void Raster::_makeGeometry() {
+    auto geometry = std::make_shared<std::array<Geometry, 4>>();
+
+    for (int orient = 0; orient < 4; orient++) {
+        Geometry& g = (*geometry)[orient];
+        g.size = (orient % 2 == 0) ? _sz : cv::Size(_sz.height, _sz.width);
+        g.roi = (orient % 2 == 0) ? _roi : cv::Rect2d(_roi.tl().x, _roi.tl().y, _roi.height, _roi.width);
+        g.boundaryMask = cv::Mat::zeros(g.size, CV_8UC1);
+        if (_cornersPix.empty()) { continue; }
+
+        // rotate about the center of the layer 0 image and shift into the image of the rotated layer
+        cv::Point2d offset = -cv::Point2d(_sz / 2) + cv::Point2d(g.size) / 2;
+        cv::Mat T = (cv::Mat_<double>(2, 3) << 1, 0, offset.x, 0, 1, offset.y);
+        cv::Mat R = cv::getRotationMatrix2D(cv::Point2d(_sz / 2), orient * 90.0, 1);
+        cv::transform(_cornersPix, g.px, R);
+        cv::transform(g.px, g.px, T);
+
+        cv::transform(_cornersMM, g.mm, cv::getRotationMatrix2D(cv::Point2f((_roi.tl() + _roi.br()) * 0.5), orient * 90.0, 1));
+        cv::polylines(g.boundaryMask, g.px, false, cv::Scalar(255), resolution.toPix(_rodWidth), 8);
+    }
+    _geometry = geometry;
 }
 
 inline void Raster::_makeRaster(double length, double width, double rodSpacing, double rodWidthMax, double border) {
 
     int i = 0;
     double mmBord = rodWidthMax / 2 + border;
-    int pixLen = MM2PIX(length);
-    int pixWth = MM2PIX(width);
-    int pixSpac = MM2PIX(rodSpacing);
-    int pixBord = MM2PIX(mmBord);
-    int pixRodWth = MM2PIX(rodWidthMax);
+    int pixLen = resolution.toPix(length);
+    int pixWth = resolution.toPix(width);
+    int pixSpac = resolution.toPix(rodSpacing);
+    int pixBord = resolution.toPix(mmBord);
+    int pixRodWth = resolution.toPix(rodWidthMax);
 
     _rodWidth = rodWidthMax;
     _length = length;
@@ -139,14 +145,14 @@ inline void Raster::_makeRaster(double length, double width, double rodSpacing,
     // initialize matrix to store raster with border
     _sz = cv::Size(pixLen + 2 * pixBord, pixWth + 2 * pixBord);
     _mat = cv::Mat(_sz, CV_8U, cv::Scalar(0)).clone();
-    _boundaryMask = _mat.clone();
+    cv::Mat boundaryMask = _mat.clone();
 
     // add the first point to the raster
     _cornersPix.push_back(cv::Point(pixBord, pixBord));
 
     while (_cornersPix.back().x <= (pixLen + _cornersPix.front().x) && _cornersPix.back().y <= (pixWth + _cornersPix.front().y)) {
         // Convert the points to mm
-        _cornersMM.push_back(PIX2MM(cv::Point2d(_cornersPix.back() /*- _cornersPix.front()*/)));
+        _cornersMM.push_back(resolution.toMM(cv::Point2d(_cornersPix.back() /*- _cornersPix.front()*/)));
 
         switch (i % 4) {
         case 0:
@@ -170,23 +176,24 @@ inline void Raster::_makeRaster(double length, double width, double rodSpacing,
 
     // Draw the raster lines on an image
     cv::polylines(_mat, _cornersPix, false, cv::Scalar(255), 1, 4);
-    cv::polylines(_boundaryMask, _cornersPix, false, cv::Scalar(255), pixRodWth, 8);
+    cv::polylines(boundaryMask, _cornersPix, false, cv::Scalar(255), pixRodWth, 8);
 
     // Get the boundary points
     std::vector<std::vector<cv::Point> > contour;
-    cv::findContours(_boundaryMask, contour, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    cv::findContours(boundaryMask, contour, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
     _boundaryPoints = contour[0];
 
     // define the roi of the raster
     _roi = cv::Rect2d(0, 0, 2 * mmBord + length, 2 * mmBord + width);
 
-    // offset the coordinates
+    // offset the coordinates. Also makes the layer geometry
     offset(-_cornersMM.front());
 }
 
 inline void Raster::offset(cv::Point2d offset) {
     for (auto it = _cornersMM.begin(); it != _cornersMM.end(); ++it) { *it += offset; }
     _roi += offset;
+    _makeGeometry();
 }
 
 inline const cv::Mat& Raster::draw(int layer){
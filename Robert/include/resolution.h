@@ -0,0 +1,78 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+// Size of the pixels of the layer images, which sets the scale between [mm] and [px] everywhere in the print and scan processing.
+// FixedResolution is the scale as a compile-time constant, so conversions of constants are folded by the compiler. Resolution holds
+// the scale of the current job, which is read from the print table (see TableInput) so one build can run prints at any resolution.
+
+/// @brief Rounds half away from zero, the same as std::lround, but can be evaluated at compile time
+constexpr long roundPix(double val) {
+	long whole = (long)val;
+	double frac = val - whole; // exact, so halves are not rounded the wrong way by adding 0.5
+	return (frac >= 0.5) ? whole + 1 : (frac <= -0.5) ? whole - 1 : whole;
+}
+
+///////////////////////////////////////  FixedResolution  ///////////////////////////////////////
+/**
+ * @brief Resolution known at compile time
+ * @tparam UM Size of a pixel in [um]
+*/
+template <int UM>
+struct FixedResolution
+{
+	static_assert(UM > 0, "The pixel size must be positive");
+	static constexpr double MM = UM / 1000.0; // size of a pixel in [mm]
+
+	static constexpr double mmPerPix() { return MM; }
+
+	/// @brief Length in [mm] to the nearest whole number of pixels
+	static constexpr long toPix(double mm) { return roundPix(mm / MM); }
+
+	/// @brief Length or point in [px] to [mm]
+	template <typename T>
+	static constexpr auto toMM(const T& pix) { return pix * MM; }
+};
+
+typedef FixedResolution<20> DefaultResolution; // 0.02 mm/px
+
+///////////////////////////////////////  Resolution  ///////////////////////////////////////
+class Resolution
+{
+public:
+	constexpr Resolution() : _mm(DefaultResolution::MM) {} // constant initialized, so it is set before any global Raster is made
+
+	/**
+	 * @brief Changes the resolution. Anything already made in [px], e.g. a Raster, keeps the old scale, so it has to be set before the print is made
+	 * @param[in] mmPerPix Size of a pixel in [mm]
+	 * @return FALSE if the size is not positive, in which case the resolution is not changed
+	*/
+	bool set(double mmPerPix) {
+		if (!(mmPerPix > 0)) {
+			std::cout << "ERROR: Resolution must be positive, got " << mmPerPix << " mm/px" << std::endl;
+			return false;
+		}
+		_mm = mmPerPix;
+		return true;
+	}
+
+	double mmPerPix() const { return _mm; }
+
+	/// @brief Length in [mm] to the nearest whole number of pixels
+	long toPix(double mm) const { return roundPix(mm / _mm); }
+
+	/// @brief Length or point in [px] to [mm]
+	template <typename T>
+	auto toMM(const T& pix) const { return pix * _mm; }
+
+private:
+	double _mm; // size of a pixel in [mm]
+};
+
+/// @brief Resolution of the current job. Set once from the print table before the raster is made and only read after that
+inline Resolution resolution;
+
+#endif // !RESOLUTION_H
@@ -0,0 +1,138 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Ring of preallocated blocks of scanner data passed from the acquisition thread to the processing thread.
+// One thread writes blocks and one thread reads them; the writer waits while every block is full and the
+// reader waits while every block is empty, so no memory is allocated once the ring has been created.
+// The reader may hold several blocks at once, e.g. while they are processed in parallel. They are returned in the order they were read.
+
+#ifndef SCAN_BUFFER_H
+#define SCAN_BUFFER_H
+
+class ScanRing
+{
+private:
+	std::vector<double> _data;
+	size_t _blockSize;
+	size_t _numBlocks;
+	size_t _head; // next block to write
+	size_t _tail; // next block to read
+	size_t _count; // number of blocks written and not yet returned by the reader
+	size_t _reading; // number of blocks the reader is holding
+	bool _writing; // true while the writer holds a block, i.e. while the scanner data is being collected
+	bool _closed;
+	mutable std::mutex mut;
+	std::condition_variable data_cond;
+	std::condition_variable space_cond;
+
+public:
+	/**
+	 * @param numBlocks Number of blocks in the ring
+	 * @param blockSize Number of values in a block of data
+	*/
+	ScanRing(size_t numBlocks, size_t blockSize)
+		: _data(numBlocks * blockSize), _blockSize(blockSize), _numBlocks(numBlocks), _head(0), _tail(0), _count(0), _reading(0), _writing(false), _closed(false)
+	{}
+
+	/**
+	 * @brief Waits for a free block to write to. The block is not passed to the reader until endWrite() is called
+	 * @return Pointer to the block, or NULL if the ring has been closed
+	*/
+	double* beginWrite()
+	{
+		std::unique_lock<std::mutex> lk(mut);
+		space_cond.wait(lk, [this] {return _closed || _count < _numBlocks; });
+		if (_closed) { return nullptr; }
+		_writing = true;
+		return &_data[_head * _blockSize];
+	}
+
+	/// @brief Passes the block returned by beginWrite() to the reader
+	void endWrite()
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		_head = (_head + 1) % _numBlocks;
+		_count++;
+		_writing = false;
+		data_cond.notify_one();
+	}
+
+	/**
+	 * @brief Waits for the oldest written block that the reader is not already holding. The block is not reused until endRead() is called
+	 * @return Pointer to the block, or NULL if the ring has been closed and every block has been read
+	*/
+	double* beginRead()
+	{
+		std::unique_lock<std::mutex> lk(mut);
+		data_cond.wait(lk, [this] {return _closed || _count > _reading; });
+		return _nextRead();
+	}
+
+	/**
+	 * @brief Same as beginRead(), but gives up after the timeout
+	 * @return Pointer to the block, or NULL if the timeout expired or the ring has been closed and every block has been read.
+	 * Use done() to tell them apart
+	*/
+	template <class Rep, class Period>
+	double* beginRead(const std::chrono::duration<Rep, Period>& timeout)
+	{
+		std::unique_lock<std::mutex> lk(mut);
+		data_cond.wait_for(lk, timeout, [this] {return _closed || _count > _reading; });
+		return _nextRead();
+	}
+
+	/// @brief Returns the oldest block held by the reader to the writer
+	void endRead()
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		_tail = (_tail + 1) % _numBlocks;
+		_count--;
+		_reading--;
+		space_cond.notify_one();
+	}
+
+	/// @brief Wakes up both threads. The writer stops writing and the reader gets the remaining blocks
+	void close()
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		_closed = true;
+		_writing = false;
+		data_cond.notify_all();
+		space_cond.notify_all();
+	}
+
+	/// @brief TRUE if the ring has been closed and every block has been read
+	bool done() const
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		return _closed && _count == 0;
+	}
+
+	/// @brief TRUE if no block is being written and every written block is held by the reader, so no scan is on its way to the reader
+	bool idle() const
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		return !_writing && _count == _reading;
+	}
+
+	size_t size() const
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		return _count;
+	}
+
+	size_t numBlocks() const { return _numBlocks; }
+
+private:
+	// must be called with the lock held
+	double* _nextRead()
+	{
+		if (_count <= _reading) { return nullptr; }
+		return &_data[((_tail + _reading++) % _numBlocks) * _blockSize];
+	}
+};
+
+#endif // SCAN_BUFFER_H
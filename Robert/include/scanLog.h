@@ -0,0 +1,138 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <chrono>
+
+#ifndef SCAN_LOG_H
+#define SCAN_LOG_H
+
+// A scan log is an append-only binary file holding every block of collected scanner data.
+// Layout: ScanLogHeader followed by numRecords records of [double timestamp][double data[numSignals][numSamples]]
+// The timestamp is the time in [s] since the log was opened for writing.
+
+#define SCAN_LOG_MAGIC "RSCANLOG"
+#define SCAN_LOG_VERSION 1
+
+struct ScanLogHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t numSignals;
+	uint32_t numSamples;
+	uint32_t reserved;
+	uint64_t numRecords;
+};
+
+///////////////////////////////////////  ScanLogWriter  ///////////////////////////////////////
+class ScanLogWriter
+{
+public:
+	ScanLogWriter();
+	~ScanLogWriter();
+	ScanLogWriter(const ScanLogWriter&) = delete;
+	ScanLogWriter& operator=(const ScanLogWriter&) = delete;
+
+	/**
+	 * @brief Creates the log file, overwriting any existing file with the same name
+	 * @param[in] filename Name of the log file
+	 * @param[in] numSignals Number of signals in each block of data
+	 * @param[in] numSamples Number of samples of each signal in a block of data
+	 * @return TRUE on success, FALSE if the file could not be created or mapped
+	*/
+	bool open(std::string filename, int numSignals, int numSamples);
+
+	/**
+	 * @brief Appends a block of data to the log and time stamps it with the current time
+	 * @param[in] data Block of data in the format data[signal][sample]
+	 * @return TRUE on success, FALSE if the log is not open or could not be extended
+	*/
+	bool append(const double* data);
+
+	/// @brief Unmaps the log and truncates the file to the records that were written
+	void close();
+
+	bool isOpen() const { return _view != nullptr; }
+	uint64_t size() const { return _header == nullptr ? 0 : _header->numRecords; }
+
+private:
+	bool _map(uint64_t capacity);
+	void _unmap();
+
+	std::string _filename;
+	size_t _recordSize; // number of bytes in a record, including the timestamp
+	uint64_t _capacity; // number of records that fit in the current mapping
+	std::chrono::steady_clock::time_point _t0;
+	char* _view;
+	ScanLogHeader* _header;
+#ifdef _WIN32
+	void* _hFile;
+	void* _hMap;
+#else
+	int _fd;
+#endif
+};
+
+///////////////////////////////////////  ScanLogReader  ///////////////////////////////////////
+class ScanLogReader
+{
+public:
+	ScanLogReader();
+	~ScanLogReader();
+	ScanLogReader(const ScanLogReader&) = delete;
+	ScanLogReader& operator=(const ScanLogReader&) = delete;
+
+	/**
+	 * @brief Maps a log file for reading
+	 * @param[in] filename Name of the log file
+	 * @return TRUE on success, FALSE if the file could not be opened or is not a scan log
+	*/
+	bool open(std::string filename);
+	void close();
+
+	/**
+	 * @brief Sets the replay speed
+	 * @param[in] speed 1 replays at the recorded rate, N replays N times faster, values <= 0 replay as fast as possible
+	*/
+	void setSpeed(double speed) { _speed = speed; }
+
+	/**
+	 * @brief Copies the next block of data, waiting until it is due at the current replay speed
+	 * @param[out] data Block of data in the format data[signal][sample]
+	 * @return TRUE on success, FALSE if the end of the log has been reached
+	*/
+	bool read(double* data);
+
+	/**
+	 * @brief Direct access to a block of data in the mapped file
+	 * @param[in] index Index of the record
+	 * @param[out] timestamp Time the block was recorded in [s]. Ignored if NULL
+	 * @return Pointer to the data in the format data[signal][sample], or NULL if the index is out of range
+	*/
+	const double* record(uint64_t index, double* timestamp = NULL) const;
+
+	/// @brief Restarts the replay from the first record
+	void rewind() { _next = 0; }
+
+	bool isOpen() const { return _view != nullptr; }
+	uint64_t size() const { return _numRecords; }
+	int numSignals() const { return _numSignals; }
+	int numSamples() const { return _numSamples; }
+
+private:
+	size_t _recordSize;
+	uint64_t _numRecords;
+	uint64_t _next;
+	int _numSignals;
+	int _numSamples;
+	double _speed;
+	std::chrono::steady_clock::time_point _t0; // wall time the first record was replayed
+	const char* _view;
+#ifdef _WIN32
+	void* _hFile;
+	void* _hMap;
+#else
+	int _fd;
+	size_t _length;
+#endif
+};
+
+#endif // SCAN_LOG_H
@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <opencv2/core.hpp>
+#include "myTypes.h"
+
+#ifndef SCAN_SCHEDULER_H
+#define SCAN_SCHEDULER_H
+
+///////////////////////////////////////  ScanScheduler  ///////////////////////////////////////
+// Spaces the scanner triggers at a fixed distance along the rod instead of triggering as fast as the data collection allows.
+// The time to the next trigger is found from the position of the last trigger and the planned feed rate of the nearest waypoint
+// on the segment the gantry is printing, which is found by searching forward from the segment being scanned.
+// When the position feedback service is running, the trigger waits for the live position to have moved the pitch.
+class ScanScheduler
+{
+public:
+	/**
+	 * @brief Creates a scheduler for the path
+	 * @param[in] path Planned path. Must stay valid while the scheduler is used
+	 * @param[in] pitch Distance between scans along the rod in [mm]. Values <= 0 disable the scheduling
+	*/
+	ScanScheduler(const std::vector<std::vector<Path>>& path, double pitch);
+
+	bool enabled() const { return _pitch > 0; }
+
+	/// @brief Sets the segment being scanned. Used to look up the planned feed rate. Can be called from another thread
+	void setSegment(int segNum) { _segNum = segNum; }
+
+	/**
+	 * @brief Sleeps until the scanner should be triggered again. Returns immediately if the scheduling is disabled,
+	 * no scan has been taken yet or the scanner is not on the planned path (travel moves are scanned as fast as possible)
+	*/
+	void wait();
+
+	/**
+	 * @brief Records a scanner trigger
+	 * @param[in] pos Position of the scanner when it was triggered in [mm]
+	 * @param[in] tTrigger Time the scanner was triggered
+	 * @param[in] acqTime Time taken by the data collection of this trigger in [s]
+	*/
+	void triggered(const cv::Point2d& pos, std::chrono::steady_clock::time_point tTrigger, double acqTime);
+
+	/// @brief Planned feed rate at the last trigger in [mm/s]. <= 0 if the scanner was not on the path
+	double lastFeed() const { return _lastFeed; }
+
+	/// @brief Prints the achieved pitch statistics and the number of acquisitions saved by the scheduling
+	void printStats() const;
+
+private:
+	double _feedRate(const cv::Point2d& pos);
+
+	const std::vector<std::vector<Path>>& _path;
+	double _pitch; // target distance between scans in [mm]
+	std::atomic<int> _segNum; // segment being scanned
+	int _printSeg; // segment the gantry was last found printing
+	bool _hasLast; // true once the first trigger was recorded
+	cv::Point2d _lastPos; // position of the last trigger in [mm]
+	double _lastFeed; // planned feed rate at the last trigger in [mm/s]. <= 0 if not on the path
+	std::chrono::steady_clock::time_point _lastTrigger, _firstTrigger;
+	int _numTriggers; // number of triggers recorded
+	double _acqTime; // total time spent collecting data in [s]
+	double _waitTime; // total time spent waiting for the next trigger in [s]
+	std::vector<double> _pitches; // achieved distances between consecutive scans on the path in [mm]
+};
+
+#endif // SCAN_SCHEDULER_H
@@ -0,0 +1,118 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <opencv2/core.hpp>
+#include "myTypes.h"
+#include "scanning.h"
+#include "profile1D.h"
+#include "edgeDetector.h"
+#include "edgeBoundary.h"
+
+#ifndef SCAN_WORKERS_H
+#define SCAN_WORKERS_H
+
+///////////////////////////////////////  ScanResult  ///////////////////////////////////////
+// Output of processScan() for one profile
+class ScanResult
+{
+public:
+	Coords fbk; // position of the scan
+	bool nearROI; // FALSE if the scanner was nowhere near the print and the profile was not extracted
+	bool valid; // TRUE if the profile crossed the print ROI and the edges were searched for
+	cv::Point scanStart, scanEnd; // pixel coordinates of the ends of the scan in the print ROI
+	std::vector<cv::Point2f> edges; // sub-pixel edges found on the scan
+	std::vector<float> heights; // profile resampled onto the pixels from scanStart to scanEnd in [mm] (see HeightMap)
+
+	ScanResult() : fbk{ 0, 0, 0, 0 }, nearROI(false), valid(false) {}
+};
+
+///////////////////////////////////////  ScanWorkspace  ///////////////////////////////////////
+// Buffers and edge detector used to process a profile. Each thread processing scans needs its own
+class ScanWorkspace
+{
+public:
+	ScanWorkspace(int edgeMethod, int prefilter = profileFilter::NONE, int prefilterRadius = 5)
+		: scan(1, NUM_DATA_SAMPLES, CV_64F), locXoffset(0), ws(NUM_DATA_SAMPLES), detector(makeEdgeDetector(edgeMethod, prefilter, prefilterRadius)) {}
+
+	cv::Mat scan; // profile output by getScan()
+	cv::Mat scanROI; // part of the profile within the print ROI
+	int locXoffset; // local x offset of the scan found by getScan()
+	ProfileWorkspace ws;
+	std::unique_ptr<EdgeDetector> detector;
+};
+
+/**
+ * @brief Extracts a profile from a window of scanner data and finds the edges on the part of it that is within the print ROI.
+ * Only reads its inputs, so it can run on several threads at once as long as each has its own workspace and result
+ * @param[in] window Window of scanner data of a single trigger (see splitScans())
+ * @param[in] printROI ROI of the print in [mm] (see Raster::roi())
+ * @param[in] rasterSize Size of the raster image of the layer
+ * @param[in] edgeBoundary Where to search for the edges
+ * @param[in] scanDepth Depth of the scan processing, CV_64F or CV_32F
+ * @param[in,out] sw Workspace of the calling thread
+ * @param[out] result Position of the scan and the edges found on it
+*/
+void processScan(const cv::Mat& window, const cv::Rect2d& printROI, cv::Size rasterSize, const EdgeBoundary& edgeBoundary, int scanDepth,
+	ScanWorkspace& sw, ScanResult& result);
+
+///////////////////////////////////////  ScanWorkers  ///////////////////////////////////////
+// Pool of threads that process scans concurrently. Each scan is submitted with a ticket that increases in acquisition order,
+// and wait() lets the caller take the results back in that order no matter which worker finishes first.
+// The pool does not own the scans: the process function maps a ticket to the caller's job and result buffers
+class ScanWorkers
+{
+public:
+	/**
+	 * @param[in] numWorkers Number of worker threads
+	 * @param[in] process Function run by a worker for each ticket. Its second argument is the index of the worker in [0, numWorkers)
+	*/
+	ScanWorkers(int numWorkers, std::function<void(long long ticket, int worker)> process);
+
+	/// @brief Waits for the submitted tickets to be processed and stops the workers
+	~ScanWorkers();
+
+	int size() const { return (int)_threads.size(); }
+
+	/**
+	 * @brief Queues the next ticket for the workers
+	 * @return Ticket of the job. Tickets start at 0 and increase by one with each call
+	*/
+	long long submit();
+
+	/**
+	 * @brief Waits until a ticket has been processed
+	 * @param[in] timeout Maximum time to wait
+	 * @return FALSE if the timeout expired first
+	*/
+	bool wait(long long ticket, std::chrono::milliseconds timeout);
+
+	/// @brief Waits until every submitted ticket has been processed
+	void waitAll();
+
+	/// @brief Number of tickets submitted and not yet processed
+	long long pending() const;
+
+private:
+	void _run(int worker);
+	bool _isDone(long long ticket) const { return ticket < _doneBelow || _doneAbove.count(ticket) > 0; }
+
+	std::function<void(long long, int)> _process;
+	std::vector<std::thread> _threads;
+	std::deque<long long> _queue; // tickets waiting for a worker
+	long long _nextTicket;
+	long long _doneBelow; // every ticket below this has been processed
+	std::set<long long> _doneAbove; // processed tickets above _doneBelow
+	bool _stop;
+	mutable std::mutex mut;
+	std::condition_variable task_cond;
+	std::condition_variable done_cond;
+};
+
+#endif // !SCAN_WORKERS_H
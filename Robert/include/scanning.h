@@ -3,6 +3,8 @@
 #include "constants.h"
 #include "myTypes.h"
 #include "A3200.h"
+#include "profile1D.h"
+#include "edgeBoundary.h"
 #include <opencv2/core.hpp>
 
 #ifndef SCANNING_H
@@ -17,14 +19,32 @@
 
 bool setupDataCollection(A3200Handle handle, A3200DataCollectConfigHandle DCCHandle);
 
+/**
+ * @brief Sets the length of the data collection window to fit several scanner triggers and applies the configuration
+ * @param[in] handle	The handle to the A3200
+ * @param[in] DCCHandle	The handle to the A3200 Data Collection Configuration object set up by setupDataCollection()
+ * @param[in] numTriggers	Number of scanner triggers in each data collection. The window is numTriggers * NUM_DATA_SAMPLES samples long
+ * @return TRUE on success, FALSE if an error occurred. Call A3200GetLastError() for more information.
+*/
+bool setCollectionTriggers(A3200Handle handle, A3200DataCollectConfigHandle DCCHandle, int numTriggers);
+
 /**
  * @brief Gets the analog profile from the scanner. This starts the data collection, sends a trigger signal to the scanner, then returns the collected data.
  * @param[in]  handle	The handle to the A3200
  * @param[in]  DCCHandle	The handle to an A3200 Data Collection Configuration object. If NULL, previous sent configuration will be used.
  * @param[out] data	The retrieved sample point in format data[signal][sample].
+ * @param[in]  numTriggers	Number of triggers sent to the scanner, one every NUM_DATA_SAMPLES samples. Must match the value given to setCollectionTriggers()
  * @return TRUE on success, FALSE if an error occurred. Call A3200GetLastError() for more information.
 */
-bool collectData(A3200Handle handle, A3200DataCollectConfigHandle DCCHandle, DOUBLE* data);
+bool collectData(A3200Handle handle, A3200DataCollectConfigHandle DCCHandle, DOUBLE* data, int numTriggers = 1);
+
+/**
+ * @brief Splits a block of data collected with several triggers into one window of NUM_DATA_SAMPLES samples per trigger
+ * @param[in] data Collected data in the format data[signal][sample] with numTriggers * NUM_DATA_SAMPLES samples per signal
+ * @param[in] numTriggers Number of triggers in the block
+ * @param[out] windows Views into the data, each in the same format as a single-trigger collection
+*/
+void splitScans(double* data, int numTriggers, std::vector<cv::Mat>& windows);
 
 /**
  * @brief Extracts the scanned profile and position feedback from the collected data
@@ -34,13 +54,49 @@ bool collectData(A3200Handle handle, A3200DataCollectConfigHandle DCCHandle, DOU
 */
 bool getScan(double data[][NUM_DATA_SAMPLES], Coords* fbk, cv::Mat& scan, int &locXoffset);
 
+/**
+ * @brief Extracts the scanned profile and position feedback from a window of collected data
+ * @param[in] dataMat NUM_DATA_SIGNALS x N matrix of signals in the same format as getScan(). The trigger is found within the window
+ * @param[out] fbk structure with x, y, z, and theta coordinates of gantry when scan was taken
+ * @param[out] scan	Z profile from scanner
+*/
+bool getScan(const cv::Mat& dataMat, Coords* fbk, cv::Mat& scan, int& locXoffset);
+
+/**
+ * @brief Same as getScan() but uses the 1D profile kernels and does not allocate once the workspace is large enough
+ * @param[in] dataMat NUM_DATA_SIGNALS x N matrix of signals in the same format as getScan()
+ * @param[out] fbk structure with x, y, z, and theta coordinates of gantry when scan was taken
+ * @param[out] scan	Z profile from scanner. Points into the workspace, so it is only valid until the workspace is used again
+ * @param[in] ws Workspace for the profile kernels
+ * @param[in] depth Depth of the output scan, CV_64F or CV_32F. The rest of the scan processing uses the same depth
+*/
+bool getScan(const cv::Mat& dataMat, Coords* fbk, cv::Mat& scan, int& locXoffset, ProfileWorkspace& ws, int depth = CV_64F);
+
+/**
+ * @brief Gets the position feedback when the scanner was triggered without extracting the profile
+ * @param[in] dataMat NUM_DATA_SIGNALS x N matrix of signals in the same format as getScan()
+ * @param[out] fbk structure with x, y, z, and theta coordinates of gantry when scan was taken
+ * @return Index of the trigger sample
+*/
+int getScanPos(const cv::Mat& dataMat, Coords* fbk);
+
+/**
+ * @brief Checks if the scanner footprint can overlap the print ROI using only the position of the scanner.
+ * This is much cheaper than getScan() so it is used to skip the scans taken during lead in, travel, and lead out
+ * @param[in] fbk Position of the scanner (X,Y,Z,T) when the scan was taken
+ * @param[in] printROI Global coordinates (in mm) defining where the print is
+ * @param[in] margin Distance in [mm] the footprint is extended by on all sides to allow for the profile offset
+ * @return FALSE if the scan is certainly outside the print ROI
+*/
+bool scanNearROI(const Coords fbk, const cv::Rect2d printROI, double margin = 1.0);
+
 /**
  * @brief Extracts the part of the scan that is within the print area defined by the printROI
- * @param[in] scan Profile from scanner
+ * @param[in] scan Profile from scanner. Either CV_64F or CV_32F
  * @param[in] fbk Position of the scanner (X,Y,Z,T) when the scan was taken
  * @param[in] printROI Global coordinates (in mm) defining where the print is. Vector in the form {Xmin, Ymin, Xmax, Ymax}
  * @param[in] rasterSize Size of the raster image
- * @param[out] scanROI Profile from the scanner that is within the print ROI
+ * @param[out] scanROI Profile from the scanner that is within the print ROI. Same depth as the scan
  * @param[out] scanStart Pixel coordinates of the start of the scan
  * @param[out] scanEnd Pixel coordinates of the end of the scan
  * @return TRUE if part of the scan is in the ROI, FALSE if the scan is outside of the ROI
@@ -60,6 +116,34 @@ bool scan2ROI(cv::Mat& scan, const Coords fbk, const int locXoffset, const cv::R
 */
 void findEdges(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, cv::Mat& edges, double heightThresh, int order = 1);
 
+/**
+ * @brief Same as findEdges() above, but outputs the edge points instead of marking them on an image
+ * @param[out] edgePts Sub-pixel coordinates of the edges found on the scan in the pixel coordinates of edgeBoundary. Each edge is placed
+ * at the vertex of the parabola through the extremum of the profile derivative and the samples on either side (see peak1D)
+*/
+void findEdges(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, std::vector<cv::Point2f>& edgePts, double heightThresh, int order = 1);
+
+/**
+ * @brief Same as findEdges() above, but the search windows are found from the boundary's rod geometry when it has one (see EdgeBoundary)
+ * instead of walking a cv::LineIterator over the mask
+*/
+void findEdges(const EdgeBoundary& edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, std::vector<cv::Point2f>& edgePts, double heightThresh, int order = 1);
+
+/**
+ * @brief Finds the edges in a single scan with recursive Otsu thresholding
+ * @param[in] edgeBoundary Mask indicating where to search for the edges. Only the edge pixels found on the scan are checked against it
+ * @param[in] scanStart Pixel coordinates of the start of the scan
+ * @param[in] scanEnd Pixel coordinates of the end of the scan
+ * @param[in] scanROI Profile from the scanner that is within the print ROI
+ * @param[in,out] edges Mat the size of edgeBoundary where the found edges are marked
+*/
 void findEdges2(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, cv::Mat& edges);
 
+/**
+ * @brief Same as findEdges2() above, but outputs the edge points instead of marking them on an image
+ * @param[out] edgePts Sub-pixel coordinates of the edges found on the scan that are inside edgeBoundary. Each edge is placed
+ * where the smoothed profile crosses the edge threshold, found by interpolating between the samples on either side (see crossing1D)
+*/
+void findEdges2(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, std::vector<cv::Point2f>& edgePts);
+
 #endif // !SCANNING_H
\ No newline at end of file
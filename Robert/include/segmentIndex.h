@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <limits>
+#include <opencv2/core.hpp>
+
+#ifndef SEGMENT_INDEX_H
+#define SEGMENT_INDEX_H
+
+///////////////////////////////////////  SegmentIndex  ///////////////////////////////////////
+// Packed R-tree over the bounding boxes of the segments of a layer, built once with the Sort-Tile-Recursive method.
+// The boxes can have any size and overlap, so it works for the ROIs of a raster and for the boxes around the lines of
+// any polyline toolpath. Finding the boxes that contain a point, or the nearest segment to it, visits O(log n) nodes.
+class SegmentIndex
+{
+public:
+	SegmentIndex() : _nodeSize(16) {}
+
+	/**
+	 * @param[in] boxes Bounding box of each segment. The index of a box in the vector is the id returned by the queries
+	 * @param[in] nodeSize Maximum number of children of a node
+	*/
+	SegmentIndex(const std::vector<cv::Rect2d>& boxes, int nodeSize = 16);
+
+	/// @brief Ids of the boxes that contain a point. A box contains the points on its top and left sides, the same as cv::Rect::contains
+	void query(const cv::Point2d& pt, std::vector<int>& hits) const;
+
+	/// @brief Ids of the boxes that overlap or touch a region, including boxes of zero width or height
+	void query(const cv::Rect2d& region, std::vector<int>& hits) const;
+
+	/**
+	 * @brief Finds the nearest segment to a point by visiting the nodes in order of the distance to their boxes
+	 * @param[in] maxDist Segments further than this are ignored
+	 * @param[in] dist Function giving the distance from the point to a segment from its id. It must not be less than the
+	 * distance to the segment's box, e.g. the distance to a line inside the box
+	 * @param[out] bestDist Distance to the nearest segment. maxDist if none was found
+	 * @return Id of the nearest segment. -1 if no segment is within maxDist
+	*/
+	template <typename Dist>
+	int nearest(const cv::Point2d& pt, double maxDist, Dist dist, double& bestDist) const;
+
+	int size() const { return (int)_boxes.size(); }
+	bool empty() const { return _boxes.empty(); }
+
+	/// @brief Distance from a point to a box. 0 inside the box
+	static double boxDistance(const cv::Point2d& pt, const cv::Rect2d& box);
+
+private:
+	struct Node {
+		cv::Rect2d box; // union of the children's boxes
+		int first; // first child in _nodes, or in _order for a leaf
+		int count; // number of children
+		bool leaf;
+	};
+
+	void _pack(std::vector<int>& ids, const std::vector<cv::Rect2d>& boxes, std::vector<Node>& level, bool leaf);
+
+	int _nodeSize;
+	std::vector<cv::Rect2d> _boxes; // boxes by id
+	std::vector<int> _order; // ids in the order of the leaves
+	std::vector<Node> _nodes; // nodes level by level from the leaves up. The root is the last node
+};
+
+template <typename Dist>
+int SegmentIndex::nearest(const cv::Point2d& pt, double maxDist, Dist dist, double& bestDist) const {
+	typedef std::pair<double, int> Entry; // distance to the box of a node, node
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+	int best = -1;
+	double d;
+
+	bestDist = maxDist;
+	if (_nodes.empty()) { return -1; }
+	queue.push(Entry(boxDistance(pt, _nodes.back().box), (int)_nodes.size() - 1));
+	while (!queue.empty()) {
+		Entry entry = queue.top();
+		queue.pop();
+		// every node left is further than the best segment
+		if (entry.first > bestDist) { break; }
+		const Node& node = _nodes[entry.second];
+		for (int i = node.first; i < node.first + node.count; i++) {
+			if (node.leaf) {
+				if (boxDistance(pt, _boxes[_order[i]]) > bestDist) { continue; }
+				d = dist(_order[i]);
+				// ties go to the lowest id, so the result does not depend on the packing
+				if (d < bestDist || (d == bestDist && (best < 0 || _order[i] < best))) {
+					bestDist = d;
+					best = _order[i];
+				}
+			}
+			else {
+				d = boxDistance(pt, _nodes[i].box);
+				if (d <= bestDist) { queue.push(Entry(d, i)); }
+			}
+		}
+	}
+	return best;
+}
+
+#endif // !SEGMENT_INDEX_H
@@ -7,7 +7,7 @@
 #ifndef THREAD_FNS_H
 #define THREAD_FNS_H
 
-void t_CollectScans(Raster raster);
+void t_CollectScans(Raster raster, std::vector<std::vector<Path>> path, ScanOptions scanOpts);
 
 void t_GetMatlErrors(Raster raster, std::vector<std::vector<Path>> path);
 
@@ -17,6 +17,4 @@ void t_controller(std::vector<std::vector<Path>>& path, Controller& controller,
 
 void t_printQueue(Path firstWpt, PrintOptions printOpts);
 
-void t_PollPositionFeedback(int rate);
-
 #endif // THREAD_FNS_H
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#ifndef TILED_IMAGE_H
+#define TILED_IMAGE_H
+
+///////////////////////////////////////  TiledImage  ///////////////////////////////////////
+// Image in the pixel coordinates of a layer's raster image that is split into square tiles, which are only allocated once
+// something is written to them. The pixels of the other tiles read as the background, so an image of the edges or the
+// heights of a layer costs memory in proportion to the printed area instead of the bounding box of the print.
+class TiledImage
+{
+public:
+	TiledImage() : _type(CV_8UC1), _bgValue(0), _tileSize(64), _tilesX(0), _tilesY(0), _numTiles(0) {}
+
+	/**
+	 * @param[in] size Size of the image
+	 * @param[in] type Type of the pixels, e.g. CV_8UC1
+	 * @param[in] background Value of the pixels that have not been written. New tiles are filled with it
+	 * @param[in] tileSize Width and height of the tiles in [px]
+	*/
+	TiledImage(cv::Size size, int type = CV_8UC1, const cv::Scalar& background = cv::Scalar(0), int tileSize = 64);
+
+	/// @brief Frees the tiles and resizes the image, e.g. for a new layer
+	void reset(cv::Size size);
+
+	/**
+	 * @brief Pointer to a pixel
+	 * @param[in] allocate If TRUE, the tile of the pixel is allocated if it has not been
+	 * @return nullptr if the pixel is outside the image, or its tile has not been allocated and allocate is FALSE
+	*/
+	uchar* ptr(const cv::Point& pt, bool allocate = true);
+	const uchar* ptr(const cv::Point& pt) const;
+
+	/// @brief Writable reference to a pixel, allocating its tile. The pixel must be inside the image
+	template <typename T> T& at(const cv::Point& pt) { return *reinterpret_cast<T*>(ptr(pt, true)); }
+
+	/// @brief Value of a pixel. The background if the pixel has not been written or is outside the image
+	template <typename T> T value(const cv::Point& pt) const {
+		const uchar* p = ptr(pt);
+		return p ? *reinterpret_cast<const T*>(p) : _background.at<T>(0, 0);
+	}
+
+	/// @brief Sets a pixel. Points outside the image are ignored
+	void set(const cv::Point& pt, const cv::Scalar& value);
+
+	/**
+	 * @brief Copies a region to a dense image of the same type
+	 * @param[in] roi Region of the image. The parts outside the image and in tiles that have not been allocated are the background
+	*/
+	void copyTo(const cv::Rect& roi, cv::Mat& dst) const;
+	void copyTo(cv::Mat& dst) const { copyTo(cv::Rect(cv::Point(0, 0), _size), dst); }
+
+	/**
+	 * @brief Coordinates of the non-zero pixels of a single channel image in the order of cv::findNonZero (row by row)
+	*/
+	void findNonZero(std::vector<cv::Point>& pts) const;
+
+	/**
+	 * @brief Draws polygonal curves. Same as cv::polylines on the dense image, but only the tiles that the lines pass through are allocated,
+ *        and each tile only draws the lines that reach it
+	*/
+	void polylines(const std::vector<cv::Point>& pts, bool isClosed, const cv::Scalar& color, int thickness = 1, int lineType = cv::LINE_8);
+
+	/**
+	 * @brief Writes the image to a PNG file. The image is made dense for the encoder, so this briefly needs the memory of the dense image
+	 * @param[in] flip If TRUE, the image is flipped about the x axis to have the origin in the lower left corner
+	 * @return FALSE if the file could not be written
+	*/
+	bool writePNG(const std::string& filename, bool flip = false) const;
+
+	cv::Size size() const { return _size; }
+	int type() const { return _type; }
+	int tileSize() const { return _tileSize; }
+
+	/// @brief Number of tiles that have been allocated
+	int numTiles() const { return _numTiles; }
+
+	/// @brief Memory used by the allocated tiles in [bytes]
+	size_t bytes() const { return (size_t)_numTiles * _tileSize * _tileSize * CV_ELEM_SIZE(_type); }
+
+private:
+	cv::Mat& _tile(int tx, int ty, bool allocate);
+	cv::Rect _tileRect(int tx, int ty) const { return cv::Rect(tx * _tileSize, ty * _tileSize, _tileSize, _tileSize); }
+
+	cv::Size _size;
+	int _type;
+	cv::Scalar _bgValue; // value of the pixels that have not been written
+	cv::Mat _background; // 1x1 image of the background value, for reading it as a pixel
+	int _tileSize;
+	int _tilesX, _tilesY;
+	int _numTiles;
+	std::vector<cv::Mat> _tiles; // row major, empty until something is written to the tile
+};
+
+#endif // !TILED_IMAGE_H
@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <opencv2/core.hpp>
+
+#include "raster.h"
+#include "segmentIndex.h"
+#include "tiledImage.h"
+
+#ifndef TOOLPATH_H
+#define TOOLPATH_H
+
+///////////////////////////////////////  Toolpath  ///////////////////////////////////////
+// Centerlines of the rods of a layer as polylines of any shape, in the pixel coordinates of the layer's image. Each line of a
+// polyline is a segment, and the segments are indexed by their bounding boxes (see SegmentIndex), so the segment an edge point
+// belongs to and its offset from the centerline are found in O(log n) for serpentine rasters and non-rectilinear scaffolds alike.
+class Toolpath
+{
+public:
+	struct Line {
+		cv::Point2d p0, p1; // ends of the line in the direction of travel
+		int polyline; // index of the polyline the line is part of
+	};
+
+	Toolpath() : _width(0) {}
+
+	/**
+	 * @param[in] polylines Centerlines of the rods in [px]
+	 * @param[in] width Width of the rods in [px]
+	*/
+	Toolpath(const std::vector<std::vector<cv::Point2d>>& polylines, double width);
+
+	/// @brief Toolpath of a layer of a raster
+	static Toolpath fromRaster(const Raster& raster, int layer);
+
+	/**
+	 * @brief Toolpath of a path file loaded by readPath(). The first two columns of each row are the x and y of a waypoint in [mm].
+	 * The path files have no extrusion column, so the rows are split into printed polylines on the moves between waypoints that are
+	 * further apart than the waypoint spacing, which are travel moves, and on the corners of the path, so each rod is its own polyline
+	 * @param[in] origin Position in [mm] of the pixel (0, 0) of the layer's image
+	 * @param[in] width Width of the rods in [mm]
+	 * @param[in] wayptSpc Spacing of the waypoints along the rods in [mm], as read by readPath()
+	*/
+	static Toolpath fromPath(const std::deque<std::vector<double>>& path, cv::Point2d origin, double width, double wayptSpc);
+
+	/**
+	 * @brief Nearest segment to a point
+	 * @param[in] maxDist Segments further than this in [px] are ignored
+	 * @param[out] offset Signed distance in [px] from the centerline of the segment. Positive on the side of the segment where
+	 * (p1 - p0) x (pt - p0) > 0, which is the left of the direction of travel in an image flipped to have the origin in the lower left corner
+	 * @return Index of the segment. -1 if no segment is within maxDist
+	*/
+	int nearest(const cv::Point2d& pt, double maxDist, double& offset) const;
+
+	/**
+	 * @brief Assigns edge points to the nearest segment
+	 * @param[in] margin Distance in [px] past the edges of the rods that a point can be from its segment
+	 * @param[out] segs Segment of each point. -1 for the points that are further than half the width plus the margin from every segment
+	*/
+	void assign(const std::vector<cv::Point2f>& pts, double margin, std::vector<int>& segs) const;
+
+	/// @brief Draws the centerlines, e.g. with the rod width to make the edge boundary of the layer
+	void draw(TiledImage& image, const cv::Scalar& color, int thickness = 1) const;
+
+	int numSegments() const { return (int)_lines.size(); }
+	const Line& segment(int seg) const { return _lines[seg]; }
+	const std::vector<std::vector<cv::Point2d>>& polylines() const { return _polylines; }
+	const SegmentIndex& index() const { return _index; }
+	double width() const { return _width; }
+
+	/**
+	 * @brief Distance from a point to a line
+	 * @param[out] offset Signed distance from the infinite line through the segment, as for nearest()
+	*/
+	static double lineDistance(const cv::Point2d& pt, const Line& line, double& offset);
+
+private:
+	std::vector<std::vector<cv::Point2d>> _polylines;
+	std::vector<Line> _lines;
+	double _width;
+	SegmentIndex _index; // over the bounding boxes of the lines grown by half the width
+};
+
+#endif // !TOOLPATH_H
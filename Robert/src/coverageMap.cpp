@@ -0,0 +1,40 @@
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "coverageMap.h"
+
+#define MAX_SWEEP_ROTATION 5.0 // maximum change in the scanner angle in [deg] between consecutive scans of a sweep
+
+void CoverageMap::reset(cv::Size size) {
+	_map = cv::Mat::zeros(size, CV_8UC1);
+	_hasPrev = false;
+}
+
+void CoverageMap::addScan(const cv::Point& start, const cv::Point& end, double T) {
+	if (_hasPrev && cv::norm(start - _prevStart) <= _maxGap && cv::norm(end - _prevEnd) <= _maxGap && fabs(T - _prevT) < MAX_SWEEP_ROTATION) {
+		// fill in the quadrilateral swept between the two scans
+		cv::Point pts[4] = { _prevStart, _prevEnd, end, start };
+		cv::fillConvexPoly(_map, pts, 4, cv::Scalar(255));
+	}
+	else {
+		cv::line(_map, start, end, cv::Scalar(255));
+	}
+	_prevStart = start;
+	_prevEnd = end;
+	_prevT = T;
+	_hasPrev = true;
+}
+
+void CoverageMap::clear(const cv::Rect& roi) {
+	cv::Rect r = roi & cv::Rect(cv::Point(0, 0), _map.size());
+
+	if (r.area() > 0) { _map(r).setTo(0); }
+}
+
+double CoverageMap::fraction(const cv::Rect& roi) const {
+	cv::Rect r = roi & cv::Rect(cv::Point(0, 0), _map.size());
+
+	if (r.area() == 0) { return 1; }
+	return (double)cv::countNonZero(_map(r)) / r.area();
+}
@@ -1,6 +1,7 @@
 #include "draw.h"
 #include <iostream>
 #include "constants.h"
+#include "resolution.h"
 #include "myTypes.h"
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
@@ -24,7 +25,7 @@ void addScale(cv::Mat& image, double length, cv::Point offset, double fontScale)
 	char buff[50];
 	snprintf(buff, sizeof(buff), "%gmm", length);
 	cv::putText(image, buff, location, cv::FONT_HERSHEY_SIMPLEX, fontScale, cv::Scalar(255, 255, 255, 255), 1, cv::LINE_8);
-	cv::rectangle(image, cv::Rect(location.x + 6, location.y + 5, MM2PIX(length), MM2PIX(0.5)), cv::Scalar(255, 255, 255, 255), -1);
+	cv::rectangle(image, cv::Rect(location.x + 6, location.y + 5, resolution.toPix(length), resolution.toPix(0.5)), cv::Scalar(255, 255, 255, 255), -1);
 }
 
 void drawEdges(cv::Mat src, cv::Mat&  dst, cv::Mat edges, const cv::Scalar& color, const int pointSz) {
@@ -50,6 +51,21 @@ void drawEdges(cv::Mat src, cv::Mat&  dst, cv::Mat edges, const cv::Scalar& colo
 	}
 }
 
+void drawEdges(cv::Mat src, cv::Mat& dst, const std::vector<cv::Point>& edgePts, const cv::Scalar& color, const int pointSz) {
+
+	// copy the source to the destination
+	src.copyTo(dst);
+	if (dst.channels() < 3) {
+		cv::cvtColor(dst, dst, cv::COLOR_GRAY2BGR);
+	}
+
+	for (auto it = edgePts.begin(); it != edgePts.end(); ++it) {
+		// show the edges as filled circles or as pixels
+		if (pointSz > 0) { cv::circle(dst, *it, pointSz, color, -1, cv::LINE_AA); }
+		else { dst(cv::Rect(*it, cv::Size(1, 1))).setTo(color); }
+	}
+}
+
 void drawErrors(cv::Mat src, cv::Mat& dst, std::vector<Segment>& seg, int layer) {
 	std::vector<cv::Point> allEdgePts, actCenterline, lEdgeErr, rEdgeErr;
 	cv::Mat tempLines= cv::Mat::zeros(src.size(), CV_8UC3);
@@ -76,9 +92,9 @@ void drawErrors(cv::Mat src, cv::Mat& dst, std::vector<Segment>& seg, int layer)
 			if (!(*it).errCL().empty() && !(*it).errWD().empty()) {
 				for (int i = 0; i < (*it).errCL().size(); i++) {
 					if (!isnan((*it).errCL()[i]) && !isnan((*it).errWD()[i])) {
-						actCenterline.push_back((*it).waypoints()[i] + cv::Point(0, MM2PIX((*it).errCL()[i])));
-						lEdgeErr.push_back(actCenterline.back() - cv::Point(0, MM2PIX((*it).errWD()[i] / 2)));
-						rEdgeErr.push_back(actCenterline.back() + cv::Point(0, MM2PIX((*it).errWD()[i] / 2)));
+						actCenterline.push_back((*it).waypoints()[i] + cv::Point(0, resolution.toPix((*it).errCL()[i])));
+						lEdgeErr.push_back(actCenterline.back() - cv::Point(0, resolution.toPix((*it).errWD()[i] / 2)));
+						rEdgeErr.push_back(actCenterline.back() + cv::Point(0, resolution.toPix((*it).errWD()[i] / 2)));
 					}
 				}
 				// Draw the errors
@@ -138,10 +154,10 @@ void drawMaterial(cv::Mat src, cv::Mat& dst, std::vector<Segment>& seg, std::vec
 				for (int i = 0; i < (*it).errCL().size(); i++) {
 					if (!isnan((*it).errCL()[i]) && !isnan((*it).errWD()[i])) {
 						if (printDir::X((*it).dir())) {
-							actCenterline.push_back((*it).waypoints()[i] + cv::Point(0, MM2PIX((*it).errCL()[i])));
+							actCenterline.push_back((*it).waypoints()[i] + cv::Point(0, resolution.toPix((*it).errCL()[i])));
 						}
 						else if (printDir::Y((*it).dir())) {
-							actCenterline.push_back((*it).waypoints()[i] + cv::Point(MM2PIX((*it).errCL()[i]), 0));
+							actCenterline.push_back((*it).waypoints()[i] + cv::Point(resolution.toPix((*it).errCL()[i]), 0));
 						}
 						
 
@@ -152,19 +168,19 @@ void drawMaterial(cv::Mat src, cv::Mat& dst, std::vector<Segment>& seg, std::vec
 			}
 			// Draw the desired material
 			// Draw circle at the both ends of the segment
-			cv::circle(matlDes, (*it).waypoints().front(), MM2PIX(path[segNum].front().w / 2), colorMatlDes, -1);
-			cv::circle(matlDes, (*it).waypoints().back(), MM2PIX(path[segNum].back().w / 2), colorMatlDes, -1);
+			cv::circle(matlDes, (*it).waypoints().front(), resolution.toPix(path[segNum].front().w / 2), colorMatlDes, -1);
+			cv::circle(matlDes, (*it).waypoints().back(), resolution.toPix(path[segNum].back().w / 2), colorMatlDes, -1);
 			// loop through all the waypoints
 			for (int j = 0; j < path[segNum].size(); j++) {
 				if (printDir::X((*it).dir())) {
-					lEdge.push_back((*it).waypoints()[j] - cv::Point(0, MM2PIX(path[segNum][j].w / 2)));
-					rEdge.push_back((*it).waypoints()[j] + cv::Point(0, MM2PIX(path[segNum][j].w / 2)));
+					lEdge.push_back((*it).waypoints()[j] - cv::Point(0, resolution.toPix(path[segNum][j].w / 2)));
+					rEdge.push_back((*it).waypoints()[j] + cv::Point(0, resolution.toPix(path[segNum][j].w / 2)));
 				}
 				else if (printDir::Y((*it).dir())) {
-					lEdge.push_back((*it).waypoints()[j] - cv::Point(MM2PIX(path[segNum][j].w / 2), 0));
-					rEdge.push_back((*it).waypoints()[j] + cv::Point(MM2PIX(path[segNum][j].w / 2), 0));
+					lEdge.push_back((*it).waypoints()[j] - cv::Point(resolution.toPix(path[segNum][j].w / 2), 0));
+					rEdge.push_back((*it).waypoints()[j] + cv::Point(resolution.toPix(path[segNum][j].w / 2), 0));
 				}
-				minW = (MM2PIX(path[segNum][j].w) < minW) ? MM2PIX(path[segNum][j].w) : minW;
+				minW = (resolution.toPix(path[segNum][j].w) < minW) ? resolution.toPix(path[segNum][j].w) : minW;
 			}
 			allEdgePts.reserve(lEdge.size() + rEdge.size()); // preallocate memory
 			allEdgePts.insert(allEdgePts.end(), lEdge.begin(), lEdge.end());
@@ -227,8 +243,8 @@ void drawSegments(cv::Mat src, cv::Mat& dst, std::vector<Segment>& seg, cv::Poin
 			}
 			// Draw and label the scan done point
 			snprintf(buff, sizeof(buff), "%u", segNum);
-			ScanDonePt = cv::Point(MM2PIX((*it).scanDonePt().x - origin.x), MM2PIX((*it).scanDonePt().y - origin.y));
-			if (it != seg.begin() && ScanDonePt == cv::Point(MM2PIX((*std::prev(it)).scanDonePt().x - origin.x), MM2PIX((*std::prev(it)).scanDonePt().y - origin.y))) {
+			ScanDonePt = cv::Point(resolution.toPix((*it).scanDonePt().x - origin.x), resolution.toPix((*it).scanDonePt().y - origin.y));
+			if (it != seg.begin() && ScanDonePt == cv::Point(resolution.toPix((*std::prev(it)).scanDonePt().x - origin.x), resolution.toPix((*std::prev(it)).scanDonePt().y - origin.y))) {
 				samePtCnt++;
 				textSz = cv::getTextSize(buff, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseline);
 				cv::putText(dst, buff, ScanDonePt + cv::Point(pointSz + samePtCnt * textSz.width, -2), cv::FONT_HERSHEY_SIMPLEX, 0.5, color, 1, cv::LINE_8);
@@ -285,19 +301,19 @@ void drawMaterialSegments(cv::Mat src, cv::Mat& dst, std::vector<Segment>& seg,
 
 				// Draw the desired material
 				// Draw circle at the both ends of the segment
-				cv::circle(matlSeg, (*it).waypoints().front(), MM2PIX(path[segNum].front().w / 2), color, -1);
-				cv::circle(matlSeg, (*it).waypoints().back(), MM2PIX(path[segNum].back().w / 2), color, -1);
+				cv::circle(matlSeg, (*it).waypoints().front(), resolution.toPix(path[segNum].front().w / 2), color, -1);
+				cv::circle(matlSeg, (*it).waypoints().back(), resolution.toPix(path[segNum].back().w / 2), color, -1);
 				// loop through all the waypoints
 				for (int j = 0; j < path[segNum].size(); j++) {
 					if (printDir::X((*it).dir())) {
-						lEdge.push_back((*it).waypoints()[j] - cv::Point(0, MM2PIX(path[segNum][j].w / 2)));
-						rEdge.push_back((*it).waypoints()[j] + cv::Point(0, MM2PIX(path[segNum][j].w / 2)));
+						lEdge.push_back((*it).waypoints()[j] - cv::Point(0, resolution.toPix(path[segNum][j].w / 2)));
+						rEdge.push_back((*it).waypoints()[j] + cv::Point(0, resolution.toPix(path[segNum][j].w / 2)));
 					}
 					else if (printDir::Y((*it).dir())) {
-						lEdge.push_back((*it).waypoints()[j] - cv::Point(MM2PIX(path[segNum][j].w / 2), 0));
-						rEdge.push_back((*it).waypoints()[j] + cv::Point(MM2PIX(path[segNum][j].w / 2), 0));
+						lEdge.push_back((*it).waypoints()[j] - cv::Point(resolution.toPix(path[segNum][j].w / 2), 0));
+						rEdge.push_back((*it).waypoints()[j] + cv::Point(resolution.toPix(path[segNum][j].w / 2), 0));
 					}
-					minW = (MM2PIX(path[segNum][j].w) < minW) ? MM2PIX(path[segNum][j].w) : minW;
+					minW = (resolution.toPix(path[segNum][j].w) < minW) ? resolution.toPix(path[segNum][j].w) : minW;
 
 				}
 
@@ -351,7 +367,7 @@ void drawOutlines(cv::Mat src, cv::Mat& dst, std::vector<Segment>& seg, int laye
 			if (!(*it).errCL().empty() && !(*it).errWD().empty()) {
 				for (int i = 0; i < (*it).errCL().size(); i++) {
 					if (!isnan((*it).errCL()[i]) && !isnan((*it).errWD()[i])) {
-						actCenterline.push_back((*it).waypoints()[i] + cv::Point(0, MM2PIX((*it).errCL()[i])));
+						actCenterline.push_back((*it).waypoints()[i] + cv::Point(0, resolution.toPix((*it).errCL()[i])));
 					}
 				}
 				// Draw the actual centerline
@@ -0,0 +1,205 @@
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "edgeBoundary.h"
+#include "constants.h"
+#include "resolution.h"
+#include "raster.h"
+
+EdgeBoundary::EdgeBoundary(const Raster& raster, int layer)
+	: _numPrior(0) {
+	cv::Point lo, hi;
+	Rod rod;
+
+	_halfWidth = resolution.toPix(raster.rodWidth()) / 2.0;
+	_binLength = std::max(1, (int)resolution.toPix(raster.rodWidth()));
+	_mask = raster.boundaryMask(layer).clone();
+	// the lines of the raster path are axis aligned, so each one drawn with the rod width covers a rectangle across the line
+	// and a round cap at each of its ends
+	_corners = raster.px(layer);
+	for (size_t i = 1; i < _corners.size(); i++) {
+		lo = cv::Point(std::min(_corners[i - 1].x, _corners[i].x), std::min(_corners[i - 1].y, _corners[i].y));
+		hi = cv::Point(std::max(_corners[i - 1].x, _corners[i].x), std::max(_corners[i - 1].y, _corners[i].y));
+		rod.horizontal = (lo.y == hi.y);
+		if (rod.horizontal) { rod.body = cv::Rect2d(lo.x, lo.y - _halfWidth, hi.x - lo.x, 2 * _halfWidth); }
+		else { rod.body = cv::Rect2d(lo.x - _halfWidth, lo.y, 2 * _halfWidth, hi.y - lo.y); }
+		_rods.push_back(rod);
+	}
+}
+
+int EdgeBoundary::setPrior(const std::vector<cv::Point2f>& priorEdges, int margin) {
+	std::vector<std::vector<float>> low, high; // earlier edges on each side of the line in each bin
+	double along, across, center, length;
+	int numBins, bin;
+	cv::Rect imageRect(cv::Point(0, 0), _mask.size());
+
+	_numPrior = 0;
+	for (Rod& rod : _rods) {
+		// bins along the line, leaving out the ends where the rod meets the caps and the neighbouring lines
+		rod.start = (rod.horizontal ? rod.body.x : rod.body.y) + _halfWidth;
+		length = (rod.horizontal ? rod.body.width : rod.body.height) - 2 * _halfWidth;
+		center = rod.horizontal ? rod.body.y + _halfWidth : rod.body.x + _halfWidth;
+		numBins = (length > 0) ? (int)(length / _binLength) : 0;
+		rod.bins.assign(numBins, cv::Vec2f(1, 0));
+		if (numBins == 0) { continue; }
+		low.assign(numBins, {});
+		high.assign(numBins, {});
+
+		for (const cv::Point2f& pt : priorEdges) {
+			along = rod.horizontal ? pt.x : pt.y;
+			across = rod.horizontal ? pt.y : pt.x;
+			if (along < rod.start || std::abs(across - center) > _halfWidth) { continue; }
+			bin = (int)((along - rod.start) / _binLength);
+			if (bin >= numBins) { continue; }
+			if (across < center) { low[bin].push_back((float)across); }
+			else { high[bin].push_back((float)across); }
+		}
+
+		for (bin = 0; bin < numBins; bin++) {
+			if (low[bin].empty() || high[bin].empty()) { continue; }
+			std::nth_element(low[bin].begin(), low[bin].begin() + low[bin].size() / 2, low[bin].end());
+			std::nth_element(high[bin].begin(), high[bin].begin() + high[bin].size() / 2, high[bin].end());
+			rod.bins[bin][0] = (float)std::max(center - _halfWidth, (double)low[bin][low[bin].size() / 2] - margin);
+			rod.bins[bin][1] = (float)std::min(center + _halfWidth, (double)high[bin][high[bin].size() / 2] + margin);
+			_numPrior++;
+
+			// clear the mask on either side of the narrowed window
+			int a = (int)std::ceil(rod.start + bin * _binLength), b = (int)std::ceil(rod.start + (bin + 1) * _binLength);
+			int lo = (int)std::floor(center - _halfWidth) - 1, hi = (int)std::ceil(center + _halfWidth) + 1;
+			int winLo = (int)std::ceil(rod.bins[bin][0]), winHi = (int)std::floor(rod.bins[bin][1]);
+			cv::Rect sides[2] = {
+				rod.horizontal ? cv::Rect(a, lo, b - a, winLo - lo) : cv::Rect(lo, a, winLo - lo, b - a),
+				rod.horizontal ? cv::Rect(a, winHi + 1, b - a, hi - winHi) : cv::Rect(winHi + 1, a, hi - winHi, b - a) };
+			for (cv::Rect side : sides) {
+				side &= imageRect;
+				if (side.area() > 0) { _mask(side).setTo(0); }
+			}
+		}
+	}
+	return _numPrior;
+}
+
+// One side of the Liang-Barsky clipping of the line p(s) = p0 + s * d. Narrows [s0, s1] to where p * s <= q
+static bool clipSide(double p, double q, double& s0, double& s1) {
+	if (p == 0) { return q >= 0; }
+	double s = q / p;
+	if (p < 0) {
+		if (s > s1) { return false; }
+		s0 = std::max(s0, s);
+	}
+	else {
+		if (s < s0) { return false; }
+		s1 = std::min(s1, s);
+	}
+	return true;
+}
+
+void EdgeBoundary::windows(cv::Point scanStart, cv::Point scanEnd, std::vector<int>& windowPts) const {
+	windowPts.clear();
+	if (!analytic()) {
+		_maskWindows(scanStart, scanEnd, windowPts);
+		return;
+	}
+
+	// a cv::LineIterator with 8-connectivity takes one step along the major axis for each point, so point i is at s = i / last
+	cv::Point2d d = scanEnd - scanStart;
+	int last = (int)std::max(std::abs(d.x), std::abs(d.y)); // index of the last point of the scan
+	double s0, s1, a, b, c, disc;
+	if (last == 0) { return; }
+
+	// adds the points of the scan in [s0, s1], keeping the windows sorted by their first point
+	auto addWindow = [&](double s0, double s1) {
+		const double eps = 1e-9;
+		int rise = (int)std::ceil(s0 * last - eps);
+		int fall = (int)std::floor(s1 * last + eps) + 1;
+		if (rise >= fall) { return; }
+		size_t k = windowPts.size();
+		while (k > 0 && windowPts[k - 2] > rise) { k -= 2; }
+		windowPts.insert(windowPts.begin() + k, { rise, fall });
+	};
+
+	// part of the scan inside a rectangle
+	auto clipRect = [&](const cv::Rect2d& rect, double& s0, double& s1) {
+		s0 = 0;
+		s1 = 1;
+		return clipSide(-d.x, scanStart.x - rect.x, s0, s1) && clipSide(d.x, rect.x + rect.width - scanStart.x, s0, s1) &&
+			clipSide(-d.y, scanStart.y - rect.y, s0, s1) && clipSide(d.y, rect.y + rect.height - scanStart.y, s0, s1);
+	};
+
+	// part of the scan across each rod
+	for (const Rod& rod : _rods) {
+		if (!clipRect(rod.body, s0, s1)) { continue; }
+		if (!rod.bins.empty()) {
+			// narrow the window to the earlier edges of the bin where the scan crosses the line
+			double along = rod.horizontal ? scanStart.x + (s0 + s1) / 2 * d.x : scanStart.y + (s0 + s1) / 2 * d.y;
+			int bin = (int)std::floor((along - rod.start) / _binLength);
+			if (bin >= 0 && bin < (int)rod.bins.size() && rod.bins[bin][0] <= rod.bins[bin][1]) {
+				cv::Rect2d narrowed = rod.horizontal ? cv::Rect2d(rod.body.x, rod.bins[bin][0], rod.body.width, rod.bins[bin][1] - rod.bins[bin][0])
+					: cv::Rect2d(rod.bins[bin][0], rod.body.y, rod.bins[bin][1] - rod.bins[bin][0], rod.body.height);
+				if (!clipRect(narrowed, s0, s1)) { continue; }
+			}
+		}
+		addWindow(s0, s1);
+	}
+	// part of the scan inside each round cap, from |scanStart + s * d - corner| <= halfWidth
+	a = d.dot(d);
+	for (const cv::Point& corner : _corners) {
+		cv::Point2d p = cv::Point2d(scanStart - corner);
+		b = d.dot(p);
+		c = p.dot(p) - _halfWidth * _halfWidth;
+		disc = b * b - a * c;
+		if (disc < 0) { continue; }
+		disc = std::sqrt(disc);
+		s0 = std::max(0.0, (-b - disc) / a);
+		s1 = std::min(1.0, (-b + disc) / a);
+		if (s0 <= s1) { addWindow(s0, s1); }
+	}
+
+	// merge the windows that overlap or touch, e.g. a rod and the connector at its end
+	size_t n = 0;
+	for (size_t k = 0; k < windowPts.size(); k += 2) {
+		if (n > 0 && windowPts[k] <= windowPts[n - 1]) {
+			windowPts[n - 1] = std::max(windowPts[n - 1], windowPts[k + 1]);
+		}
+		else {
+			windowPts[n++] = windowPts[k];
+			windowPts[n++] = windowPts[k + 1];
+		}
+	}
+	windowPts.resize(n);
+
+	// drop the windows that the scan starts or ends in, as there is no edge of the mask on the scan to start or stop them
+	if (!windowPts.empty() && windowPts.back() > last) { windowPts.resize(windowPts.size() - 2); }
+	if (!windowPts.empty() && windowPts.front() == 0) { windowPts.erase(windowPts.begin(), windowPts.begin() + 2); }
+}
+
+void EdgeBoundary::_maskWindows(cv::Point scanStart, cv::Point scanEnd, std::vector<int>& windowPts) const {
+	cv::LineIterator lineit(_mask, scanStart, scanEnd, 8);
+	uchar lastVal = 0;
+	uchar curVal = 0;
+	int numRising = 0, numFalling = 0;
+
+	// find the intersection of the scan and the edge boundary using a line iterator
+	for (int i = 0; i < lineit.count; i++, ++lineit) {
+		curVal = *(const uchar*)*lineit;
+		if ((curVal == 255) && (lastVal == 0) && (i != 0)) { // find rising edges
+			windowPts.push_back(i);
+			numRising++;
+		}
+		if ((curVal == 0) && (lastVal == 255) && (i != 0) && (numRising > 0)) { // find falling edges
+			windowPts.push_back(i);
+			numFalling++;
+		}
+		lastVal = curVal;
+	}
+	// Check if equal number of rising and falling edges (i.e. an odd number of window points)
+	if ((windowPts.size() % 2) != 0) {
+		// if scan ends in the middle of a rod, remove the last point; Otherwise, scan start in the middle of a rod so remove the first point
+		if (numRising > numFalling) { windowPts.pop_back(); }
+		else { windowPts.erase(windowPts.begin()); }
+	}
+}
@@ -0,0 +1,99 @@
+#include <vector>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+#include "edgeStore.h"
+#include "myTypes.h"
+
+// Orders points by the row then column of the pixel they round to
+static bool rowMajor(const cv::Point2f& pt1, const cv::Point2f& pt2) {
+	cv::Point pix1 = pt1, pix2 = pt2;
+	return (pix1.y < pix2.y) || (pix1.y == pix2.y && pix1.x < pix2.x);
+}
+
+EdgeStore::EdgeStore(const std::vector<Segment>& segments, int margin)
+	: _margin(margin), _firstLayer(0) {
+	int numLayers, l;
+	cv::Rect roi;
+
+	if (segments.empty()) { return; }
+	_firstLayer = segments.front().layer();
+	numLayers = segments.back().layer() - _firstLayer + 1;
+	_indexes.resize(numLayers);
+	_layerSegs.resize(numLayers);
+	_layerPts.resize(numLayers);
+	_buckets.resize(segments.size());
+	_merged.resize(segments.size());
+	_sorted.resize(segments.size(), true);
+	std::vector<std::vector<cv::Rect2d>> boxes(numLayers);
+
+	// grown ROIs of each layer
+	for (int i = 0; i < segments.size(); i++) {
+		l = segments[i].layer() - _firstLayer;
+		roi = segments[i].ROI() + cv::Point(-_margin, -_margin) + cv::Size(2 * _margin, 2 * _margin);
+		boxes[l].push_back(cv::Rect2d(roi));
+		_layerSegs[l].push_back(i);
+	}
+	for (l = 0; l < numLayers; l++) { _indexes[l] = SegmentIndex(boxes[l]); }
+}
+
+void EdgeStore::add(const std::vector<cv::Point2f>& pts, int layer) {
+	int l = layer - _firstLayer;
+	std::vector<int> hits;
+	cv::Point pix;
+
+	if (l < 0 || l >= _indexes.size()) { return; }
+	_layerPts[l].insert(_layerPts[l].end(), pts.begin(), pts.end());
+
+	for (auto& pt : pts) {
+		pix = pt;
+		// the ROIs have integer corners, so the boxes that contain the pixel are the ROIs that contain it
+		_indexes[l].query(cv::Point2d(pix), hits);
+		for (int id : hits) {
+			int seg = _layerSegs[l][id];
+			_buckets[seg].push_back(pt);
+			_sorted[seg] = false;
+		}
+	}
+}
+
+void EdgeStore::add(const std::vector<cv::Point>& pts, int layer) {
+	add(std::vector<cv::Point2f>(pts.begin(), pts.end()), layer);
+}
+
+const std::vector<cv::Point2f>& EdgeStore::points(int segNum) {
+	std::vector<cv::Point2f>& bucket = _buckets[segNum];
+	std::vector<cv::Point2f>& merged = _merged[segNum];
+	cv::Point2d sum;
+	size_t last;
+
+	if (!_sorted[segNum]) {
+		// the same edge can be found by several scans, so the points in each pixel are merged. The bucket keeps every point
+		// so the mean is not skewed when more points are added later
+		std::sort(bucket.begin(), bucket.end(), rowMajor);
+		merged.clear();
+		for (size_t first = 0; first < bucket.size(); first = last) {
+			sum = bucket[first];
+			for (last = first + 1; last < bucket.size() && cv::Point(bucket[last]) == cv::Point(bucket[first]); last++) { sum += cv::Point2d(bucket[last]); }
+			merged.push_back(sum / (double)(last - first));
+		}
+		_sorted[segNum] = true;
+	}
+	return merged;
+}
+
+const std::vector<cv::Point2f>& EdgeStore::layerPoints(int layer) const {
+	static const std::vector<cv::Point2f> empty;
+	int l = layer - _firstLayer;
+	return (l < 0 || l >= _layerPts.size()) ? empty : _layerPts[l];
+}
+
+void EdgeStore::draw(TiledImage& image, int layer) const {
+	cv::Rect imageRect(cv::Point(0, 0), image.size());
+	cv::Point pix;
+
+	for (auto& pt : layerPoints(layer)) {
+		pix = pt;
+		if (imageRect.contains(pix)) { image.at<uchar>(pix) = 255; }
+	}
+}
@@ -4,29 +4,126 @@
 #include <iterator> 
 #include <algorithm>
 #include <cmath>
+#include <cfloat>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 
 #include "myGlobals.h"
 #include "constants.h"
+#include "resolution.h"
 #include "gaussianSmooth.h"
+#include "segmentIndex.h"
 
 struct sortX {
-	bool operator() (cv::Point pt1, cv::Point pt2) { return (pt1.x < pt2.x); }
+	bool operator() (cv::Point2f pt1, cv::Point2f pt2) { return (pt1.x < pt2.x); }
 }; 
 
 struct sortDist {
-	sortDist(cv::Point pt0) { this->pt0 = pt0; }
-	bool operator() (cv::Point pt1, cv::Point pt2) { return (cv::norm(pt0-pt1) < cv::norm(pt0 - pt2)); }
-	cv::Point pt0;
+	sortDist(cv::Point2f pt0) { this->pt0 = pt0; }
+	bool operator() (cv::Point2f pt1, cv::Point2f pt2) { return (cv::norm(pt0-pt1) < cv::norm(pt0 - pt2)); }
+	cv::Point2f pt0;
 };
 
-void getMatlEdges(const cv::Rect& segmentROI, const int dir, const cv::Mat& gblEdges, std::vector<cv::Point>& lEdgePts, std::vector<cv::Point>& rEdgePts) {
-	std::vector<cv::Point> unfiltLeft, unfiltRight;
-	cv::Mat edgePts = cv::Mat(gblEdges.size(), CV_8UC1, cv::Scalar(0));
-	cv::Mat mask = cv::Mat(gblEdges.size(), CV_8UC1, cv::Scalar(0));
-	cv::Mat morphKern = cv::Mat::ones(MM2PIX(0.25), MM2PIX(0.25), CV_8UC1);
+/**
+ * @brief Finds the edge points that are under a mask made by dilating the curve
+*/
+static void edgePtsNear(const std::vector<cv::Point2f>& curve, const std::vector<cv::Point2f>& edgePts, const cv::Mat& morphKern, std::vector<cv::Point2f>& nearPts) {
+	std::vector<cv::Point> localCurve(curve.begin(), curve.end()); // the mask is drawn in whole pixels
+	cv::Rect maskRect;
+	cv::Point pix;
+	cv::Mat mask;
+
+	nearPts.clear();
+	if (curve.empty()) { return; }
+	// only make the mask around the curve instead of the whole raster image
+	maskRect = cv::boundingRect(localCurve);
+	maskRect = maskRect + cv::Point(-morphKern.cols, -morphKern.rows) + cv::Size(2 * morphKern.cols, 2 * morphKern.rows);
+	mask = cv::Mat::zeros(maskRect.size(), CV_8UC1);
+	for (auto it = localCurve.begin(); it != localCurve.end(); ++it) { *it -= maskRect.tl(); }
+	// draw the points as a line and then dialate the line to form a mask
+	cv::polylines(mask, localCurve, false, cv::Scalar(255), 1);
+	cv::morphologyEx(mask, mask, cv::MORPH_DILATE, morphKern, cv::Point(-1, -1), 1);
+	// keep the points under the mask
+	for (auto it = edgePts.begin(); it != edgePts.end(); ++it) {
+		pix = *it;
+		if (maskRect.contains(pix) && mask.at<uchar>(pix - maskRect.tl()) != 0) { nearPts.push_back(*it); }
+	}
+}
+
+/**
+ * @brief Distance from a point to the closest point on the line from a to b
+*/
+static double distToLine(const cv::Point2d& pt, const cv::Point2d& a, const cv::Point2d& b) {
+	cv::Point2d ab = b - a;
+	double len2 = ab.dot(ab);
+	double t = (len2 > 0) ? std::clamp((pt - a).dot(ab) / len2, 0.0, 1.0) : 0;
+	return cv::norm(pt - (a + t * ab));
+}
+
+/**
+ * @brief Polyline with an R-tree (see SegmentIndex) over the bounding boxes of runs of its lines, so the distance from a point to the
+ * curve only measures the lines of the runs near the point. The points of an edge follow each other, so a run of lines has a small box
+ * and making the index costs little more than one pass over the points
+*/
+class IndexedCurve
+{
+public:
+	IndexedCurve(const std::vector<cv::Point2f>& curve) : _curve(curve) {
+		std::vector<cv::Rect2d> boxes;
+		int numLines = (int)curve.size() - 1;
+		cv::Point2d lo, hi;
+
+		for (int first = 0; first < numLines; first += RUN_LINES) {
+			lo = hi = curve[first];
+			for (int i = first + 1; i <= std::min(first + RUN_LINES, numLines); i++) {
+				lo = cv::Point2d(std::min(lo.x, (double)curve[i].x), std::min(lo.y, (double)curve[i].y));
+				hi = cv::Point2d(std::max(hi.x, (double)curve[i].x), std::max(hi.y, (double)curve[i].y));
+			}
+			boxes.push_back(cv::Rect2d(lo, hi));
+		}
+		_index = SegmentIndex(boxes);
+	}
+
+	/// @brief Distance from a point to the closest point on the curve. DBL_MAX if the curve is empty
+	double distance(const cv::Point2d& pt) const {
+		int numLines = (int)_curve.size() - 1;
+		double dist;
+
+		if (_curve.empty()) { return DBL_MAX; }
+		if (_curve.size() == 1) { return cv::norm(pt - cv::Point2d(_curve.front())); }
+		_index.nearest(pt, DBL_MAX, [&](int run) {
+			double runDist = DBL_MAX;
+			for (int i = run * RUN_LINES; i < std::min((run + 1) * RUN_LINES, numLines); i++) { runDist = std::min(runDist, distToLine(pt, _curve[i], _curve[i + 1])); }
+			return runDist;
+			}, dist);
+		return dist;
+	}
+
+private:
+	static const int RUN_LINES = 16; // lines in each box of the index
+
+	const std::vector<cv::Point2f>& _curve;
+	SegmentIndex _index; // run r has the lines from point r * RUN_LINES to point (r + 1) * RUN_LINES
+};
+
+void getMatlEdges(const cv::Rect& segmentROI, const int dir, const cv::Mat& gblEdges, std::vector<cv::Point2f>& lEdgePts, std::vector<cv::Point2f>& rEdgePts) {
+	std::vector<cv::Point> edgePix;
+	std::vector<cv::Point2f> edgePts;
+	cv::Rect region = segmentROI + cv::Point(-MATL_EDGE_MARGIN, -MATL_EDGE_MARGIN) + cv::Size(2 * MATL_EDGE_MARGIN, 2 * MATL_EDGE_MARGIN);
+
+	// the points near the ROI are all that are needed to find the edges
+	region &= cv::Rect(cv::Point(0, 0), gblEdges.size());
+	cv::findNonZero(gblEdges(region), edgePix);
+	edgePts.reserve(edgePix.size());
+	for (auto it = edgePix.begin(); it != edgePix.end(); ++it) { edgePts.push_back(*it + region.tl()); }
+	getMatlEdges(segmentROI, dir, edgePts, lEdgePts, rEdgePts);
+}
+
+void getMatlEdges(const cv::Rect& segmentROI, const int dir, const std::vector<cv::Point2f>& edgePts, std::vector<cv::Point2f>& lEdgePts, std::vector<cv::Point2f>& rEdgePts) {
+	std::vector<cv::Point2f> unfiltLeft, unfiltRight;
+	cv::Mat morphKern = cv::Mat::ones(MATL_EDGE_MARGIN, MATL_EDGE_MARGIN, CV_8UC1);
 	cv::Rect lRegion, rRegion;
+	cv::Point pix;
 
 	// find the left and right edge points in the regions
 	if (printDir::X(dir)) {
@@ -39,11 +136,11 @@ void getMatlEdges(const cv::Rect& segmentROI, const int dir, const cv::Mat& gblE
 	}
 
 	// find the edges in the search regions
-	cv::findNonZero(gblEdges(lRegion), unfiltLeft);
-	cv::findNonZero(gblEdges(rRegion), unfiltRight);
-	// converting points back to global coordinates
-	for (auto it = unfiltLeft.begin(); it != unfiltLeft.end(); ++it) {*it += lRegion.tl();}
-	for (auto it = unfiltRight.begin(); it != unfiltRight.end(); ++it) {*it += rRegion.tl();}
+	for (auto it = edgePts.begin(); it != edgePts.end(); ++it) {
+		pix = *it;
+		if (lRegion.contains(pix)) { unfiltLeft.push_back(*it); }
+		if (rRegion.contains(pix)) { unfiltRight.push_back(*it); }
+	}
 	// Sort the edges
 	if (printDir::X(dir)) {
 		std::sort(unfiltLeft.begin(), unfiltLeft.end(), sortX());
@@ -59,12 +156,8 @@ void getMatlEdges(const cv::Rect& segmentROI, const int dir, const cv::Mat& gblE
 	// smooth out the raw points
 	if (printDir::X(dir)) { gaussianSmoothX(unfiltLeft, lEdgePts, 7, 2); }// 7, 3
 	else if (printDir::Y(dir)) { gaussianSmoothY(unfiltLeft, lEdgePts, 7, 2); }
-	// draw smoothed points as a line and then dialate the line to form a mask
-	cv::polylines(mask, lEdgePts, false, cv::Scalar(255), 1);
-	cv::morphologyEx(mask, mask, cv::MORPH_DILATE, morphKern, cv::Point(-1, -1), 1);
-	// copy raw points within the mask to remove outliers
-	gblEdges.copyTo(edgePts, mask);
-	cv::findNonZero(edgePts, unfiltLeft);
+	// keep the raw points close to the smoothed points to remove outliers
+	edgePtsNear(lEdgePts, edgePts, morphKern, unfiltLeft);
 	// smooth the points
 	if (printDir::X(dir)) {
 		std::sort(unfiltLeft.begin(), unfiltLeft.end(), sortX());
@@ -72,17 +165,10 @@ void getMatlEdges(const cv::Rect& segmentROI, const int dir, const cv::Mat& gblE
 	}
 	else if (printDir::Y(dir)) { gaussianSmoothY(unfiltLeft, lEdgePts, 3, 1); }
 
-	// reset all images
-	edgePts = cv::Scalar(0);
-	mask = cv::Scalar(0);
-	
 	// Right edge
 	if (printDir::X(dir)) { gaussianSmoothX(unfiltRight, rEdgePts, 7, 2); }
 	else if (printDir::Y(dir)) { gaussianSmoothY(unfiltRight, rEdgePts, 7, 2); }
-	cv::polylines(mask, rEdgePts, false, cv::Scalar(255), 1);
-	cv::morphologyEx(mask, mask, cv::MORPH_DILATE, morphKern, cv::Point(-1, -1), 1);
-	gblEdges.copyTo(edgePts, mask);
-	cv::findNonZero(edgePts, unfiltRight);
+	edgePtsNear(rEdgePts, edgePts, morphKern, unfiltRight);
 	if (printDir::X(dir)) {
 		std::sort(unfiltRight.begin(), unfiltRight.end(), sortX());
 		gaussianSmoothX(unfiltRight, rEdgePts, 3, 1);
@@ -91,43 +177,82 @@ void getMatlEdges(const cv::Rect& segmentROI, const int dir, const cv::Mat& gblE
 	
 }
 
+// Smallest rectangle containing the points, or an empty one if there are none
+static cv::Rect pointsBounds(const std::vector<cv::Point>& pts) {
+	return pts.empty() ? cv::Rect() : cv::boundingRect(pts);
+}
+
+/**
+ * @brief Draws the left and right edges and takes their distance transforms over only the part of the raster image that the edges and
+ * the query points are in. Every edge pixel is inside that part and the transform is exact, so the distances are the same as the
+ * distances on the whole image
+ * @param[in] queryBounds Rectangle around the points where the distances will be read
+ * @param[out] lDist, rDist Distances in [px] to the left and right edges over the returned region
+ * @return Region of the raster image that the distance images cover
+*/
+static cv::Rect edgeDistances(cv::Size rasterSize, const cv::Rect& queryBounds, const std::vector<cv::Point>& lEdgePts, const std::vector<cv::Point>& rEdgePts, cv::Mat& lDist, cv::Mat& rDist) {
+	cv::Rect crop = pointsBounds(lEdgePts) | pointsBounds(rEdgePts) | queryBounds;
+	std::vector<cv::Point> shifted;
+
+	// lines drawn between the edge points stay inside the bounding rectangle of the points
+	crop &= cv::Rect(cv::Point(0, 0), rasterSize);
+	lDist = cv::Mat(crop.size(), CV_8UC1, cv::Scalar(255)); // Image to draw the left edge on
+	rDist = cv::Mat(crop.size(), CV_8UC1, cv::Scalar(255)); // Image to draw the right edge on
+	if (crop.empty()) { return crop; }
+
+	// Draw the smoothed edges on an image
+	shifted.resize(lEdgePts.size());
+	std::transform(lEdgePts.begin(), lEdgePts.end(), shifted.begin(), [&crop](const cv::Point& pt) { return pt - crop.tl(); });
+	cv::polylines(lDist, shifted, false, cv::Scalar(0), 1);
+	shifted.resize(rEdgePts.size());
+	std::transform(rEdgePts.begin(), rEdgePts.end(), shifted.begin(), [&crop](const cv::Point& pt) { return pt - crop.tl(); });
+	cv::polylines(rDist, shifted, false, cv::Scalar(0), 1);
+	// apply a distance transform to the image with the smoothed edges
+	cv::distanceTransform(lDist, lDist, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F); //NOTE: regarding speed -  DIST_MASK_5 (3.9ms/rod) < DIST_MASK_PRECISE (4.7ms/rod) < DIST_MASK_3 (9.1ms/rod) on the whole raster image
+	cv::distanceTransform(rDist, rDist, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F);
+	return crop;
+}
+
 void getMatlErrors(std::vector<cv::Point>& centerline, double width, cv::Size rasterSize, const std::vector<cv::Point>& lEdgePts, const std::vector<cv::Point>& rEdgePts, std::vector<double>& errCL, std::vector<double>& errWD) {
-	cv::Mat lEdge = cv::Mat(rasterSize, CV_8UC1, cv::Scalar(255)); // Image to draw the left edge on
-	cv::Mat rEdge = cv::Mat(rasterSize, CV_8UC1, cv::Scalar(255)); // Image to draw the right edge on
-	cv::LineIterator lnit(lEdge, centerline.front(), centerline.back(), 8);
+	cv::Mat lEdge, rEdge; // distances to the left and right edges
+	cv::LineIterator lnit(rasterSize, centerline.front(), centerline.back(), 8);
+	cv::Rect crop = edgeDistances(rasterSize, cv::Rect(centerline.front(), centerline.back()) + cv::Size(1, 1), lEdgePts, rEdgePts, lEdge, rEdge);
+	cv::Point pix;
 	centerline.clear(); // clear the points in the centerline vector
 	errCL.clear(); // clear the errors
 	errWD.clear();
 	errCL.reserve(lnit.count);
 	errWD.reserve(lnit.count);
 	// See how far the edges are from the unmodified path
-	// Draw the smoothed edges on an image
-	cv::polylines(lEdge, lEdgePts, false, cv::Scalar(0), 1);
-	cv::polylines(rEdge, rEdgePts, false, cv::Scalar(0), 1);
-	// apply a distance transform to the image with the smoothed edges
-	cv::distanceTransform(lEdge, lEdge, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F); //NOTE: regarding speed -  DIST_MASK_5 (3.9ms/rod) < DIST_MASK_PRECISE (4.7ms/rod) < DIST_MASK_3 (9.1ms/rod) 
-	cv::distanceTransform(rEdge, rEdge, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F);
 	// iterate over the target centerline to calculate the errors
 	for (int i = 0; i < lnit.count; i++, ++lnit) {
 		//TODO: check if there is a measured edge to the left / right of the path
 		// maybe check if the dXform distance is greater than the boundary width
 		centerline.push_back(lnit.pos()); // add the points from the centerline
-		errCL.push_back((PIX2MM(static_cast<__int64>(rEdge.at<float>(lnit.pos())) - static_cast<__int64>(lEdge.at<float>(lnit.pos())))) / 2);
-		errWD.push_back(PIX2MM(static_cast<__int64>(lEdge.at<float>(lnit.pos())) + static_cast<__int64>(width - rEdge.at<float>(lnit.pos()))));
+		pix = lnit.pos() - crop.tl();
+		errCL.push_back((resolution.toMM(static_cast<__int64>(rEdge.at<float>(pix)) - static_cast<__int64>(lEdge.at<float>(pix)))) / 2);
+		errWD.push_back(resolution.toMM(static_cast<__int64>(lEdge.at<float>(pix)) + static_cast<__int64>(width - rEdge.at<float>(pix))));
 	}
 }
 
 void getErrorsAt(std::vector<cv::Point>& waypoints, std::vector<double>targetWidths, const int dir, cv::Size rasterSize, const std::vector<cv::Point>& lEdgePts, const std::vector<cv::Point>& rEdgePts, std::vector<double>& errCL, std::vector<double>& errWD) {
-	cv::Mat lEdge = cv::Mat(rasterSize, CV_8UC1, cv::Scalar(255)); // Image to draw the left edge on
-	cv::Mat rEdge = cv::Mat(rasterSize, CV_8UC1, cv::Scalar(255)); // Image to draw the right edge on
+	cv::Mat lEdge, rEdge; // distances to the left and right edges
 	errCL.clear(); // clear the errors
 	errWD.clear();
 	errCL.reserve(waypoints.size());
 	errWD.reserve(waypoints.size());
 	int i = 0;
 	int minX = 0, maxX = 0, minY = 0, maxY = 0;
+	cv::Point pix;
 	//auto Lval, Rval;
 
+	// without both edges there is no material to measure
+	if (lEdgePts.empty() || rEdgePts.empty()) {
+		errCL.assign(waypoints.size(), NAN);
+		errWD.assign(waypoints.size(), NAN);
+		return;
+	}
+
 	// Create rectangle containing area with material on both sides of the rater
 	if (printDir::X(dir))
 	{
@@ -154,20 +279,76 @@ void getErrorsAt(std::vector<cv::Point>& waypoints, std::vector<double>targetWid
 
 	cv::Rect edgeRoi = cv::Rect(minX, minY, maxX-minX, maxY-minY);
 	
-	// See how far the edges are from the unmodified path
-	// Draw the smoothed edges on an image
-	cv::polylines(lEdge, lEdgePts, false, cv::Scalar(0), 1);
-	cv::polylines(rEdge, rEdgePts, false, cv::Scalar(0), 1);
-	// apply a distance transform to the image with the smoothed edges
-	cv::distanceTransform(lEdge, lEdge, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F); //NOTE: regarding speed -  DIST_MASK_5 (3.9ms/rod) < DIST_MASK_PRECISE (4.7ms/rod) < DIST_MASK_3 (9.1ms/rod) 
-	cv::distanceTransform(rEdge, rEdge, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F);
+	// See how far the edges are from the unmodified path. Only the waypoints in edgeRoi are read, so the distances are only needed
+	// around the edges (see edgeDistances)
+	cv::Rect crop = edgeDistances(rasterSize, edgeRoi, lEdgePts, rEdgePts, lEdge, rEdge);
+	edgeRoi &= crop;
 	// iterate over the waypoints to calculate the errors
 	for (auto it = waypoints.begin(); it != waypoints.end(); ++it, i++) {
 		// Check if the waypoint is within the countour created by the edges
 		//if (cv::pointPolygonTest(edgeContour, *it, false) >= 0) { // UNUSED
 		if (edgeRoi.contains(*it)) {
-			errCL.push_back((PIX2MM(static_cast<__int64>(rEdge.at<float>(*it)) - static_cast<__int64>(lEdge.at<float>(*it))))/2 );
-			errWD.push_back(targetWidths[i] - PIX2MM(static_cast<__int64>(lEdge.at<float>(*it)) + static_cast<__int64>(rEdge.at<float>(*it))));
+			pix = *it - crop.tl();
+			errCL.push_back((resolution.toMM(static_cast<__int64>(rEdge.at<float>(pix)) - static_cast<__int64>(lEdge.at<float>(pix))))/2 );
+			errWD.push_back(targetWidths[i] - resolution.toMM(static_cast<__int64>(lEdge.at<float>(pix)) + static_cast<__int64>(rEdge.at<float>(pix))));
+		}
+		else {
+			// HACK: set invalid errors to NAN
+			errCL.push_back(NAN);
+			errWD.push_back(NAN);
+		}
+	}
+}
+
+void getErrorsAt(const std::vector<cv::Point>& waypoints, std::vector<double>targetWidths, const int dir, const std::vector<cv::Point2f>& lEdgePts, const std::vector<cv::Point2f>& rEdgePts, std::vector<double>& errCL, std::vector<double>& errWD) {
+	double minX = 0, maxX = 0, minY = 0, maxY = 0, lDist, rDist;
+	int i = 0;
+	errCL.clear(); // clear the errors
+	errWD.clear();
+	errCL.reserve(waypoints.size());
+	errWD.reserve(waypoints.size());
+
+	// without both edges there is no material to measure
+	if (lEdgePts.empty() || rEdgePts.empty()) {
+		errCL.assign(waypoints.size(), NAN);
+		errWD.assign(waypoints.size(), NAN);
+		return;
+	}
+
+	// Create rectangle containing area with material on both sides of the rater
+	if (printDir::X(dir))
+	{
+		// X bounds
+		const auto Lval = std::minmax_element(lEdgePts.begin(), lEdgePts.end(), [](const cv::Point2f& pt1, const cv::Point2f& pt2) {return pt1.x < pt2.x; });
+		const auto Rval = std::minmax_element(rEdgePts.begin(), rEdgePts.end(), [](const cv::Point2f& pt1, const cv::Point2f& pt2) {return pt1.x < pt2.x; });
+		minX = std::max((*Lval.first).x, (*Rval.first).x);
+		maxX = std::min((*Lval.second).x, (*Rval.second).x);
+		// Y bounds
+		minY = (*std::min_element(lEdgePts.begin(), lEdgePts.end(), [](const cv::Point2f& pt1, const cv::Point2f& pt2) {return pt1.y < pt2.y; })).y;
+		maxY = (*std::max_element(rEdgePts.begin(), rEdgePts.end(), [](const cv::Point2f& pt1, const cv::Point2f& pt2) {return pt1.y < pt2.y; })).y;
+	}
+	else if (printDir::Y(dir))
+	{
+		// X bounds
+		minX = (*std::min_element(lEdgePts.begin(), lEdgePts.end(), [](const cv::Point2f& pt1, const cv::Point2f& pt2) {return pt1.x < pt2.x; })).x;
+		maxX = (*std::max_element(rEdgePts.begin(), rEdgePts.end(), [](const cv::Point2f& pt1, const cv::Point2f& pt2) {return pt1.x < pt2.x; })).x;
+		// Y bounds
+		const auto Lval = std::minmax_element(lEdgePts.begin(), lEdgePts.end(), [](const cv::Point2f& pt1, const cv::Point2f& pt2) {return pt1.y < pt2.y; });
+		const auto Rval = std::minmax_element(rEdgePts.begin(), rEdgePts.end(), [](const cv::Point2f& pt1, const cv::Point2f& pt2) {return pt1.y < pt2.y; });
+		minY = std::max((*Lval.first).y, (*Rval.first).y);
+		maxY = std::min((*Lval.second).y, (*Rval.second).y);
+	}
+
+	cv::Rect2d edgeRoi = cv::Rect2d(minX, minY, maxX - minX, maxY - minY);
+	IndexedCurve lCurve(lEdgePts), rCurve(rEdgePts);
+
+	// iterate over the waypoints to calculate the errors from the distances to the smoothed edges
+	for (auto it = waypoints.begin(); it != waypoints.end(); ++it, i++) {
+		if (edgeRoi.contains(*it)) {
+			lDist = lCurve.distance(*it);
+			rDist = rCurve.distance(*it);
+			errCL.push_back(resolution.toMM(rDist - lDist) / 2);
+			errWD.push_back(targetWidths[i] - resolution.toMM(lDist + rDist));
 		}
 		else {
 			// HACK: set invalid errors to NAN
@@ -175,4 +356,4 @@ void getErrorsAt(std::vector<cv::Point>& waypoints, std::vector<double>targetWid
 			errWD.push_back(NAN);
 		}
 	}
-}
\ No newline at end of file
+}
@@ -9,14 +9,9 @@
 #include "myGlobals.h"
 #include "constants.h"
 
-/**
- * @brief Applies a discrete Gaussian filter to smooth a vector of points. Smooths only in the x direction.
- * @param[in] unfiltPts Vector of unfiltered points
- * @param[out] filtPts Vector of points after applying the filter
- * @param[in] kSize Number of points to before (or after) the target point to smooth ( kSize = 3 corresponds to a kernel size of 7 )
- * @param[in] sig Standard deviation of the Gaussian kernel
-*/
-void gaussianSmoothX(const std::vector<cv::Point>& unfiltPts, std::vector<cv::Point>& filtPts, int kSize, double sig) {
+// Smooths the y coordinates of the points. The filtered values are converted to T by casting, so integer points are truncated
+template<typename T>
+static void smoothX(const std::vector<cv::Point_<T>>& unfiltPts, std::vector<cv::Point_<T>>& filtPts, int kSize, double sig) {
 	// apply gaussian smoothing to the x points of a polyline
 	double sumK, filteredVal;
 	filtPts.clear();
@@ -43,18 +38,13 @@ void gaussianSmoothX(const std::vector<cv::Point>& unfiltPts, std::vector<cv::Po
 			sumK += K[kSize - std::distance(std::prev(itr,1), it) ];
 			filteredVal += (*std::prev(itr, 1)).y * K[kSize - std::distance(std::prev(itr, 1), it)];
 		}
-		filtPts.push_back(cv::Point((*it).x, (int)(filteredVal / sumK) ));
+		filtPts.push_back(cv::Point_<T>((*it).x, (T)(filteredVal / sumK) ));
 	}
 }
 
-/**
- * @brief Applies a discrete Gaussian filter to smooth a vector of points. Smooths only in the Y direction.
- * @param[in] unfiltPts Vector of unfiltered points
- * @param[out] filtPts Vector of points after applying the filter
- * @param[in] kSize Number of points to before (or after) the target point to smooth ( kSize = 3 corresponds to a kernel size of 7 )
- * @param[in] sig Standard deviation of the Gaussian kernel
-*/
-void gaussianSmoothY(const std::vector<cv::Point>& unfiltPts, std::vector<cv::Point>& filtPts, int kSize, double sig) {
+// Smooths the x coordinates of the points. The filtered values are converted to T by casting, so integer points are truncated
+template<typename T>
+static void smoothY(const std::vector<cv::Point_<T>>& unfiltPts, std::vector<cv::Point_<T>>& filtPts, int kSize, double sig) {
 	// apply gaussian smoothing to the y points of a polyline
 	double sumK, filteredVal;
 	filtPts.clear();
@@ -81,6 +71,36 @@ void gaussianSmoothY(const std::vector<cv::Point>& unfiltPts, std::vector<cv::Po
 			sumK += K[kSize - std::distance(std::prev(itr, 1), it)];
 			filteredVal += (*std::prev(itr, 1)).x * K[kSize - std::distance(std::prev(itr, 1), it)];
 		}
-		filtPts.push_back(cv::Point((int)(filteredVal / sumK), (*it).y));
+		filtPts.push_back(cv::Point_<T>((T)(filteredVal / sumK), (*it).y));
 	}
+}
+
+/**
+ * @brief Applies a discrete Gaussian filter to smooth a vector of points. Smooths only in the x direction.
+ * @param[in] unfiltPts Vector of unfiltered points
+ * @param[out] filtPts Vector of points after applying the filter
+ * @param[in] kSize Number of points to before (or after) the target point to smooth ( kSize = 3 corresponds to a kernel size of 7 )
+ * @param[in] sig Standard deviation of the Gaussian kernel
+*/
+void gaussianSmoothX(const std::vector<cv::Point>& unfiltPts, std::vector<cv::Point>& filtPts, int kSize, double sig) {
+	smoothX(unfiltPts, filtPts, kSize, sig);
+}
+
+void gaussianSmoothX(const std::vector<cv::Point2f>& unfiltPts, std::vector<cv::Point2f>& filtPts, int kSize, double sig) {
+	smoothX(unfiltPts, filtPts, kSize, sig);
+}
+
+/**
+ * @brief Applies a discrete Gaussian filter to smooth a vector of points. Smooths only in the Y direction.
+ * @param[in] unfiltPts Vector of unfiltered points
+ * @param[out] filtPts Vector of points after applying the filter
+ * @param[in] kSize Number of points to before (or after) the target point to smooth ( kSize = 3 corresponds to a kernel size of 7 )
+ * @param[in] sig Standard deviation of the Gaussian kernel
+*/
+void gaussianSmoothY(const std::vector<cv::Point>& unfiltPts, std::vector<cv::Point>& filtPts, int kSize, double sig) {
+	smoothY(unfiltPts, filtPts, kSize, sig);
+}
+
+void gaussianSmoothY(const std::vector<cv::Point2f>& unfiltPts, std::vector<cv::Point2f>& filtPts, int kSize, double sig) {
+	smoothY(unfiltPts, filtPts, kSize, sig);
 }
\ No newline at end of file
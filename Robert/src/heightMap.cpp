@@ -0,0 +1,41 @@
+#include <vector>
+#include <limits>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "heightMap.h"
+
+HeightMap::HeightMap(cv::Size size, int tileSize)
+	: _map(size, CV_32F, cv::Scalar(std::numeric_limits<float>::quiet_NaN()), tileSize) {}
+
+void HeightMap::reset(cv::Size size) {
+	_map.reset(size);
+}
+
+void HeightMap::addScan(const cv::Point& start, const cv::Point& end, const std::vector<float>& heights) {
+	cv::LineIterator lineit(_map.size(), start, end, 8);
+
+	// the line iterator is clipped to the map, so every point has a pixel
+	for (int i = 0; i < lineit.count && i < (int)heights.size(); i++, ++lineit) { _map.at<float>(lineit.pos()) = heights[i]; }
+}
+
+void HeightMap::addScan(const cv::Point& start, const cv::Point& end, const cv::Mat& scanROI) {
+	std::vector<float> heights;
+	scanROI.reshape(1, 1).convertTo(heights, CV_32F);
+	addScan(start, end, heights);
+}
+
+float HeightMap::at(const cv::Point& pt) const {
+	return _map.value<float>(pt);
+}
+
+void HeightMap::copyTo(const cv::Rect& roi, cv::Mat& dst) const {
+	_map.copyTo(roi, dst);
+}
+
+void HeightMap::profile(const cv::Point& start, const cv::Point& end, std::vector<float>& heights) const {
+	cv::LineIterator lineit(_map.size(), start, end, 8);
+
+	heights.resize(lineit.count);
+	for (int i = 0; i < lineit.count; i++, ++lineit) { heights[i] = at(lineit.pos()); }
+}
@@ -12,4 +12,7 @@ threadsafe_queue<pathMsg> q_pathMsg;
 
 extern std::string outDir = "./Output/";
 
+ScanStats scanStats;
+PositionService positionService;
+
 std::mutex mut_cmd;
\ No newline at end of file
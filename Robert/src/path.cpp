@@ -3,11 +3,13 @@
 #include <vector>
 #include <iterator> 
 #include <algorithm>
+#include <cmath>
 #include <opencv2/core.hpp>
 
 #include "myTypes.h"
 #include "myGlobals.h"
 #include "constants.h"
+#include "resolution.h"
 #include "raster.h"
 
 void interpPathPoints(std::vector<cv::Point2d> inPts, double wayptSpc, std::vector<cv::Point2d>& outPts) {
@@ -33,7 +35,7 @@ void interpPathPoints(std::vector<cv::Point2i> inPts, double wayptSpc, std::vect
 	for (auto it = inPts.begin(); it != std::prev(inPts.end(), 1); ++it) {
 		diff = *std::next(it, 1) - *it;
 		L = cv::norm(diff);
-		delta = (diff / L) * (double) MM2PIX(wayptSpc);
+		delta = (diff / L) * (double) resolution.toPix(wayptSpc);
 		for (int i = 0; cv::norm(i * delta) < L; i++) {
 			outPts.push_back(*it + cv::Point2i(i * delta));
 		}
@@ -47,7 +49,7 @@ bool makePath(Raster raster, double wayptSpc, std::deque<double>& theta, cv::Poi
 	std::vector<cv::Point2i> wp_px;
 	std::vector<cv::Point2d> wp_mm;
 	cv::Point2d scanDonePt;
-	int pixRodWth = MM2PIX(raster.rodWidth());
+	int pixRodWth = resolution.toPix(raster.rodWidth());
 	int direction = 1;
 	cv::Point2d origin = raster.origin();
 	std::vector<Path> tmp;
@@ -67,7 +69,7 @@ bool makePath(Raster raster, double wayptSpc, std::deque<double>& theta, cv::Poi
 			wp_px.push_back(*std::next(it));
 		}
 		wp_mm.resize(wp_px.size());
-		std::transform(wp_px.begin(), wp_px.end(), wp_mm.begin(), [&origin](cv::Point& pt) {return (PIX2MM(cv::Point2d(pt)) + origin); });
+		std::transform(wp_px.begin(), wp_px.end(), wp_mm.begin(), [&origin](cv::Point& pt) {return (resolution.toMM(cv::Point2d(pt)) + origin); });
 
 		for (auto it2 = wp_mm.begin(); it2 != wp_mm.end(); ++it2) {
 			if (!theta.empty()) {
@@ -143,7 +145,7 @@ void makePath(Raster raster, double wayptSpc, double theta, cv::Point3d initPos,
 	std::vector<cv::Point2i> wp_px;
 	std::vector<cv::Point2d> wp_mm;
 	cv::Point2d scanDonePt;
-	int pixRodWth = MM2PIX(raster.rodWidth());
+	int pixRodWth = resolution.toPix(raster.rodWidth());
 	int direction = 1;
 	cv::Point2d origin = raster.origin();
 	std::vector<Path> tmp;
@@ -163,7 +165,7 @@ void makePath(Raster raster, double wayptSpc, double theta, cv::Point3d initPos,
 			wp_px.push_back(*std::next(it));
 		}
 		wp_mm.resize(wp_px.size());
-		std::transform(wp_px.begin(), wp_px.end(), wp_mm.begin(), [&origin](cv::Point& pt) {return (PIX2MM(cv::Point2d(pt)) + origin); });
+		std::transform(wp_px.begin(), wp_px.end(), wp_mm.begin(), [&origin](cv::Point& pt) {return (resolution.toMM(cv::Point2d(pt)) + origin); });
 
 		for (auto it2 = wp_mm.begin(); it2 != wp_mm.end(); ++it2) {
 			tmp.push_back(Path(*it2, z, T, f, e, w));
@@ -268,4 +270,21 @@ void readTheta(std::string filename, std::deque<double>& theta) {
 	double rodLen, rodSpc, wayptSpc;
 	std::deque<std::vector<double>> path;
 	readPath(filename, rodLen, rodSpc, wayptSpc, path, theta);
+}
+
+int findPathSegment(const std::vector<std::vector<Path>>& path, const cv::Point2d& pos, int first, int numSegs, double maxDist, int& waypoint) {
+	double minDist = maxDist, dist;
+	int seg = -1;
+
+	for (int i = std::max(first, 0); i < (int)path.size() && i < first + numSegs; i++) {
+		for (int j = 0; j < (int)path[i].size(); j++) {
+			dist = std::hypot(path[i][j].x - pos.x, path[i][j].y - pos.y);
+			if (dist < minDist) {
+				minDist = dist;
+				seg = i;
+				waypoint = j;
+			}
+		}
+	}
+	return seg;
 }
\ No newline at end of file
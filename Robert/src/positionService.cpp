@@ -0,0 +1,103 @@
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "A3200.h"
+#include "positionService.h"
+#include "myTypes.h"
+#include "myGlobals.h"
+#include "A3200_functions.h"
+
+PositionService::PositionService()
+	: _seq(0), _x(0), _y(0), _z(0), _T(0), _time(0), _count(0), _run(false) {}
+
+PositionService::~PositionService() {
+	stop();
+}
+
+bool PositionService::start(double period) {
+	if (_run || period <= 0) { return false; }
+	if (_thread.joinable()) { _thread.join(); }
+	_count = 0;
+	_run = true;
+	_thread = std::thread{ &PositionService::_poll, this, period };
+	return true;
+}
+
+void PositionService::stop() {
+	_run = false;
+	if (_thread.joinable()) { _thread.join(); }
+}
+
+bool PositionService::read(Coords& pos) const {
+	std::chrono::steady_clock::time_point time;
+	return read(pos, time);
+}
+
+bool PositionService::read(Coords& pos, std::chrono::steady_clock::time_point& time) const {
+	unsigned seq0, seq1;
+	std::chrono::steady_clock::rep ticks;
+
+	do {
+		// wait for the writer to finish
+		while ((seq0 = _seq.load(std::memory_order_acquire)) & 1) { std::this_thread::yield(); }
+		pos.x = _x.load(std::memory_order_relaxed);
+		pos.y = _y.load(std::memory_order_relaxed);
+		pos.z = _z.load(std::memory_order_relaxed);
+		pos.T = _T.load(std::memory_order_relaxed);
+		ticks = _time.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		seq1 = _seq.load(std::memory_order_relaxed);
+	} while (seq0 != seq1); // retry if the pose changed while it was being read
+
+	time = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(ticks));
+	return seq0 != 0;
+}
+
+void PositionService::_publish(const Coords& pos, std::chrono::steady_clock::time_point time) {
+	unsigned seq = _seq.load(std::memory_order_relaxed);
+
+	_seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	_x.store(pos.x, std::memory_order_relaxed);
+	_y.store(pos.y, std::memory_order_relaxed);
+	_z.store(pos.z, std::memory_order_relaxed);
+	_T.store(pos.T, std::memory_order_relaxed);
+	_time.store(time.time_since_epoch().count(), std::memory_order_relaxed);
+	_seq.store(seq + 2, std::memory_order_release);
+	_count++;
+}
+
+void PositionService::_poll(double period) {
+	// poll the position feedback of all the axes simultaneously
+	WORD itemIndexArray[] = { AXISINDEX_00, AXISINDEX_01, AXISINDEX_02, AXISINDEX_03 };
+	STATUSITEM itemCodeArray[] = { STATUSITEM_PositionFeedback, STATUSITEM_PositionFeedback, STATUSITEM_PositionFeedback, STATUSITEM_PositionFeedback };
+	DWORD itemExtrasArray[] = { 0, 0, 0, 0 };
+	double itemValuesArray[4];
+	Coords pos;
+	bool failed = false;
+	std::chrono::steady_clock::time_point tNext = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::duration dt = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(period));
+
+	while (_run) {
+		if (A3200StatusGetItems(handle, 4, itemIndexArray, itemCodeArray, itemExtrasArray, itemValuesArray)) {
+			// NOTE: status items are given in user units, so unlike the data collection no conversion from counts is needed
+			pos.x = itemValuesArray[0];
+			pos.y = itemValuesArray[1];
+			pos.z = itemValuesArray[2];
+			pos.T = itemValuesArray[3];
+			_publish(pos, std::chrono::steady_clock::now());
+			failed = false;
+		}
+		else if (!failed) {
+			// only report the first error of a run of failed polls
+			A3200Error();
+			failed = true;
+		}
+		// keep a fixed rate, but don't try to catch up on missed polls
+		tNext += dt;
+		if (tNext < std::chrono::steady_clock::now()) { tNext = std::chrono::steady_clock::now(); }
+		std::this_thread::sleep_until(tNext);
+	}
+}
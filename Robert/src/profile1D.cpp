@@ -0,0 +1,461 @@
+#include "profile1D.h"
+#include <cfloat>
+#include <cstring>
+#include <cstdlib>
+#include <opencv2/core.hpp>
+
+#if defined(__AVX2__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64)))
+#define PROFILE_1D_AVX2
+#include <immintrin.h>
+#endif
+
+static bool& useSIMD() {
+#ifdef PROFILE_1D_AVX2
+	static bool enabled = cv::checkHardwareSupport(CV_CPU_AVX2) && cv::checkHardwareSupport(CV_CPU_FMA3);
+#else
+	static bool enabled = false;
+#endif
+	return enabled;
+}
+
+bool setProfileSIMD(bool enable) {
+#ifdef PROFILE_1D_AVX2
+	useSIMD() = enable && cv::checkHardwareSupport(CV_CPU_AVX2) && cv::checkHardwareSupport(CV_CPU_FMA3);
+#endif
+	return useSIMD();
+}
+
+bool profileSIMD() {
+	return useSIMD();
+}
+
+///////////////////////////////////////  Scalar kernels  ///////////////////////////////////////
+
+template <typename T>
+static inline T windowMax(const T* src, int n, int i, int r) {
+	int start = (i - r < 0) ? 0 : i - r;
+	int end = (i + r > n - 1) ? n - 1 : i + r;
+	T val = src[start];
+	for (int j = start + 1; j <= end; j++) { if (src[j] > val) { val = src[j]; } }
+	return val;
+}
+
+template <typename T>
+static inline T windowMin(const T* src, int n, int i, int r) {
+	int start = (i - r < 0) ? 0 : i - r;
+	int end = (i + r > n - 1) ? n - 1 : i + r;
+	T val = src[start];
+	for (int j = start + 1; j <= end; j++) { if (src[j] < val) { val = src[j]; } }
+	return val;
+}
+
+// Adds d counts of the quantized value q to the three level histogram of the median filters
+static inline void rankAdd(int* hist, int q, int d) {
+	hist[q >> 8] += d;
+	hist[16 + (q >> 4)] += d;
+	hist[16 + 256 + q] += d;
+}
+
+// Quantized value of the given rank (0 is the smallest) in the three level histogram. Takes at most 16 steps in each level
+static inline int rankFind(const int* hist, int rank) {
+	const int* mid = hist + 16;
+	const int* fine = hist + 16 + 256;
+	int a = 0, b, q;
+
+	while (rank >= hist[a]) { rank -= hist[a]; a++; }
+	b = a << 4;
+	while (rank >= mid[b]) { rank -= mid[b]; b++; }
+	q = b << 4;
+	while (rank >= fine[q]) { rank -= fine[q]; q++; }
+	return q;
+}
+
+// Quantizes the signal to RANK_LEVELS levels between its minimum and maximum. Returns FALSE if the signal is flat
+template <typename T>
+static bool quantize(const T* src, ushort* dst, int n, double& smin, double& step) {
+	double smax, scale;
+	smin = smax = src[0];
+
+	for (int i = 1; i < n; i++) {
+		if (src[i] < smin) { smin = src[i]; }
+		if (src[i] > smax) { smax = src[i]; }
+	}
+	if (smax - smin <= DBL_EPSILON) { return false; }
+	step = (smax - smin) / (ProfileWorkspace::RANK_LEVELS - 1);
+	scale = 1 / step;
+	for (int i = 0; i < n; i++) { dst[i] = (ushort)cvRound((src[i] - smin) * scale); }
+	return true;
+}
+
+// Sliding median of the quantized signal. Each step adds the sample entering the window and removes the one leaving it
+static void medianQuant(const ushort* src, ushort* dst, int n, int r, int* hist) {
+	int lo, hi;
+
+	std::memset(hist, 0, sizeof(int) * ProfileWorkspace::RANK_BINS);
+	for (int j = 0; j <= r && j < n; j++) { rankAdd(hist, src[j], 1); }
+	for (int i = 0; i < n; i++) {
+		if (i > 0) {
+			if (i + r < n) { rankAdd(hist, src[i + r], 1); }
+			if (i - r - 1 >= 0) { rankAdd(hist, src[i - r - 1], -1); }
+		}
+		lo = (i - r < 0) ? 0 : i - r;
+		hi = (i + r > n - 1) ? n - 1 : i + r;
+		dst[i] = (ushort)rankFind(hist, (hi - lo) / 2);
+	}
+}
+
+template <typename T>
+static void medianFilter(const T* src, T* dst, int n, int radius, ProfileWorkspace& ws) {
+	double smin, step;
+
+	if (n <= 0) { return; }
+	if (!quantize(src, ws.quant.data(), n, smin, step)) {
+		if (dst != src) { std::memcpy(dst, src, sizeof(T) * n); }
+		return;
+	}
+	medianQuant(ws.quant.data(), ws.quantMed.data(), n, radius, ws.rankHist.data());
+	for (int i = 0; i < n; i++) { dst[i] = (T)(smin + ws.quantMed[i] * step); }
+}
+
+template <typename T>
+static int hampel(const T* src, T* dst, int n, int radius, double k, ProfileWorkspace& ws) {
+	const ushort* q = ws.quant.data();
+	const ushort* med = ws.quantMed.data();
+	int* hist = ws.rankHist.data();
+	double smin, step, thresh;
+	int numReplaced = 0;
+
+	if (n <= 0) { return 0; }
+	if (!quantize(src, ws.quant.data(), n, smin, step)) {
+		if (dst != src) { std::memcpy(dst, src, sizeof(T) * n); }
+		return 0;
+	}
+	medianQuant(q, ws.quantMed.data(), n, radius, hist);
+
+	// MAD of the signal from its sliding median, from the same histogram
+	std::memset(hist, 0, sizeof(int) * ProfileWorkspace::RANK_BINS);
+	for (int i = 0; i < n; i++) { rankAdd(hist, std::abs((int)q[i] - (int)med[i]), 1); }
+	thresh = k * 1.4826 * rankFind(hist, (n - 1) / 2);
+	// the quantization leaves up to one level between an inlier and its median
+	if (thresh < 1) { thresh = 1; }
+
+	for (int i = 0; i < n; i++) {
+		if (std::abs((int)q[i] - (int)med[i]) > thresh) {
+			dst[i] = (T)(smin + med[i] * step);
+			numReplaced++;
+		}
+		else { dst[i] = src[i]; }
+	}
+	return numReplaced;
+}
+
+static int argMax_scalar(const double* src, int n, int start = 0) {
+	int idx = start;
+	for (int i = start + 1; i < n; i++) { if (src[i] > src[idx]) { idx = i; } }
+	return idx;
+}
+
+///////////////////////////////////////  AVX2 kernels  ///////////////////////////////////////
+#ifdef PROFILE_1D_AVX2
+
+static int argMax_avx2(const double* src, int n) {
+	int i = 0;
+	double maxVal;
+	if (n < 4) { return argMax_scalar(src, n); }
+
+	// find the maximum value, then the first sample with that value
+	__m256d vmax = _mm256_loadu_pd(src);
+	for (i = 4; i + 4 <= n; i += 4) { vmax = _mm256_max_pd(vmax, _mm256_loadu_pd(src + i)); }
+	double lanes[4];
+	_mm256_storeu_pd(lanes, vmax);
+	maxVal = lanes[0];
+	for (int k = 1; k < 4; k++) { if (lanes[k] > maxVal) { maxVal = lanes[k]; } }
+	for (; i < n; i++) { if (src[i] > maxVal) { maxVal = src[i]; } }
+
+	__m256d vval = _mm256_set1_pd(maxVal);
+	for (i = 0; i + 4 <= n; i += 4) {
+		int m = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(src + i), vval, _CMP_EQ_OQ));
+		if (m != 0) {
+			for (int k = 0; k < 4; k++) { if (m & (1 << k)) { return i + k; } }
+		}
+	}
+	for (; i < n; i++) { if (src[i] == maxVal) { return i; } }
+	return 0;
+}
+
+static void maxFilter_avx2(const double* src, double* dst, int n, int r) {
+	int i = 0;
+	for (; i < r && i < n; i++) { dst[i] = windowMax(src, n, i, r); }
+	for (; i + r + 4 <= n; i += 4) {
+		__m256d v = _mm256_loadu_pd(src + i - r);
+		for (int k = 1; k <= 2 * r; k++) { v = _mm256_max_pd(v, _mm256_loadu_pd(src + i - r + k)); }
+		_mm256_storeu_pd(dst + i, v);
+	}
+	for (; i < n; i++) { dst[i] = windowMax(src, n, i, r); }
+}
+
+static void minFilter_avx2(const double* src, double* dst, int n, int r) {
+	int i = 0;
+	for (; i < r && i < n; i++) { dst[i] = windowMin(src, n, i, r); }
+	for (; i + r + 4 <= n; i += 4) {
+		__m256d v = _mm256_loadu_pd(src + i - r);
+		for (int k = 1; k <= 2 * r; k++) { v = _mm256_min_pd(v, _mm256_loadu_pd(src + i - r + k)); }
+		_mm256_storeu_pd(dst + i, v);
+	}
+	for (; i < n; i++) { dst[i] = windowMin(src, n, i, r); }
+}
+
+static void maxFilter_avx2(const uchar* src, uchar* dst, int n, int r) {
+	int i = 0;
+	for (; i < r && i < n; i++) { dst[i] = windowMax(src, n, i, r); }
+	for (; i + r + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + i - r));
+		for (int k = 1; k <= 2 * r; k++) { v = _mm256_max_epu8(v, _mm256_loadu_si256((const __m256i*)(src + i - r + k))); }
+		_mm256_storeu_si256((__m256i*)(dst + i), v);
+	}
+	for (; i < n; i++) { dst[i] = windowMax(src, n, i, r); }
+}
+
+static void sub_avx2(const double* a, const double* b, double* dst, int n) {
+	int i = 0;
+	for (; i + 4 <= n; i += 4) { _mm256_storeu_pd(dst + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i))); }
+	for (; i < n; i++) { dst[i] = a[i] - b[i]; }
+}
+
+static void minMax_avx2(const double* src, int n, double& minVal, double& maxVal) {
+	int i = 0;
+	minVal = maxVal = src[0];
+	if (n >= 4) {
+		__m256d vmin = _mm256_loadu_pd(src), vmax = vmin;
+		for (i = 4; i + 4 <= n; i += 4) {
+			__m256d v = _mm256_loadu_pd(src + i);
+			vmin = _mm256_min_pd(vmin, v);
+			vmax = _mm256_max_pd(vmax, v);
+		}
+		double lmin[4], lmax[4];
+		_mm256_storeu_pd(lmin, vmin);
+		_mm256_storeu_pd(lmax, vmax);
+		for (int k = 0; k < 4; k++) {
+			if (lmin[k] < minVal) { minVal = lmin[k]; }
+			if (lmax[k] > maxVal) { maxVal = lmax[k]; }
+		}
+	}
+	for (; i < n; i++) {
+		if (src[i] < minVal) { minVal = src[i]; }
+		if (src[i] > maxVal) { maxVal = src[i]; }
+	}
+}
+
+// Same as the AVX2 build of cv::Mat::convertTo: fused multiply-add, round to nearest even, saturate
+static void scale8U_avx2(const double* src, uchar* dst, int n, double scale, double shift) {
+	__m256d va = _mm256_set1_pd(scale), vb = _mm256_set1_pd(shift);
+	for (int i = 0; i < n; i += 8) {
+		// process the last 8 samples again instead of a scalar tail
+		if (i > n - 8) { i = n - 8; }
+		__m128i lo = _mm256_cvtpd_epi32(_mm256_fmadd_pd(_mm256_loadu_pd(src + i), va, vb));
+		__m128i hi = _mm256_cvtpd_epi32(_mm256_fmadd_pd(_mm256_loadu_pd(src + i + 4), va, vb));
+		__m128i v16 = _mm_packs_epi32(lo, hi);
+		_mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(v16, v16));
+	}
+}
+
+static void threshold_avx2(const uchar* src, uchar* dst, int n, int thresh) {
+	int i = 0;
+	__m256i vt = _mm256_set1_epi8((char)(thresh + 1));
+	// src > thresh  <=>  max(src, thresh + 1) == src
+	for (; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_cmpeq_epi8(_mm256_max_epu8(v, vt), v));
+	}
+	for (; i < n; i++) { dst[i] = (src[i] > thresh) ? 255 : 0; }
+}
+
+#endif // PROFILE_1D_AVX2
+
+///////////////////////////////////////  Kernels  ///////////////////////////////////////
+
+int argMax1D(const double* src, int n) {
+	if (n <= 0) { return -1; }
+#ifdef PROFILE_1D_AVX2
+	if (useSIMD()) { return argMax_avx2(src, n); }
+#endif
+	return argMax_scalar(src, n);
+}
+
+void maxFilter1D(const double* src, double* dst, int n, int radius) {
+#ifdef PROFILE_1D_AVX2
+	if (useSIMD()) { maxFilter_avx2(src, dst, n, radius); return; }
+#endif
+	for (int i = 0; i < n; i++) { dst[i] = windowMax(src, n, i, radius); }
+}
+
+void minFilter1D(const double* src, double* dst, int n, int radius) {
+#ifdef PROFILE_1D_AVX2
+	if (useSIMD()) { minFilter_avx2(src, dst, n, radius); return; }
+#endif
+	for (int i = 0; i < n; i++) { dst[i] = windowMin(src, n, i, radius); }
+}
+
+void maxFilter1D(const uchar* src, uchar* dst, int n, int radius) {
+#ifdef PROFILE_1D_AVX2
+	if (useSIMD()) { maxFilter_avx2(src, dst, n, radius); return; }
+#endif
+	for (int i = 0; i < n; i++) { dst[i] = windowMax(src, n, i, radius); }
+}
+
+void blackhat1D(const double* src, double* dst, int n, int radius, ProfileWorkspace& ws) {
+	// closing = erode(dilate(src))
+	maxFilter1D(src, ws.dil.data(), n, radius);
+	minFilter1D(ws.dil.data(), dst, n, radius);
+#ifdef PROFILE_1D_AVX2
+	if (useSIMD()) { sub_avx2(dst, src, dst, n); return; }
+#endif
+	for (int i = 0; i < n; i++) { dst[i] = dst[i] - src[i]; }
+}
+
+void medianFilter1D(const double* src, double* dst, int n, int radius, ProfileWorkspace& ws) {
+	medianFilter(src, dst, n, radius, ws);
+}
+
+void medianFilter1D(const float* src, float* dst, int n, int radius, ProfileWorkspace& ws) {
+	medianFilter(src, dst, n, radius, ws);
+}
+
+int hampel1D(const double* src, double* dst, int n, int radius, double k, ProfileWorkspace& ws) {
+	return hampel(src, dst, n, radius, k, ws);
+}
+
+int hampel1D(const float* src, float* dst, int n, int radius, double k, ProfileWorkspace& ws) {
+	return hampel(src, dst, n, radius, k, ws);
+}
+
+void normalize1D(const double* src, uchar* dst, int n) {
+	double smin, smax;
+	double scale, shift;
+	if (n <= 0) { return; }
+	smin = smax = src[0];
+
+#ifdef PROFILE_1D_AVX2
+	if (useSIMD()) { minMax_avx2(src, n, smin, smax); }
+	else
+#endif
+	{
+		for (int i = 1; i < n; i++) {
+			if (src[i] < smin) { smin = src[i]; }
+			if (src[i] > smax) { smax = src[i]; }
+		}
+	}
+	// same scale and shift as cv::normalize
+	scale = (255.0 - 0.0) * (smax - smin > DBL_EPSILON ? 1. / (smax - smin) : 0);
+	shift = 0.0 - smin * scale;
+
+#ifdef PROFILE_1D_AVX2
+	if (useSIMD() && n >= 8) { scale8U_avx2(src, dst, n, scale, shift); return; }
+#endif
+	for (int i = 0; i < n; i++) { dst[i] = cv::saturate_cast<uchar>(src[i] * scale + shift); }
+}
+
+int otsu1D(const uchar* src, int n) {
+	int h[256] = { 0 };
+	if (n <= 0) { return 0; }
+
+	for (int i = 0; i < n; i++) { h[src[i]]++; }
+	return otsuHist1D(h, n);
+}
+
+int otsuHist1D(const int* h, int n) {
+	const int N = 256;
+	if (n <= 0) { return 0; }
+
+	// same arithmetic, in the same order, as the OpenCV implementation so the thresholds match exactly
+	double mu = 0, scale = 1. / n;
+	for (int i = 0; i < N; i++) { mu += i * (double)h[i]; }
+	mu *= scale;
+
+	double mu1 = 0, q1 = 0;
+	double max_sigma = 0, max_val = 0;
+	for (int i = 0; i < N; i++) {
+		double p_i, q2, mu2, sigma;
+
+		p_i = h[i] * scale;
+		mu1 *= q1;
+		q1 += p_i;
+		q2 = 1. - q1;
+
+		if (((q1 < q2) ? q1 : q2) < FLT_EPSILON || ((q1 > q2) ? q1 : q2) > 1. - FLT_EPSILON) { continue; }
+
+		mu1 = (mu1 + i * p_i) / q1;
+		mu2 = (mu - q1 * mu1) / q2;
+		sigma = q1 * q2 * (mu1 - mu2) * (mu1 - mu2);
+		if (sigma > max_sigma) {
+			max_sigma = sigma;
+			max_val = i;
+		}
+	}
+	return (int)max_val;
+}
+
+int multiOtsu1D(const uchar* src, int n, int maxLevels) {
+	int h[256] = { 0 };
+	int thresh, floorVal, maxThresh = -1;
+	if (n <= 0) { return -1; }
+
+	for (int i = 0; i < n; i++) { h[src[i]]++; }
+
+	for (int level = 0; level < maxLevels; level++) {
+		thresh = otsuHist1D(h, n);
+		if ((double)thresh / (level + 1) < 1) { break; }
+		// floor the values at or below the threshold by moving their counts to the floor bin. Rounded the same as cv::Mat::setTo
+		floorVal = cv::saturate_cast<uchar>((double)thresh / (level + 1));
+		for (int v = 0; v <= thresh; v++) {
+			if (v == floorVal) { continue; }
+			h[floorVal] += h[v];
+			h[v] = 0;
+		}
+		// a value that was never floored is under the mask of this level exactly when it is <= thresh, so the union of the masks
+		// is set by the highest threshold
+		if (thresh > maxThresh) { maxThresh = thresh; }
+	}
+	return maxThresh;
+}
+
+void threshold1D(const uchar* src, uchar* dst, int n, int thresh) {
+	if (thresh >= 255) { std::memset(dst, 0, n); return; }
+	if (thresh < 0) { std::memset(dst, 255, n); return; }
+#ifdef PROFILE_1D_AVX2
+	if (useSIMD()) { threshold_avx2(src, dst, n, thresh); return; }
+#endif
+	for (int i = 0; i < n; i++) { dst[i] = (src[i] > thresh) ? 255 : 0; }
+}
+
+int edgePoints1D(const uchar* src, int n, int* idx, int maxPts) {
+	int numPts = 0;
+	int prev, next;
+
+	for (int i = 0; i < n; i++) {
+		// replicate the border
+		prev = src[(i > 0) ? i - 1 : 0];
+		next = src[(i < n - 1) ? i + 1 : n - 1];
+		if (prev + next > 2 * src[i]) {
+			if (numPts < maxPts) { idx[numPts] = i; }
+			numPts++;
+		}
+	}
+	return numPts;
+}
+
+double crossing1D(double v0, double v1, double level) {
+	double t;
+
+	if (v1 == v0) { return 0.5; }
+	t = (level - v0) / (v1 - v0);
+	return (t < 0) ? 0 : (t > 1) ? 1 : t;
+}
+
+double peak1D(double vPrev, double v, double vNext) {
+	double curv = vPrev - 2 * v + vNext, t;
+
+	if (curv == 0) { return 0; }
+	t = 0.5 * (vPrev - vNext) / curv;
+	return (t < -0.5) ? -0.5 : (t > 0.5) ? 0.5 : t;
+}
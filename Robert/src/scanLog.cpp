@@ -0,0 +1,272 @@
+#include "scanLog.h"
+#include <iostream>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define SCAN_LOG_GROWTH 256 // number of records added to the mapping each time the log fills up
+
+///////////////////////////////////////  ScanLogWriter  ///////////////////////////////////////
+
+ScanLogWriter::ScanLogWriter()
+	: _recordSize(0), _capacity(0), _view(nullptr), _header(nullptr),
+#ifdef _WIN32
+	_hFile(INVALID_HANDLE_VALUE), _hMap(NULL) {}
+#else
+	_fd(-1) {}
+#endif
+
+ScanLogWriter::~ScanLogWriter() {
+	close();
+}
+
+bool ScanLogWriter::open(std::string filename, int numSignals, int numSamples) {
+	close();
+	_filename = filename;
+	_recordSize = sizeof(double) * (1 + static_cast<size_t>(numSignals) * numSamples);
+
+#ifdef _WIN32
+	_hFile = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_hFile == INVALID_HANDLE_VALUE) {
+		std::cout << "Unable to create scan log: " << filename << std::endl;
+		return false;
+	}
+#else
+	_fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (_fd < 0) {
+		std::cout << "Unable to create scan log: " << filename << std::endl;
+		return false;
+	}
+#endif
+
+	if (!_map(SCAN_LOG_GROWTH)) {
+		close();
+		return false;
+	}
+
+	// write the header
+	std::memcpy(_header->magic, SCAN_LOG_MAGIC, sizeof(_header->magic));
+	_header->version = SCAN_LOG_VERSION;
+	_header->numSignals = numSignals;
+	_header->numSamples = numSamples;
+	_header->reserved = 0;
+	_header->numRecords = 0;
+
+	_t0 = std::chrono::steady_clock::now();
+	return true;
+}
+
+bool ScanLogWriter::append(const double* data) {
+	if (!isOpen()) { return false; }
+
+	double timestamp = std::chrono::duration<double>(std::chrono::steady_clock::now() - _t0).count();
+
+	// grow the file if the mapping is full
+	if (_header->numRecords == _capacity) {
+		if (!_map(_capacity + SCAN_LOG_GROWTH)) {
+			std::cout << "Unable to extend scan log: " << _filename << std::endl;
+			close();
+			return false;
+		}
+	}
+
+	char* rec = _view + sizeof(ScanLogHeader) + _header->numRecords * _recordSize;
+	std::memcpy(rec, &timestamp, sizeof(double));
+	std::memcpy(rec + sizeof(double), data, _recordSize - sizeof(double));
+	// only count the record once it has been completely written so a crash never leaves a partial record in the log
+	_header->numRecords++;
+	return true;
+}
+
+void ScanLogWriter::close() {
+	uint64_t numRecords = size();
+	bool wasOpen = isOpen();
+	_unmap();
+
+	// truncate the file to the records that were written
+#ifdef _WIN32
+	if (_hFile != INVALID_HANDLE_VALUE) {
+		if (wasOpen) {
+			LARGE_INTEGER length;
+			length.QuadPart = sizeof(ScanLogHeader) + numRecords * _recordSize;
+			SetFilePointerEx(_hFile, length, NULL, FILE_BEGIN);
+			SetEndOfFile(_hFile);
+		}
+		CloseHandle(_hFile);
+		_hFile = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (_fd >= 0) {
+		if (wasOpen) {
+			if (ftruncate(_fd, sizeof(ScanLogHeader) + numRecords * _recordSize) != 0) {
+				std::cout << "Unable to truncate scan log: " << _filename << std::endl;
+			}
+		}
+		::close(_fd);
+		_fd = -1;
+	}
+#endif
+	_capacity = 0;
+}
+
+bool ScanLogWriter::_map(uint64_t capacity) {
+	uint64_t length = sizeof(ScanLogHeader) + capacity * _recordSize;
+	_unmap();
+
+#ifdef _WIN32
+	// creating a mapping larger than the file extends the file
+	_hMap = CreateFileMappingA(_hFile, NULL, PAGE_READWRITE, static_cast<DWORD>(length >> 32), static_cast<DWORD>(length & 0xFFFFFFFF), NULL);
+	if (_hMap == NULL) { return false; }
+	_view = static_cast<char*>(MapViewOfFile(_hMap, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+	if (_view == nullptr) {
+		CloseHandle(_hMap);
+		_hMap = NULL;
+		return false;
+	}
+#else
+	if (ftruncate(_fd, length) != 0) { return false; }
+	void* view = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+	if (view == MAP_FAILED) { return false; }
+	_view = static_cast<char*>(view);
+#endif
+
+	_header = reinterpret_cast<ScanLogHeader*>(_view);
+	_capacity = capacity;
+	return true;
+}
+
+void ScanLogWriter::_unmap() {
+	if (_view == nullptr) { return; }
+#ifdef _WIN32
+	FlushViewOfFile(_view, 0);
+	UnmapViewOfFile(_view);
+	CloseHandle(_hMap);
+	_hMap = NULL;
+#else
+	munmap(_view, sizeof(ScanLogHeader) + _capacity * _recordSize);
+#endif
+	_view = nullptr;
+	_header = nullptr;
+}
+
+///////////////////////////////////////  ScanLogReader  ///////////////////////////////////////
+
+ScanLogReader::ScanLogReader()
+	: _recordSize(0), _numRecords(0), _next(0), _numSignals(0), _numSamples(0), _speed(1), _view(nullptr),
+#ifdef _WIN32
+	_hFile(INVALID_HANDLE_VALUE), _hMap(NULL) {}
+#else
+	_fd(-1), _length(0) {}
+#endif
+
+ScanLogReader::~ScanLogReader() {
+	close();
+}
+
+bool ScanLogReader::open(std::string filename) {
+	uint64_t length = 0;
+	close();
+
+#ifdef _WIN32
+	LARGE_INTEGER fileSize;
+	_hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_hFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(_hFile, &fileSize)) {
+		std::cout << "Unable to open scan log: " << filename << std::endl;
+		close();
+		return false;
+	}
+	length = fileSize.QuadPart;
+	if (length >= sizeof(ScanLogHeader)) {
+		_hMap = CreateFileMappingA(_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (_hMap != NULL) { _view = static_cast<const char*>(MapViewOfFile(_hMap, FILE_MAP_READ, 0, 0, 0)); }
+	}
+#else
+	struct stat st;
+	_fd = ::open(filename.c_str(), O_RDONLY);
+	if (_fd < 0 || fstat(_fd, &st) != 0) {
+		std::cout << "Unable to open scan log: " << filename << std::endl;
+		close();
+		return false;
+	}
+	length = st.st_size;
+	if (length >= sizeof(ScanLogHeader)) {
+		void* view = mmap(nullptr, length, PROT_READ, MAP_SHARED, _fd, 0);
+		if (view != MAP_FAILED) {
+			_view = static_cast<const char*>(view);
+			_length = length;
+		}
+	}
+#endif
+
+	if (_view == nullptr) {
+		std::cout << "Unable to map scan log: " << filename << std::endl;
+		close();
+		return false;
+	}
+
+	// check the header
+	const ScanLogHeader* header = reinterpret_cast<const ScanLogHeader*>(_view);
+	if (std::memcmp(header->magic, SCAN_LOG_MAGIC, sizeof(header->magic)) != 0 || header->version != SCAN_LOG_VERSION) {
+		std::cout << "Not a scan log: " << filename << std::endl;
+		close();
+		return false;
+	}
+	_numSignals = header->numSignals;
+	_numSamples = header->numSamples;
+	_recordSize = sizeof(double) * (1 + static_cast<size_t>(_numSignals) * _numSamples);
+	// a log that was not closed properly can hold more bytes than records
+	_numRecords = (length - sizeof(ScanLogHeader)) / _recordSize;
+	if (header->numRecords < _numRecords) { _numRecords = header->numRecords; }
+	_next = 0;
+	return true;
+}
+
+void ScanLogReader::close() {
+#ifdef _WIN32
+	if (_view != nullptr) { UnmapViewOfFile(_view); }
+	if (_hMap != NULL) { CloseHandle(_hMap); }
+	if (_hFile != INVALID_HANDLE_VALUE) { CloseHandle(_hFile); }
+	_hMap = NULL;
+	_hFile = INVALID_HANDLE_VALUE;
+#else
+	if (_view != nullptr) { munmap(const_cast<char*>(_view), _length); }
+	if (_fd >= 0) { ::close(_fd); }
+	_fd = -1;
+	_length = 0;
+#endif
+	_view = nullptr;
+	_numRecords = 0;
+	_next = 0;
+}
+
+bool ScanLogReader::read(double* data) {
+	double timestamp, timestamp0;
+	const double* rec = record(_next, &timestamp);
+	if (rec == nullptr) { return false; }
+
+	// wait until the record is due
+	if (_speed > 0) {
+		if (_next == 0) { _t0 = std::chrono::steady_clock::now(); }
+		record(0, &timestamp0);
+		std::this_thread::sleep_until(_t0 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>((timestamp - timestamp0) / _speed)));
+	}
+
+	std::memcpy(data, rec, _recordSize - sizeof(double));
+	_next++;
+	return true;
+}
+
+const double* ScanLogReader::record(uint64_t index, double* timestamp) const {
+	if (_view == nullptr || index >= _numRecords) { return nullptr; }
+	const char* rec = _view + sizeof(ScanLogHeader) + index * _recordSize;
+	if (timestamp != NULL) { std::memcpy(timestamp, rec, sizeof(double)); }
+	return reinterpret_cast<const double*>(rec + sizeof(double));
+}
@@ -0,0 +1,97 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+#include "scanScheduler.h"
+#include "path.h"
+#include "myTypes.h"
+#include "myGlobals.h"
+
+#define MAX_PATH_DIST 1.0 // maximum distance from the nearest waypoint in [mm] for the scanner to be considered on the path
+#define MAX_WAIT 2.0 // maximum time to wait for the next trigger in [s]
+#define MAX_LOOKAHEAD 8 // number of segments ahead of the segment being scanned that the gantry is searched for on
+
+ScanScheduler::ScanScheduler(const std::vector<std::vector<Path>>& path, double pitch)
+	: _path(path), _pitch(pitch), _segNum(0), _printSeg(0), _hasLast(false), _lastFeed(0), _numTriggers(0), _acqTime(0), _waitTime(0) {}
+
+double ScanScheduler::_feedRate(const cv::Point2d& pos) {
+	int waypoint, seg;
+
+	// the gantry prints ahead of the segment being scanned, e.g. a horizontal rod is only marked as scanned once the next
+	// horizontal rod has been printed, so search forward from the segment the gantry was last found on
+	seg = findPathSegment(_path, pos, std::max((int)_segNum, _printSeg), MAX_LOOKAHEAD, MAX_PATH_DIST, waypoint);
+	if (seg < 0) { return 0; }
+	_printSeg = seg;
+	return _path[seg][waypoint].f;
+}
+
+void ScanScheduler::wait() {
+	if (!enabled() || !_hasLast || _lastFeed <= 0) { return; }
+
+	double delay = _pitch / _lastFeed;
+	Coords pos;
+	std::chrono::steady_clock::time_point tNow = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point tNext = _lastTrigger + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(delay));
+	std::chrono::steady_clock::time_point tLimit = _lastTrigger + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(MAX_WAIT));
+
+	if (positionService.running()) {
+		// sleep through most of the planned travel, then trigger when the live position has moved the pitch
+		tNext = _lastTrigger + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(0.9 * delay));
+		std::this_thread::sleep_until(tNext < tLimit ? tNext : tLimit);
+		while (std::chrono::steady_clock::now() < tLimit) {
+			if (positionService.read(pos) && std::hypot(pos.x - _lastPos.x, pos.y - _lastPos.y) >= _pitch) { break; }
+			std::this_thread::sleep_for(std::chrono::microseconds(500));
+		}
+	}
+	else {
+		std::this_thread::sleep_until(tNext < tLimit ? tNext : tLimit);
+	}
+	if (std::chrono::steady_clock::now() > tNow) { _waitTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - tNow).count(); }
+}
+
+void ScanScheduler::triggered(const cv::Point2d& pos, std::chrono::steady_clock::time_point tTrigger, double acqTime) {
+	double dist;
+
+	// only count the spacing of consecutive scans along the path, not the jumps between segments
+	if (_hasLast && _lastFeed > 0) {
+		dist = cv::norm(pos - _lastPos);
+		if (dist < 3 * _pitch) { _pitches.push_back(dist); }
+	}
+	if (!_hasLast) { _firstTrigger = tTrigger; }
+	_hasLast = true;
+	_lastPos = pos;
+	_lastTrigger = tTrigger;
+	_lastFeed = _feedRate(pos);
+	_numTriggers++;
+	_acqTime += acqTime;
+}
+
+void ScanScheduler::printStats() const {
+	double mean = 0, stdev = 0, elapsed, meanAcq;
+	int saved = 0;
+
+	if (!enabled()) { return; }
+	if (_numTriggers < 2) {
+		std::cout << "Scan scheduler: not enough scans to report the pitch." << std::endl;
+		return;
+	}
+	if (!_pitches.empty()) {
+		mean = std::accumulate(_pitches.begin(), _pitches.end(), 0.0) / _pitches.size();
+		for (auto it = _pitches.begin(); it != _pitches.end(); ++it) { stdev += (*it - mean) * (*it - mean); }
+		stdev = std::sqrt(stdev / _pitches.size());
+		std::cout << "Scan pitch: target " << _pitch << " mm, achieved " << mean << " +/- " << stdev << " mm (min "
+			<< *std::min_element(_pitches.begin(), _pitches.end()) << ", max " << *std::max_element(_pitches.begin(), _pitches.end())
+			<< ", " << _pitches.size() << " intervals)" << std::endl;
+	}
+	// free running, the scanner would have been triggered once per data collection
+	elapsed = std::chrono::duration<double>(_lastTrigger - _firstTrigger).count();
+	meanAcq = _acqTime / _numTriggers;
+	if (meanAcq > 0) { saved = (int)std::round(elapsed / meanAcq) + 1 - _numTriggers; }
+	std::cout << "Scan scheduler: " << _numTriggers << " acquisitions, " << (saved > 0 ? saved : 0) << " saved, "
+		<< _waitTime << " s spent waiting" << std::endl;
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+#include <opencv2/core.hpp>
+
+#include "scanWorkers.h"
+#include "scanning.h"
+
+void processScan(const cv::Mat& window, const cv::Rect2d& printROI, cv::Size rasterSize, const EdgeBoundary& edgeBoundary, int scanDepth,
+	ScanWorkspace& sw, ScanResult& result) {
+	result.valid = false;
+	result.edges.clear();
+	result.heights.clear();
+
+	// skip the profile extraction if the scanner is nowhere near the print
+	getScanPos(window, &result.fbk);
+	result.nearROI = scanNearROI(result.fbk, printROI);
+	if (!result.nearROI) { return; }
+
+	// Find the part of the scan that is within the ROI of the print and find the edges
+	if (getScan(window, &result.fbk, sw.scan, sw.locXoffset, sw.ws, scanDepth) &&
+		scan2ROI(sw.scan, result.fbk, sw.locXoffset, printROI, rasterSize, sw.scanROI, result.scanStart, result.scanEnd)) {
+		// keep the resampled profile for the height map of the layer
+		result.heights.resize(sw.scanROI.cols);
+		if (sw.scanROI.depth() == CV_32F) { std::copy(sw.scanROI.ptr<float>(0), sw.scanROI.ptr<float>(0) + sw.scanROI.cols, result.heights.begin()); }
+		else {
+			const double* z = sw.scanROI.ptr<double>(0);
+			for (int i = 0; i < sw.scanROI.cols; i++) { result.heights[i] = (float)z[i]; }
+		}
+		sw.detector->find(edgeBoundary, result.scanStart, result.scanEnd, sw.scanROI, result.edges);
+		result.valid = true;
+	}
+}
+
+///////////////////////////////////////  ScanWorkers  ///////////////////////////////////////
+ScanWorkers::ScanWorkers(int numWorkers, std::function<void(long long ticket, int worker)> process)
+	: _process(process), _nextTicket(0), _doneBelow(0), _stop(false) {
+	if (numWorkers < 1) { numWorkers = 1; }
+	for (int i = 0; i < numWorkers; i++) {
+		_threads.push_back(std::thread{ &ScanWorkers::_run, this, i });
+	}
+}
+
+ScanWorkers::~ScanWorkers() {
+	waitAll();
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		_stop = true;
+	}
+	task_cond.notify_all();
+	for (auto& t : _threads) {
+		if (t.joinable()) { t.join(); }
+	}
+}
+
+long long ScanWorkers::submit() {
+	long long ticket;
+	{
+		std::lock_guard<std::mutex> lk(mut);
+		ticket = _nextTicket++;
+		_queue.push_back(ticket);
+	}
+	task_cond.notify_one();
+	return ticket;
+}
+
+bool ScanWorkers::wait(long long ticket, std::chrono::milliseconds timeout) {
+	std::unique_lock<std::mutex> lk(mut);
+	return done_cond.wait_for(lk, timeout, [this, ticket] {return _isDone(ticket); });
+}
+
+void ScanWorkers::waitAll() {
+	std::unique_lock<std::mutex> lk(mut);
+	done_cond.wait(lk, [this] {return _doneBelow == _nextTicket; });
+}
+
+long long ScanWorkers::pending() const {
+	std::lock_guard<std::mutex> lk(mut);
+	return _nextTicket - _doneBelow - (long long)_doneAbove.size();
+}
+
+void ScanWorkers::_run(int worker) {
+	long long ticket;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lk(mut);
+			task_cond.wait(lk, [this] {return _stop || !_queue.empty(); });
+			if (_queue.empty()) { return; }
+			ticket = _queue.front();
+			_queue.pop_front();
+		}
+
+		_process(ticket, worker);
+
+		{
+			std::lock_guard<std::mutex> lk(mut);
+			// advance the watermark past every ticket that has now been processed
+			if (ticket == _doneBelow) {
+				_doneBelow++;
+				while (!_doneAbove.empty() && *_doneAbove.begin() == _doneBelow) {
+					_doneAbove.erase(_doneAbove.begin());
+					_doneBelow++;
+				}
+			}
+			else { _doneAbove.insert(ticket); }
+		}
+		done_cond.notify_all();
+	}
+}
@@ -1,10 +1,13 @@
 #include "myGlobals.h"
 #include "constants.h"
+#include "resolution.h"
 #include "scanning.h"
 #include "A3200.h"
 #include <iostream>
 #include <cmath>
 #include <deque>
+#include <thread>
+#include <chrono>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include "A3200_functions.h"
@@ -38,7 +41,13 @@ bool setupDataCollection(A3200Handle handle, A3200DataCollectConfigHandle DCCHan
 	return true;
 }
 
-bool collectData(A3200Handle handle, A3200DataCollectConfigHandle DCCHandle, DOUBLE* data) {
+bool setCollectionTriggers(A3200Handle handle, A3200DataCollectConfigHandle DCCHandle, int numTriggers) {
+	if (!A3200DataCollectionConfigSetSamples(DCCHandle, NUM_DATA_SAMPLES * numTriggers)) { return false; }
+	if (!A3200DataCollectionConfigApply(handle, DCCHandle)) { return false; }
+	return true;
+}
+
+bool collectData(A3200Handle handle, A3200DataCollectConfigHandle DCCHandle, DOUBLE* data, int numTriggers) {
 	WORD itemIndexArray[] = { AXISINDEX_00, AXISINDEX_01, AXISINDEX_02, AXISINDEX_03 };
 	STATUSITEM itemCodeArray[] = { STATUSITEM_AxisStatus, STATUSITEM_AxisStatus, STATUSITEM_AxisStatus, STATUSITEM_AxisStatus };
 	DWORD itemExtrasArray[] = { AXISSTATUS_Profiling, AXISSTATUS_Profiling, AXISSTATUS_Profiling, AXISSTATUS_Profiling };
@@ -58,25 +67,40 @@ bool collectData(A3200Handle handle, A3200DataCollectConfigHandle DCCHandle, DOU
 	//}
 	//else { ret = false; }
 
-	{
+	// Send one trigger at the start of each NUM_DATA_SAMPLES window of the collection
+	auto tStart = std::chrono::steady_clock::now();
+	for (int i = 0; i < numTriggers; i++) {
+		std::this_thread::sleep_until(tStart + std::chrono::duration<double, std::milli>(i * NUM_DATA_SAMPLES * SAMPLING_TIME));
 		std::lock_guard<std::mutex> lock(mut_cmd);
 		if (!A3200IOAnalogOutput(handle, TASK_SCAN, 0, AXISINDEX_00, -6)) { A3200Error(); }
 		if (!A3200IOAnalogOutput(handle, TASK_SCAN, 0, AXISINDEX_00, 0)) { A3200Error(); }
 	}
 
 	// Retrieving the collected data
-	if (!A3200DataCollectionDataRetrieve(handle, NUM_DATA_SIGNALS, NUM_DATA_SAMPLES, (DOUBLE*)data)) { A3200Error(); return false; }
+	if (!A3200DataCollectionDataRetrieve(handle, NUM_DATA_SIGNALS, NUM_DATA_SAMPLES * numTriggers, (DOUBLE*)data)) { A3200Error(); return false; }
 
 	return ret;
 }
 
+void splitScans(double* data, int numTriggers, std::vector<cv::Mat>& windows) {
+	cv::Mat dataMat(NUM_DATA_SIGNALS, NUM_DATA_SAMPLES * numTriggers, CV_64F, data);
+
+	windows.resize(numTriggers);
+	for (int i = 0; i < numTriggers; i++) {
+		windows[i] = dataMat.colRange(i * NUM_DATA_SAMPLES, (i + 1) * NUM_DATA_SAMPLES);
+	}
+}
+
 bool getScan(double data[][NUM_DATA_SAMPLES], Coords* fbk, cv::Mat& scan, int &locXoffset) {
+	return getScan(cv::Mat(NUM_DATA_SIGNALS, NUM_DATA_SAMPLES, CV_64F, data), fbk, scan, locXoffset);
+}
+
+bool getScan(const cv::Mat& dataMat, Coords* fbk, cv::Mat& scan, int& locXoffset) {
 	int fbIdx[2], voltHead[2];
 	int scanStartIdx, scanEndIdx;
 	cv::Mat scanVoltage_8U, scanEdges;
 	std::vector<cv::Point> scanEdgesIdx;
 	cv::Mat morph, kern;
-	cv::Mat dataMat(NUM_DATA_SIGNALS, NUM_DATA_SAMPLES, CV_64F, data); // copying the collected data into a matrix
 	int scanXtrunc = 20;
 
 	// Get the position feedback when the laser was triggered
@@ -128,45 +152,175 @@ bool getScan(double data[][NUM_DATA_SAMPLES], Coords* fbk, cv::Mat& scan, int &l
 		return false;
 }
 
-bool scan2ROI(cv::Mat& scan, const Coords fbk, const int locXoffset, const cv::Rect2d printROI, cv::Size rasterSize, cv::Mat& scanROI, cv::Point& scanStart, cv::Point& scanEnd) {
-	cv::Point2d XY_start, XY_end;
-	double X, Y;
-	double local_x;
-	int startIdx = -1, endIdx = -1;
-	double dx = SCAN_WIDTH / (NUM_PROFILE_PTS - 1);
+int getScanPos(const cv::Mat& dataMat, Coords* fbk) {
+	//find the rising edge of the trigger signal sent to the laser
+	int fbIdx = argMax1D(dataMat.ptr<double>(1), dataMat.cols);
 
-	for (int i = 0; i < scan.cols; i++) {
-		// Local coordinate of the scanned point (with respect to the scanner)
-		local_x = -SCAN_WIDTH / 2 + dx * (i + locXoffset) + SCAN_OFFSET_Y;
-		// Transforming local coordinate to global coordinates
-		X = fbk.x + SCAN_OFFSET_X * cos(fbk.T * PI / -180) - (local_x) * sin(fbk.T * PI / -180);
-		Y = fbk.y + SCAN_OFFSET_X * sin(fbk.T * PI / -180) + (local_x) * cos(fbk.T * PI / -180);
-		// Check if scanned point in outside the print ROI 
-		if (!printROI.contains(cv::Point2d(X, Y))) {
-		}
-		else if (startIdx == -1) {
-			startIdx = i;
-			XY_start = cv::Point2d(X, Y);
+	//NOTE: feedback values are given as counts and can be converted using the CountsPerUnit Parameter in the A3200 software
+	fbk->x = dataMat.at<double>(2, fbIdx) / -1000; // assigning the position feedback values
+	fbk->y = dataMat.at<double>(3, fbIdx) / 1000;
+	fbk->z = dataMat.at<double>(4, fbIdx) / 10000;
+	fbk->T = dataMat.at<double>(5, fbIdx) * 360 / 200000;
+	return fbIdx;
+}
+
+bool scanNearROI(const Coords fbk, const cv::Rect2d printROI, double margin) {
+	double c = cos(fbk.T * PI / -180), s = sin(fbk.T * PI / -180);
+	double local_x[2] = { -SCAN_WIDTH / 2 + SCAN_OFFSET_Y, SCAN_WIDTH / 2 + SCAN_OFFSET_Y };
+	double X[2], Y[2];
+
+	// end points of the scan line, using the same transformation as scan2ROI
+	for (int i = 0; i < 2; i++) {
+		X[i] = fbk.x + SCAN_OFFSET_X * c - local_x[i] * s;
+		Y[i] = fbk.y + SCAN_OFFSET_X * s + local_x[i] * c;
+	}
+	// check if the bounding box of the scan line overlaps the ROI
+	return ((X[0] < X[1] ? X[0] : X[1]) - margin <= printROI.br().x)
+		&& ((X[0] > X[1] ? X[0] : X[1]) + margin >= printROI.tl().x)
+		&& ((Y[0] < Y[1] ? Y[0] : Y[1]) - margin <= printROI.br().y)
+		&& ((Y[0] > Y[1] ? Y[0] : Y[1]) + margin >= printROI.tl().y);
+}
+
+bool getScan(const cv::Mat& dataMat, Coords* fbk, cv::Mat& scan, int& locXoffset, ProfileWorkspace& ws, int depth) {
+	int fbIdx, voltHead, len;
+	int scanStartIdx, scanEndIdx;
+	int scanEdgesIdx[3], numEdges;
+	const double* volt = dataMat.ptr<double>(0);
+	const double gain = 1. / OPAMP_GAIN;
+	int scanXtrunc = 20;
+	bool triggered = false;
+
+	// Get the position feedback when the laser was triggered
+	fbIdx = getScanPos(dataMat, fbk);
+
+	// check if the scan voltage goes below 3V to verify a scan was sent
+	for (int i = 0; i < dataMat.cols; i++) {
+		if (!(volt[i] >= 3 && volt[i] < DBL_MAX)) { triggered = true; break; }
+	}
+	if (!triggered) { return false; }
+
+	// Search only the data after the triggering signal was sent
+	volt += fbIdx;
+	len = dataMat.cols - fbIdx;
+	ws.reserve(len);
+
+	// Finding the voltage header of the scanner signal, i.e find the start of the scanned profile
+	blackhat1D(volt, ws.morph.data(), len, 4, ws);
+	voltHead = argMax1D(ws.morph.data(), len);
+
+	// Isolating the scanned profile
+	normalize1D(volt, ws.norm.data(), len);
+	threshold1D(ws.norm.data(), ws.mask.data(), len, otsu1D(ws.norm.data(), len));
+	maxFilter1D(ws.mask.data(), ws.dilMask.data(), len, 4);
+	numEdges = edgePoints1D(ws.dilMask.data(), len, scanEdgesIdx, 3);
+	// Check if entire scan captured
+	if (numEdges == 2) {
+		locXoffset = scanEdgesIdx[0] - voltHead + scanXtrunc;
+		scanStartIdx = fbIdx + scanEdgesIdx[0] + scanXtrunc;
+		scanEndIdx = fbIdx + scanEdgesIdx[1];
+	}
+	else if (numEdges == 1) {
+		locXoffset = scanEdgesIdx[0] - voltHead + scanXtrunc;
+		scanStartIdx = fbIdx + scanEdgesIdx[0] + scanXtrunc;
+		scanEndIdx = dataMat.cols;
+	}
+	else
+		return false;
+
+	if (scanStartIdx < scanEndIdx) {
+		// converting to height. Adding 0 matches cv::Mat::convertTo, which turns -0 into 0
+		volt = dataMat.ptr<double>(0);
+		if (depth == CV_32F) {
+			for (int i = scanStartIdx; i < scanEndIdx; i++) {
+				ws.profile32[i - scanStartIdx] = (float)(volt[i] * gain);
+			}
+			scan = cv::Mat(1, scanEndIdx - scanStartIdx, CV_32F, ws.profile32.data());
 		}
 		else {
-			endIdx = i;
-			XY_end = cv::Point2d(X, Y);
+			for (int i = scanStartIdx; i < scanEndIdx; i++) {
+				ws.profile[i - scanStartIdx] = volt[i] * gain + 0.0;
+			}
+			scan = cv::Mat(1, scanEndIdx - scanStartIdx, CV_64F, ws.profile.data());
 		}
+		return true;
+	}
+	else
+		return false;
+}
+
+/**
+ * @brief Linear resampling of len points onto count points, same as cv::resize with cv::INTER_LINEAR
+*/
+template <typename T>
+static void resampleLine(const T* src, int len, T* dst, int count) {
+	double scale = (double)len / count, fx;
+	int sx;
+
+	for (int i = 0; i < count; i++) {
+		fx = (i + 0.5) * scale - 0.5;
+		sx = (int)std::floor(fx);
+		fx -= sx;
+		if (sx < 0) { sx = 0; fx = 0; }
+		if (sx >= len - 1) { sx = len - 1; fx = 0; }
+		dst[i] = (fx == 0) ? src[sx] : (T)(src[sx] * (1 - fx) + src[sx + 1] * fx);
+	}
+}
+
+bool scan2ROI(cv::Mat& scan, const Coords fbk, const int locXoffset, const cv::Rect2d printROI, cv::Size rasterSize, cv::Mat& scanROI, cv::Point& scanStart, cv::Point& scanEnd) {
+	cv::Point2d XY_start, XY_end;
+	int startIdx, endIdx;
+	double dx = SCAN_WIDTH / (NUM_PROFILE_PTS - 1);
+	double c = cos(fbk.T * PI / -180), s = sin(fbk.T * PI / -180);
+	double tmin = 0, tmax = scan.cols - 1;
+	bool inROI = scan.cols > 1;
+
+	// Global coordinates of the i-th scanned point
+	auto scanPt = [&](int i) {
+		double local_x = -SCAN_WIDTH / 2 + dx * (i + locXoffset) + SCAN_OFFSET_Y;
+		return cv::Point2d(fbk.x + SCAN_OFFSET_X * c - (local_x) * s, fbk.y + SCAN_OFFSET_X * s + (local_x) * c);
+	};
+	// Clips the range of scan indices [tmin, tmax] to lo <= p0 + t * d < hi
+	auto clip = [&](double p0, double d, double lo, double hi) {
+		if (d == 0) { return (p0 >= lo) && (p0 < hi); }
+		double t0 = (lo - p0) / d, t1 = (hi - p0) / d;
+		if (t0 > t1) { std::swap(t0, t1); }
+		if (t0 > tmin) { tmin = t0; }
+		if (t1 < tmax) { tmax = t1; }
+		return tmin <= tmax;
+	};
+
+	// Clip the scan line against the ROI (Liang-Barsky)
+	cv::Point2d p0 = scanPt(0), d = scanPt(1) - p0;
+	inROI = inROI && clip(p0.x, d.x, printROI.tl().x, printROI.br().x) && clip(p0.y, d.y, printROI.tl().y, printROI.br().y);
+	if (inROI) {
+		startIdx = (int)std::ceil(tmin);
+		endIdx = (int)std::floor(tmax);
+		// the clipped range can be off by a sample due to rounding, so check the end points against the ROI
+		if (startIdx > 0 && printROI.contains(scanPt(startIdx - 1))) { startIdx--; }
+		while (startIdx <= endIdx && !printROI.contains(scanPt(startIdx))) { startIdx++; }
+		if (endIdx < scan.cols - 1 && printROI.contains(scanPt(endIdx + 1))) { endIdx++; }
+		while (endIdx >= startIdx && !printROI.contains(scanPt(endIdx))) { endIdx--; }
+		// at least two points of the scan need to be in the ROI
+		inROI = startIdx < endIdx;
 	}
 
 	// Check to see if the scan was in the ROI
-	if ((startIdx != -1) && (endIdx != -1)) {
+	if (inROI) {
+		XY_start = scanPt(startIdx);
+		XY_end = scanPt(endIdx);
 		//convert the start and end (X,Y) coordinates of the scan to points on the image
-		scanStart = cv::Point(MM2PIX(XY_start.x - printROI.tl().x), MM2PIX(XY_start.y - printROI.tl().y));
-		scanEnd = cv::Point(MM2PIX(XY_end.x - printROI.tl().x), MM2PIX(XY_end.y - printROI.tl().y));
-		cv::Range scanROIRange = cv::Range(startIdx, endIdx);
+		scanStart = cv::Point(resolution.toPix(XY_start.x - printROI.tl().x), resolution.toPix(XY_start.y - printROI.tl().y));
+		scanEnd = cv::Point(resolution.toPix(XY_end.x - printROI.tl().x), resolution.toPix(XY_end.y - printROI.tl().y));
 
 		// Interpolate scan so it is the same scale as the raster reference image
 		cv::LineIterator it(rasterSize, scanStart, scanEnd, 8); // make a line iterator between the start and end points of the scan
 		if (it.count == 0) {
 			return false;
 		}
-		cv::resize(scan.colRange(scanROIRange), scanROI, cv::Size(it.count, scan.rows), cv::INTER_LINEAR);
+		// Linear resampling of the points [startIdx, endIdx) onto the pixels of the line, same as cv::resize with cv::INTER_LINEAR
+		scanROI.create(1, it.count, scan.type());
+		if (scan.depth() == CV_32F) { resampleLine(scan.ptr<float>(0) + startIdx, endIdx - startIdx, scanROI.ptr<float>(0), it.count); }
+		else { resampleLine(scan.ptr<double>(0) + startIdx, endIdx - startIdx, scanROI.ptr<double>(0), it.count); }
 		return true;
 	}
 	else {
@@ -175,44 +329,35 @@ bool scan2ROI(cv::Mat& scan, const Coords fbk, const int locXoffset, const cv::R
 		scanEnd = cv::Point(-1, -1);
 		return false;
 	}
-
-	return false;
 }
 
 void findEdges(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, cv::Mat& edges, double heightThresh, int order) {
+	std::vector<cv::Point2f> edgePts;
+
+	findEdges(edgeBoundary, scanStart, scanEnd, scanROI, edgePts, heightThresh, order);
+	for (auto it = edgePts.begin(); it != edgePts.end(); ++it) { edges.at<uchar>(cv::Point(*it)) = 255; }
+}
+
+void findEdges(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, std::vector<cv::Point2f>& edgePts, double heightThresh, int order) {
+	findEdges(EdgeBoundary(edgeBoundary), scanStart, scanEnd, scanROI, edgePts, heightThresh, order);
+}
+
+void findEdges(const EdgeBoundary& edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, std::vector<cv::Point2f>& edgePts, double heightThresh, int order) {
+	edgePts.clear();
 
 	if ((scanStart != cv::Point(-1, -1)) && (scanEnd != cv::Point(-1, -1))) //Check if scan is within ROI
 	{
-		cv::LineIterator lineit(edgeBoundary, scanStart, scanEnd, 8);
-		std::deque<int> windowPts;
-		uchar lastVal = 0;
-		uchar curVal = 0;
-		int numRising = 0, numFalling = 0;
+		std::vector<int> windowPts;
 		cv::Point2d edgeCoord, slope;
+		// number of points of a cv::LineIterator along the scan
+		int count = std::max(std::abs(scanEnd.x - scanStart.x), std::abs(scanEnd.y - scanStart.y)) + 1;
 
 		// Initialize local masks to zero
 		//cv::Mat locEdges = cv::Mat::zeros(scanROI.size(), CV_8U);
 		//cv::Mat locWin = cv::Mat::zeros(scanROI.size(), CV_8U);
 
-		// find the intersection of the scan and the edge boundary using a line iterator
-		for (int i = 0; i < lineit.count; i++, ++lineit) {
-			curVal = *(const uchar*)*lineit;
-			if ((curVal == 255) && (lastVal == 0) && (i != 0)) { // find rising edges
-				windowPts.push_back(i);
-				numRising++;
-			}
-			if ((curVal == 0) && (lastVal == 255) && (i != 0) && (numRising > 0)) { // find falling edges
-				windowPts.push_back(i);
-				numFalling++;
-			}
-			lastVal = curVal;
-		}
-		// Check if equal number of rising and falling edges (i.e. an odd number of window points)
-		if ((windowPts.size() % 2) != 0) {
-			// if scan ends in the middle of a rod, remove the last point; Otherwise, scan start in the middle of a rod so remove the first point
-			if (numRising > numFalling) { windowPts.pop_back(); }
-			else { windowPts.pop_front(); }
-		}
+		// find the windows where the scan crosses the edge boundary
+		edgeBoundary.windows(scanStart, scanEnd, windowPts);
 
 		// create a height mask for the scan profile to remove all edges below a height threshold
 		cv::Mat heightMask;
@@ -222,6 +367,7 @@ void findEdges(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv:
 
 		// Search within the edges of the dialated raster for the actual edges
 		cv::Range searchRange;
+		long minWindow = resolution.toPix(0.5); // narrowest search window in [px]
 		// Take derivative and blur
 		cv::Mat dx, ROIblur;
 		int aperture_size = 7;
@@ -229,6 +375,8 @@ void findEdges(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv:
 		int sz = 19;
 		cv::GaussianBlur(scanROI, ROIblur, cv::Size(sz, sz), (double)sigma / 10);
 		cv::Sobel(ROIblur, dx, -1, order, 0, aperture_size, 1, 0, cv::BORDER_REPLICATE);
+		auto derivative = [&dx](int i) { return (dx.depth() == CV_32F) ? (double)dx.at<float>(0, i) : dx.at<double>(0, i); };
+		double pos;
 
 		//plotScan(scanROI);
 
@@ -238,7 +386,7 @@ void findEdges(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv:
 		// loop through all the search windows
 		for (auto it = windowPts.begin(); it != windowPts.end(); std::advance(it, 2)) {
 			// Check if the search window is at least 0.5mm wide
-			if ((*std::next(it) - *it) > MM2PIX(0.5)) {
+			if ((*std::next(it) - *it) > minWindow) {
 				if (order == 1) {
 					// set the window search range
 					searchRange = cv::Range(*it, *std::next(it));
@@ -262,13 +410,18 @@ void findEdges(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv:
 				}
 
 				// mark edges on local profile and global ROI
-				slope = cv::Point2d(scanEnd - scanStart) / lineit.count;
+				slope = cv::Point2d(scanEnd - scanStart) / count;
 				for (int j = 0; j < 2; j++) {
-					edgeCoord = cv::Point2d(scanStart) + foundEdges[j] * slope;
+					// the edge is at the vertex of the parabola through the extremum of the derivative and its neighbours
+					pos = foundEdges[j];
+					if (foundEdges[j] > 0 && foundEdges[j] < dx.cols - 1) {
+						pos += peak1D(derivative(foundEdges[j] - 1), derivative(foundEdges[j]), derivative(foundEdges[j] + 1));
+					}
+					edgeCoord = cv::Point2d(scanStart) + pos * slope;
 					// check if edges are within height mask
 					if ((heightMask.at<uchar>(cv::Point(foundEdges[j], 0)) == 255) && (foundEdges[j] != *it) && (foundEdges[j] != *std::next(it))) {
 						//locEdges.at<uchar>(cv::Point(foundEdges[j], 0)) = 255;
-						edges.at<uchar>(cv::Point2i(edgeCoord)) = 255;
+						edgePts.push_back(edgeCoord);
 					}
 				}
 				// mark window borders
@@ -282,16 +435,25 @@ void findEdges(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv:
 }
 
 void findEdges2(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, cv::Mat& edges) {
+	std::vector<cv::Point2f> edgePts;
+
+	findEdges2(edgeBoundary, scanStart, scanEnd, scanROI, edgePts);
+	for (auto it = edgePts.begin(); it != edgePts.end(); ++it) { edges.at<uchar>(cv::Point(*it)) = 255; }
+}
+
+void findEdges2(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv::Mat& scanROI, std::vector<cv::Point2f>& edgePts) {
+	edgePts.clear();
 
 	if ((scanStart != cv::Point(-1, -1)) && (scanEnd != cv::Point(-1, -1))) //Check if scan is within ROI
 	{
 		cv::LineIterator lineit(edgeBoundary, scanStart, scanEnd, 8);
-		cv::Point2d edgeCoord, slope;
+		cv::Point2d slope, edgeCoord;
+		cv::Point edgePix;
 
 		cv::Mat ROIblur, ROInorm, threshMask, pkMask, profile, edgeMask, kern, mask;
 		cv::Scalar mean, stddev;
-		int sigma, sz;
-		double thresh, floorVal;
+		int sigma, sz, j;
+		double thresh, level, pos;
 
 		// Blur the scan
 		sigma = 61;
@@ -303,25 +465,11 @@ void findEdges2(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv
 			// Convert and normalize the ROI profile to use the thresholding operation
 			cv::normalize(ROIblur, ROInorm, 0, 255, cv::NORM_MINMAX, CV_8U);
 
-			// Recursive Otsu thresholding
-			pkMask = cv::Mat::zeros(ROInorm.size(), CV_8U);
-			kern = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5));
-			for (int i = 0; i < 7; i++) 
-			{
-				// threshold the image
-				thresh = cv::threshold(ROInorm, threshMask, 2, 255, cv::THRESH_BINARY_INV + cv::THRESH_OTSU);
-				// set all values in the normed profile below the threshod to the floor value
-				floorVal = (thresh) / ((double)i + 1);
-				if (floorVal < 1) { break; }
-				cv::Mat(ROInorm.size(), ROInorm.type(), cv::Scalar(floorVal)).copyTo(ROInorm, threshMask);
-				// Cumulatively add the thresh masks to form the 
-				cv::bitwise_or(threshMask, pkMask, pkMask);
-
-				/*auto ax2 = CvPlot::makePlotAxes();
-				ax2.create<CvPlot::Series>(edgePlot, "-k"); // put "ROInorm.copyTo(edgePlot);" before for loop
-				ax2.create<CvPlot::Series>(ROInorm, "-b");
-				cv::Mat ax_2 = ax2.render();*/
-			}
+			// Recursive Otsu thresholding. The levels are found from one histogram and the union of their masks is everything
+			// at or below the highest threshold (see multiOtsu1D)
+			thresh = multiOtsu1D(ROInorm.ptr<uchar>(), (int)ROInorm.total(), 7);
+			if (thresh < 0) { pkMask = cv::Mat::zeros(ROInorm.size(), CV_8U); }
+			else { cv::threshold(ROInorm, pkMask, thresh, 255, cv::THRESH_BINARY_INV); }
 
 			cv::meanStdDev(scanROI, mean, stddev, pkMask);
 			ROIblur.copyTo(profile);
@@ -331,25 +479,26 @@ void findEdges2(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv
 			//cv::morphologyEx(profile, profile, cv::MORPH_DILATE, kern, cv::Point(-1, -1), 1);
 			sigma = 19;
 			cv::GaussianBlur(profile, profile, cv::Size(sz, sz), (double)sigma / 10);
-			edgeMask = profile > (mean.val[0] + 0.005);
+			level = mean.val[0] + 0.005;
+			threshMask = profile > level;
 
-			cv::Sobel(edgeMask, edgeMask, -1, 2, 0, 1, 1, 0, cv::BORDER_REPLICATE); 
+			cv::Sobel(threshMask, edgeMask, -1, 2, 0, 1, 1, 0, cv::BORDER_REPLICATE); 
 			// ksize = 3 gives the inner edge, ksize = 1 gives the outer edge
 
 			// filter out any peaks near the edges of the scan
-			if (pkMask.cols < MM2PIX(1.0))
+			if (pkMask.cols < resolution.toPix(1.0))
 			{
 				mask = 255 * cv::Mat::ones(pkMask.size(), CV_8U);
 			}
 			else
 			{
 				mask = cv::Mat::zeros(pkMask.size(), CV_8U);
-				mask(cv::Range(0, 1), cv::Range(MM2PIX(0.5), mask.cols - MM2PIX(0.5))) = 255;
+				mask(cv::Range(0, 1), cv::Range(resolution.toPix(0.5), mask.cols - resolution.toPix(0.5))) = 255;
 			}
 			cv::bitwise_and(edgeMask, mask, edgeMask);
 			
-			std::vector<cv::Point> edgePts;
-			cv::findNonZero(edgeMask, edgePts);
+			std::vector<cv::Point> scanEdgePts;
+			cv::findNonZero(edgeMask, scanEdgePts);
 
 #ifdef DEBUG_SCANNING
 			cv::Mat edgePlot = NAN*cv::Mat::ones(ROIblur.size(), ROIblur.type());
@@ -395,13 +544,21 @@ void findEdges2(cv::Mat edgeBoundary, cv::Point scanStart, cv::Point scanEnd, cv
 			}
 #endif // DEBUG_SCANNING
 
-			// mark edges on global ROI
+			// convert the edges that are inside the boundary to global coordinates
 			slope = cv::Point2d(scanEnd - scanStart) / lineit.count;
-			for (auto it = edgePts.begin(); it != edgePts.end(); ++it) {
-				edgeCoord = cv::Point2d(scanStart) + (*it).x * slope;
-				edges.at<uchar>(cv::Point2i(edgeCoord)) = 255;
+			auto profileAt = [&profile](int k) { return (profile.depth() == CV_32F) ? (double)profile.at<float>(0, k) : profile.at<double>(0, k); };
+			for (auto it = scanEdgePts.begin(); it != scanEdgePts.end(); ++it) {
+				// the edge pixel is just outside the thresholded profile, so move it to where the profile crosses the
+				// threshold between the edge pixel and its neighbour inside the threshold
+				j = ((*it).x + 1 < threshMask.cols && threshMask.at<uchar>(0, (*it).x + 1) != 0) ? (*it).x + 1 : (*it).x - 1;
+				pos = (*it).x;
+				if (j >= 0) { pos += (j - (*it).x) * crossing1D(profileAt((*it).x), profileAt(j), level); }
+				edgeCoord = cv::Point2d(scanStart) + pos * slope;
+				edgePix = edgeCoord;
+				if (edgePix.x >= 0 && edgePix.y >= 0 && edgePix.x < edgeBoundary.cols && edgePix.y < edgeBoundary.rows && edgeBoundary.at<uchar>(edgePix) != 0) {
+					edgePts.push_back(edgeCoord);
+				}
 			}
-			cv::bitwise_and(edgeBoundary, edges, edges);
 		}
 	}
 }
\ No newline at end of file
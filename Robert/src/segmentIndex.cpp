@@ -0,0 +1,122 @@
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <opencv2/core.hpp>
+
+#include "segmentIndex.h"
+
+// Smallest box around both boxes. Unlike cv::Rect_::operator| it keeps boxes with no width or height, e.g. around an axis aligned line
+static cv::Rect2d boxUnion(const cv::Rect2d& a, const cv::Rect2d& b) {
+	double x0 = std::min(a.x, b.x), y0 = std::min(a.y, b.y);
+	double x1 = std::max(a.x + a.width, b.x + b.width), y1 = std::max(a.y + a.height, b.y + b.height);
+	return cv::Rect2d(x0, y0, x1 - x0, y1 - y0);
+}
+
+// TRUE if the point is in the box or on its border
+static bool inBox(const cv::Point2d& pt, const cv::Rect2d& box) {
+	return pt.x >= box.x && pt.x <= box.x + box.width && pt.y >= box.y && pt.y <= box.y + box.height;
+}
+
+// TRUE if the boxes overlap or touch
+static bool boxesTouch(const cv::Rect2d& a, const cv::Rect2d& b) {
+	return a.x <= b.x + b.width && b.x <= a.x + a.width && a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+SegmentIndex::SegmentIndex(const std::vector<cv::Rect2d>& boxes, int nodeSize)
+	: _nodeSize(nodeSize < 2 ? 2 : nodeSize), _boxes(boxes) {
+	std::vector<int> ids(boxes.size());
+	std::vector<cv::Rect2d> nodeBoxes;
+	std::vector<Node> level, upper;
+	int base;
+
+	if (boxes.empty()) { return; }
+	std::iota(ids.begin(), ids.end(), 0);
+	_pack(ids, _boxes, level, true);
+	_order = ids;
+
+	// pack each level into the one above it until there is a single root
+	while (level.size() > 1) {
+		nodeBoxes.resize(level.size());
+		for (size_t i = 0; i < level.size(); i++) { nodeBoxes[i] = level[i].box; }
+		ids.resize(level.size());
+		std::iota(ids.begin(), ids.end(), 0);
+		upper.clear();
+		_pack(ids, nodeBoxes, upper, false);
+
+		// the children of each node above have to be next to each other
+		base = (int)_nodes.size();
+		for (int id : ids) { _nodes.push_back(level[id]); }
+		for (auto& node : upper) { node.first += base; }
+		level.swap(upper);
+	}
+	_nodes.push_back(level.front());
+}
+
+void SegmentIndex::_pack(std::vector<int>& ids, const std::vector<cv::Rect2d>& boxes, std::vector<Node>& level, bool leaf) {
+	int n = (int)ids.size();
+	int numNodes = (n + _nodeSize - 1) / _nodeSize;
+	int numSlices = (int)std::ceil(std::sqrt((double)numNodes));
+	int sliceSize = numSlices * _nodeSize;
+	Node node;
+
+	auto centerX = [&boxes](int a, int b) { return boxes[a].x + boxes[a].width / 2 < boxes[b].x + boxes[b].width / 2; };
+	auto centerY = [&boxes](int a, int b) { return boxes[a].y + boxes[a].height / 2 < boxes[b].y + boxes[b].height / 2; };
+
+	// vertical slices of about sqrt(numNodes) nodes each, then runs of nodeSize boxes down each slice
+	std::sort(ids.begin(), ids.end(), centerX);
+	for (int s = 0; s < n; s += sliceSize) {
+		int e = std::min(n, s + sliceSize);
+		std::sort(ids.begin() + s, ids.begin() + e, centerY);
+		for (int f = s; f < e; f += _nodeSize) {
+			node.first = f;
+			node.count = std::min(_nodeSize, e - f);
+			node.leaf = leaf;
+			node.box = boxes[ids[f]];
+			for (int k = f + 1; k < f + node.count; k++) { node.box = boxUnion(node.box, boxes[ids[k]]); }
+			level.push_back(node);
+		}
+	}
+}
+
+void SegmentIndex::query(const cv::Point2d& pt, std::vector<int>& hits) const {
+	std::vector<int> stack;
+
+	hits.clear();
+	if (_nodes.empty()) { return; }
+	stack.push_back((int)_nodes.size() - 1);
+	while (!stack.empty()) {
+		const Node& node = _nodes[stack.back()];
+		stack.pop_back();
+		if (!inBox(pt, node.box)) { continue; }
+		for (int i = node.first; i < node.first + node.count; i++) {
+			if (!node.leaf) { stack.push_back(i); }
+			else if (_boxes[_order[i]].contains(pt)) { hits.push_back(_order[i]); }
+		}
+	}
+	std::sort(hits.begin(), hits.end());
+}
+
+void SegmentIndex::query(const cv::Rect2d& region, std::vector<int>& hits) const {
+	std::vector<int> stack;
+
+	hits.clear();
+	if (_nodes.empty()) { return; }
+	stack.push_back((int)_nodes.size() - 1);
+	while (!stack.empty()) {
+		const Node& node = _nodes[stack.back()];
+		stack.pop_back();
+		if (!boxesTouch(region, node.box)) { continue; }
+		for (int i = node.first; i < node.first + node.count; i++) {
+			if (!node.leaf) { stack.push_back(i); }
+			else if (boxesTouch(region, _boxes[_order[i]])) { hits.push_back(_order[i]); }
+		}
+	}
+	std::sort(hits.begin(), hits.end());
+}
+
+double SegmentIndex::boxDistance(const cv::Point2d& pt, const cv::Rect2d& box) {
+	double dx = std::max(std::max(box.x - pt.x, pt.x - (box.x + box.width)), 0.0);
+	double dy = std::max(std::max(box.y - pt.y, pt.y - (box.y + box.height)), 0.0);
+	return std::sqrt(dx * dx + dy * dy);
+}
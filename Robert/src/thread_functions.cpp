@@ -2,6 +2,8 @@
 #include <iostream>
 #include <algorithm>
 #include <string>
+#include <thread>
+#include <chrono>
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
@@ -9,6 +11,7 @@
 
 #include "A3200.h"
 #include "constants.h"
+#include "resolution.h"
 #include "myTypes.h"
 #include "myGlobals.h"
 #include "scanning.h"
@@ -17,70 +20,396 @@
 #include "A3200_functions.h"
 #include "csvMat.h"
 #include "raster.h"
+#include "path.h"
 #include "print.h"
 #include "controller.h"
+#include "scanLog.h"
+#include "scanBuffer.h"
+#include "scanScheduler.h"
+#include "positionService.h"
+#include "coverageMap.h"
+#include "edgeStore.h"
+#include "edgeDetector.h"
+#include "scanWorkers.h"
+#include "heightMap.h"
+#include "tiledImage.h"
+
+enum acquireStatus { ACQUIRE_OK, ACQUIRE_FAILED, ACQUIRE_END };
 
-void t_CollectScans(Raster raster) {
-	cv::Mat scan(1, NUM_DATA_SAMPLES, CV_64F);
-	cv::Point scanStart, scanEnd;
-	cv::Mat scanROI;
+/**
+ * @brief Gets the next block of scanner data from the replay log, or triggers the scanner and collects the data from the A3200
+ * @return ACQUIRE_OK on success, ACQUIRE_FAILED if the data collection failed, ACQUIRE_END if the end of the replay log was reached
+*/
+static acquireStatus acquireData(ScanLogReader& scanReplay, ScanLogWriter& scanLog, ScanScheduler& scheduler, double* data, int numTriggers) {
+	std::chrono::steady_clock::time_point tTrigger;
+	std::vector<cv::Mat> windows;
+	Coords fbk;
+	double acqTime;
+
+	if (scanReplay.isOpen()) {
+		return scanReplay.read(data) ? ACQUIRE_OK : ACQUIRE_END;
+	}
+	// wait until the scanner has moved the set distance along the rod
+	scheduler.wait();
+	tTrigger = std::chrono::steady_clock::now();
+	if (!collectData(handle, DCCHandle, data, numTriggers)) { return ACQUIRE_FAILED; }
+	scanLog.append(data);
+
+	// record where each trigger was fired
+	if (scheduler.enabled()) {
+		acqTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - tTrigger).count() / numTriggers;
+		splitScans(data, numTriggers, windows);
+		for (int i = 0; i < numTriggers; i++) {
+			getScanPos(windows[i], &fbk);
+			scheduler.triggered(cv::Point2d(fbk.x, fbk.y),
+				tTrigger + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(i * NUM_DATA_SAMPLES * SAMPLING_TIME)), acqTime);
+		}
+	}
+	return ACQUIRE_OK;
+}
+
+/**
+ * @brief Fills the acquisition ring with scanner data until the ring is closed or the replay log runs out
+*/
+static void t_AcquireScans(ScanRing& ring, ScanLogReader& scanReplay, ScanLogWriter& scanLog, ScanScheduler& scheduler, int numTriggers) {
+	double* data;
+	acquireStatus status;
+
+	while ((data = ring.beginWrite()) != nullptr) {
+		status = acquireData(scanReplay, scanLog, scheduler, data, numTriggers);
+		if (status == ACQUIRE_OK) { ring.endWrite(); }
+		else if (status == ACQUIRE_END) { break; }
+	}
+	// let the processing thread know no more data is coming
+	ring.close();
+}
+
+void t_CollectScans(Raster raster, std::vector<std::vector<Path>> path, ScanOptions scanOpts) {
 	double heightThresh = -3;
-	double collectedData[NUM_DATA_SIGNALS][NUM_DATA_SAMPLES];
-	Coords scanPosFbk;
+	std::vector<double> collectedData;
+	double* data;
+	std::vector<cv::Mat> windows;
+	ScanWorkspace sw(scanOpts.edgeDetector, scanOpts.prefilter, scanOpts.prefilterRadius); // buffers and edge detector of this thread
+	ScanResult scanResult;
 	edgeMsg msg;
 	double posErrThr = 1.0;// position error threshold for how close the current position is to the target
+	int printLookahead = 8; // number of segments ahead of the last one reached that the printer is searched for on
 	cv::Point2d curPos;
-	int locXoffset = 0;
 	int layer = segments.front().layer();
-	cv::Mat edges = cv::Mat::zeros(raster.size(layer), CV_8UC1);
-	std::vector<cv::Mat> pastEdges;
+	EdgeStore edgeStore(segments, MATL_EDGE_MARGIN); // edge points filed by segment
+	std::shared_ptr<const EdgeBoundary> edgeBoundary; // made once per layer instead of for every scan
+	cv::Rect2d printROI = raster.roi(layer); // ROI and size of the current layer. The jobs keep copies, since the layer can change before a worker gets to them
+	cv::Size rasterSize = raster.size(layer);
+	CoverageMap coverage(raster.size(layer), resolution.toPix(scanOpts.scanPitch * 2 > 3 ? scanOpts.scanPitch * 2 : 3)); // area swept by the scans in the layer
+	std::vector<cv::Mat> pastCoverage;
+	HeightMap heightMap(rasterSize); // heights of the layer from the resampled profiles
+	std::vector<HeightMap> pastHeights;
+	int releasedCoverage = 0, releasedPosition = 0; // number of segments released by their coverage and by their scanDonePt
 	int segNumScan = 0; // segment being scanned
+	int segNumPrint = 0; // first segment that the printer has not reached. Only the sweeps taken after a segment is reached count towards its coverage
+	int printWaypoint;
+	ScanLogWriter scanLog;
+	ScanLogReader scanReplay;
+	bool replay = !scanOpts.replayFile.empty();
+	int numTriggers = (scanOpts.triggersPerCollection < 1) ? 1 : scanOpts.triggersPerCollection;
+	std::thread t_acquire;
+	acquireStatus status;
+	int numScans = 0;
+	std::chrono::steady_clock::time_point tStart;
+	ScanScheduler scheduler(path, replay ? -1 : scanOpts.scanPitch); // the replay keeps the timing of the recording
+	bool pollPosition = false; // true if this thread started the position feedback service
+	Coords livePos;
+	int numWorkers = (scanOpts.buffered && scanOpts.scanWorkers > 1) ? scanOpts.scanWorkers : 1;
+	std::unique_ptr<ScanWorkers> workers;
+	std::vector<std::unique_ptr<ScanWorkspace>> workerSpaces;
+	// scan handed to the workers. Its slot is reused once the result has been committed
+	struct ScanJob {
+		cv::Mat window; // points into a block of the ring that is held until the last scan of the block is committed
+		int layer;
+		cv::Rect2d printROI;
+		cv::Size rasterSize;
+		std::shared_ptr<const EdgeBoundary> edgeBoundary;
+		bool lastInBlock;
+		ScanResult result;
+	};
+	std::vector<ScanJob> jobs;
+	long long numSubmitted = 0, numCommitted = 0;
+	size_t maxBlocksHeld = 1, blocksHeld = 0;
+
+	// sends the edges of the segments that have been scanned for processing. A segment is done once the scans taken since the
+	// printer reached it have swept the set fraction of its ROI, or when the position reaches its scanDonePt
+	auto releaseSegments = [&](const cv::Point2d& pos) {
+		bool covered;
+		while (segNumScan < segments.size()) {
+			covered = scanOpts.coverage > 0 && segments[segNumScan].layer() == layer && segNumScan < segNumPrint &&
+				(segments[segNumScan].ROI().area() <= 1 || coverage.fraction(segments[segNumScan].ROI()) >= scanOpts.coverage);
+			if (covered) { releasedCoverage++; }
+			else if (cv::norm(pos - segments[segNumScan].scanDonePt()) < posErrThr) { releasedPosition++; }
+			else { break; }
+
+			std::cout << "Segment " << segNumScan << " scanned. Sending data for processing." << std::endl;
+			// Check if this was the last segmet to scan
+			msg.addEdges(edgeStore.points(segNumScan), segNumScan, (segNumScan == segments.size() - 1));
+			// push the edges to the error calculating thread
+			q_edgeMsg.push(msg);
+			// move to next segment
+			segNumScan++;
+			segNumPrint = std::max(segNumPrint, segNumScan);
+			scheduler.setSegment(segNumScan);
+			if (!covered) { break; }
+		}
+	};
+
+	// search for the edges of the layer in the boundary of its raster path, narrowed to the edges of the last layer with the same path
+	auto makeBoundary = [&]() {
+		std::shared_ptr<EdgeBoundary> boundary = std::make_shared<EdgeBoundary>(raster, layer);
+		if (scanOpts.priorMargin > 0 && !edgeStore.layerPoints(layer - 2).empty()) {
+			int numBins = boundary->setPrior(edgeStore.layerPoints(layer - 2), resolution.toPix(scanOpts.priorMargin));
+			std::cout << "Layer " << layer << ": edge search narrowed to the edges of layer " << layer - 2 << " in " << numBins << " rod sections." << std::endl;
+		}
+		edgeBoundary = boundary;
+	};
+	makeBoundary();
 
-	// wait for pre-print to complete before starting the scanner
-	q_scanMsg.wait_and_pop();
-
-	segNumScan = 0;
-	while (segNumScan < segments.size()){
-		// if there was a layer change, clear all the edges
+	// if there was a layer change, clear all the edges
+	auto checkLayer = [&]() {
 		if (segments[segNumScan].layer() != layer) {
 			layer = segments[segNumScan].layer();
-			pastEdges.push_back(edges);
-			edges = cv::Mat::zeros(raster.size(layer), CV_8UC1);
+			makeBoundary();
+			printROI = raster.roi(layer);
+			rasterSize = raster.size(layer);
+			pastCoverage.push_back(coverage.map());
+			coverage.reset(rasterSize);
+			pastHeights.push_back(std::move(heightMap));
+			heightMap.reset(rasterSize);
 		}
-		if (collectData(handle, DCCHandle, &collectedData[0][0])) {
-			// Trigger the scanner and collect the scanner data
-			if (getScan(collectedData, &scanPosFbk, scan, locXoffset)){
-				// Find the part of the scan that is within the ROI of the print
-				if (scan2ROI(scan, scanPosFbk, locXoffset, raster.roi(layer), raster.size(layer), scanROI, scanStart, scanEnd)) {
-					// Finding the edges
-					findEdges2(raster.boundaryMask(layer), scanStart, scanEnd, scanROI, edges);
-				}
+	};
+
+	// applies a processed scan to the edges and coverage of the layer and releases the segments that are done. The scans must be
+	// committed in acquisition order since the coverage sweeps and the segment release depend on it. inFlight is TRUE while later
+	// scans are still being collected, queued or processed
+	auto commitScan = [&](const ScanResult& result, bool inFlight) {
+		int seg;
+
+		numScans++;
+		scanStats.collected++;
+		// the scan line is wider than the rod spacing, so it also sweeps the rods ahead of the one being printed. The coverage of
+		// a segment is cleared when the printer reaches it, so the sweeps of the bare substrate before it was printed do not count
+		seg = findPathSegment(path, cv::Point2d(result.fbk.x, result.fbk.y), segNumPrint, printLookahead, posErrThr, printWaypoint);
+		for (; seg >= 0 && segNumPrint <= seg; segNumPrint++) {
+			if (segments[segNumPrint].layer() == layer) { coverage.clear(segments[segNumPrint].ROI()); }
+		}
+		if (!result.nearROI) {
+			scanStats.skipped++;
+			coverage.breakSweep();
+		}
+		else if (result.valid) {
+			edgeStore.add(result.edges, layer);
+			coverage.addScan(result.scanStart, result.scanEnd, result.fbk.T);
+			heightMap.addScan(result.scanStart, result.scanEnd, result.heights);
+		}
+		else {
+			coverage.breakSweep();
+		}
+
+		// compare the current position to the scanDonePt of the segment. The live position runs ahead of the scans in flight, which
+		// would then go to no segment, so it is only used once the last scan has been committed. Until then the position of the scan is used
+		if (!inFlight && positionService.running() && positionService.read(livePos)) { curPos = cv::Point2d(livePos.x, livePos.y); }
+		else { curPos = cv::Point2d(result.fbk.x, result.fbk.y); }
+		releaseSegments(curPos);
+	};
+
+	if (replay) {
+		// replay the scanner data from a log instead of the A3200
+		if (!scanReplay.open(scanOpts.replayFile)) { return; }
+		scanReplay.setSpeed(scanOpts.replaySpeed);
+		if (scanReplay.numSignals() != NUM_DATA_SIGNALS || scanReplay.numSamples() % NUM_DATA_SAMPLES != 0) {
+			std::cout << "Scan log " << scanOpts.replayFile << " does not match the data collection configuration." << std::endl;
+			return;
+		}
+		// the number of triggers is set by the log
+		numTriggers = scanReplay.numSamples() / NUM_DATA_SAMPLES;
+		std::cout << "Replaying " << scanReplay.size() * numTriggers << " scans from " << scanOpts.replayFile << std::endl;
+	}
+	else {
+		if (numTriggers != 1 && !setCollectionTriggers(handle, DCCHandle, numTriggers)) { A3200Error(); return; }
+		if (!scanOpts.recordFile.empty()) { scanLog.open(scanOpts.recordFile, NUM_DATA_SIGNALS, NUM_DATA_SAMPLES * numTriggers); }
+		// wait for pre-print to complete before starting the scanner
+		q_scanMsg.wait_and_pop();
+		// poll the position so the segments are released without waiting on a data collection
+		if (!positionService.running() && scanOpts.positionPeriod > 0) { pollPosition = positionService.start(scanOpts.positionPeriod); }
+	}
+
+	// the workers hold blocks of the ring while their scans are processed, so the ring is grown to keep every worker busy
+	// while the acquisition thread still has a free block to write to
+	int ringSize = scanOpts.buffered ? (scanOpts.bufferSize < 2 ? 2 : scanOpts.bufferSize) : 1;
+	if (numWorkers > 1) { ringSize = std::max(ringSize, (2 * numWorkers + numTriggers - 1) / numTriggers + 1); }
+	ScanRing ring(ringSize, NUM_DATA_SIGNALS * NUM_DATA_SAMPLES * numTriggers);
+	collectedData.resize(scanOpts.buffered ? 0 : NUM_DATA_SIGNALS * NUM_DATA_SAMPLES * numTriggers);
+	if (numWorkers > 1) {
+		maxBlocksHeld = ring.numBlocks() - 1;
+		jobs.resize(maxBlocksHeld * numTriggers);
+		for (int i = 0; i < numWorkers; i++) { workerSpaces.push_back(std::make_unique<ScanWorkspace>(scanOpts.edgeDetector, scanOpts.prefilter, scanOpts.prefilterRadius)); }
+		workers = std::make_unique<ScanWorkers>(numWorkers, [&](long long ticket, int worker) {
+			ScanJob& job = jobs[ticket % jobs.size()];
+			processScan(job.window, job.printROI, job.rasterSize, *job.edgeBoundary, scanOpts.scanDepth, *workerSpaces[worker], job.result);
+			});
+	}
+
+	// collect the next scan on its own thread while the current one is processed
+	scanStats.reset();
+	tStart = std::chrono::steady_clock::now();
+	if (scanOpts.buffered) {
+		t_acquire = std::thread{ t_AcquireScans, std::ref(ring), std::ref(scanReplay), std::ref(scanLog), std::ref(scheduler), numTriggers };
+	}
+
+	segNumScan = 0;
+	while (numWorkers > 1 && segNumScan < segments.size()) {
+		// hand the next block to the workers while there are free job slots. Only wait for the data if there is nothing to commit
+		if (blocksHeld < maxBlocksHeld &&
+			(data = ring.beginRead(std::chrono::milliseconds(numCommitted < numSubmitted ? 0 : 5))) != nullptr) {
+			splitScans(data, numTriggers, windows);
+			for (int i = 0; i < numTriggers; i++) {
+				ScanJob& job = jobs[numSubmitted % jobs.size()];
+				job.window = windows[i];
+				job.layer = layer;
+				job.printROI = printROI;
+				job.rasterSize = rasterSize;
+				job.edgeBoundary = edgeBoundary;
+				job.lastInBlock = (i == numTriggers - 1);
+				numSubmitted = workers->submit() + 1;
 			}
-			// compare the current position to the scanDonePt of the segment
-			curPos = cv::Point2d(scanPosFbk.x, scanPosFbk.y);
-			if (cv::norm(curPos - segments[segNumScan].scanDonePt()) < posErrThr) {
-				std::cout << "Segment " << segNumScan << " scanned. Sending data for processing." << std::endl;
-				// Check if this was the last segmet to scan
-				msg.addEdges(edges, segNumScan, (segNumScan == segments.size() - 1));
-				// push the edges to the error calculating thread
-				q_edgeMsg.push(msg);
-				// move to next segment
-				segNumScan++;
+			blocksHeld++;
+			continue;
+		}
+		if (numCommitted == numSubmitted && ring.done()) { break; }
+
+		// commit the oldest scan once it has been processed. The live position is only checked while nothing is in flight,
+		// otherwise a segment could be released before the edges of the scans ahead of it are committed
+		if (numCommitted == numSubmitted || !workers->wait(numCommitted, std::chrono::milliseconds(5))) {
+			if (numCommitted == numSubmitted && ring.idle() && positionService.running() && positionService.read(livePos)) { releaseSegments(cv::Point2d(livePos.x, livePos.y)); }
+			continue;
+		}
+		ScanJob& job = jobs[numCommitted % jobs.size()];
+		numCommitted++;
+		checkLayer();
+		// the scan was handed out before the layer changed, so find its edges again in the new layer
+		if (job.layer != layer) {
+			processScan(job.window, printROI, rasterSize, *edgeBoundary, scanOpts.scanDepth, sw, job.result);
+		}
+		commitScan(job.result, numCommitted < numSubmitted || !ring.idle());
+		// the block can be reused by the acquisition thread once all of its scans have been committed
+		if (job.lastInBlock) {
+			ring.endRead();
+			blocksHeld--;
+		}
+	}
+	// the scans still in flight point into the ring
+	workers.reset();
+
+	while (numWorkers == 1 && segNumScan < segments.size()){
+		// Get the next block of scanner data
+		if (scanOpts.buffered && positionService.running()) {
+			// check the live position while waiting for the data, unless a data collection is under way
+			if ((data = ring.beginRead(std::chrono::milliseconds(5))) == nullptr) {
+				if (ring.done()) { break; }
+				if (ring.idle() && positionService.read(livePos)) { releaseSegments(cv::Point2d(livePos.x, livePos.y)); }
+				continue;
 			}
 		}
+		else if (scanOpts.buffered) {
+			if ((data = ring.beginRead()) == nullptr) { break; }
+		}
+		else {
+			data = collectedData.data();
+			status = acquireData(scanReplay, scanLog, scheduler, data, numTriggers);
+			if (status == ACQUIRE_END) { break; }
+			else if (status == ACQUIRE_FAILED) { continue; }
+		}
+
+		// process each of the profiles in the block
+		splitScans(data, numTriggers, windows);
+		for (int i = 0; i < numTriggers && segNumScan < segments.size(); i++) {
+			checkLayer();
+			processScan(windows[i], printROI, rasterSize, *edgeBoundary, scanOpts.scanDepth, sw, scanResult);
+			commitScan(scanResult, i < numTriggers - 1 || (scanOpts.buffered && !ring.idle()));
+		}
+		// the block can be reused by the acquisition thread
+		if (scanOpts.buffered) { ring.endRead(); }
+	}
+	// stop the acquisition thread
+	if (t_acquire.joinable()) {
+		ring.close();
+		t_acquire.join();
+	}
+	if (pollPosition) {
+		positionService.stop();
+		std::cout << "Position feedback polled " << positionService.count() << " times ("
+			<< positionService.count() / std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count() << " Hz)" << std::endl;
+	}
+	std::cout << "Scanning rate: " << numScans / std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count()
+		<< " scans/s (" << (scanOpts.buffered ? "double-buffered" : "serial") << " acquisition, " << numTriggers << " triggers per collection, "
+		<< numWorkers << " processing thread" << (numWorkers > 1 ? "s" : "") << ")" << std::endl;
+	std::cout << scanStats.skipped << " of " << scanStats.collected << " scans were outside the print and skipped." << std::endl;
+	if (scanOpts.prefilter == profileFilter::HAMPEL) {
+		long long numFiltered = sw.detector->numFiltered();
+		for (auto& space : workerSpaces) { numFiltered += space->detector->numFiltered(); }
+		std::cout << numFiltered << " profile samples replaced by the Hampel prefilter." << std::endl;
+	}
+	scheduler.printStats();
+	std::cout << releasedCoverage << " segments released by their coverage, " << releasedPosition << " by their scanDonePt." << std::endl;
+
+	// If the replay log ran out, send the remaining segments so the processing thread can finish
+	if (segNumScan < segments.size()) {
+		std::cout << "End of scan log reached. Sending the remaining segments for processing." << std::endl;
+	}
+	while (segNumScan < segments.size()) {
+		if (segments[segNumScan].layer() != layer) {
+			layer = segments[segNumScan].layer();
+			pastCoverage.push_back(coverage.map());
+			coverage.reset(raster.size(layer));
+			pastHeights.push_back(std::move(heightMap));
+			heightMap.reset(raster.size(layer));
+		}
+		msg.addEdges(edgeStore.points(segNumScan), segNumScan, (segNumScan == segments.size() - 1));
+		q_edgeMsg.push(msg);
+		segNumScan++;
 	}
+	scanLog.close();
+	if (!replay && numTriggers != 1) { setCollectionTriggers(handle, DCCHandle, 1); }
 	// Save the data
-	pastEdges.push_back(edges);
+	pastCoverage.push_back(coverage.map());
+	pastHeights.push_back(std::move(heightMap));
 	cv::Mat image;
-	for (int i = 0; i < pastEdges.size(); i++) 
+	TiledImage edges;
+	std::vector<cv::Point> edgePts;
+	for (int i = 0; i < pastCoverage.size(); i++) 
 	{
+		edges.reset(raster.size(i + segments.front().layer()));
+		edgeStore.draw(edges, i + segments.front().layer());
+		edges.findNonZero(edgePts);
 		image = cv::Mat::zeros(raster.size(i + segments.front().layer()), CV_8UC3);
 		raster.draw(image, image, i + segments.front().layer());
-		raster.drawBdry(image, image, i + segments.front().layer(), cv::Scalar(255, 0, 0), MM2PIX(0.05));
-		drawEdges(image, image, pastEdges[i], cv::Scalar(0, 0, 255), MM2PIX(0.1));
+		raster.drawBdry(image, image, i + segments.front().layer(), cv::Scalar(255, 0, 0), resolution.toPix(0.05));
+		drawEdges(image, image, edgePts, cv::Scalar(0, 0, 255), resolution.toPix(0.1));
 		cv::flip(image, image, 0); // flip the image to have standard coordinate system with origin in lower left corner
 		cv::imwrite(outDir + "edges_" + std::to_string(i + segments.front().layer()) + ".png", image);
-		cv::imwrite(outDir + "edgedata_" + std::to_string(i + segments.front().layer()) + ".png", pastEdges[i]);
+		edges.writePNG(outDir + "edgedata_" + std::to_string(i + segments.front().layer()) + ".png");
+	}
+	image.release(); // the drawing buffer is only needed while a layer is written
+	for (int i = 0; i < pastCoverage.size(); i++)
+	{
+		cv::flip(pastCoverage[i], image, 0); // flip the image to have standard coordinate system with origin in lower left corner
+		cv::imwrite(outDir + "coverage_" + std::to_string(i + segments.front().layer()) + ".png", image);
+	}
+	for (int i = 0; i < pastHeights.size(); i++)
+	{
+		// heights in [mm] as a 32 bit float image, NaN where the layer was not scanned
+		pastHeights[i].copyTo(cv::Rect(cv::Point(0, 0), pastHeights[i].size()), image);
+		cv::flip(image, image, 0); // flip the image to have standard coordinate system with origin in lower left corner
+		cv::imwrite(outDir + "heights_" + std::to_string(i + segments.front().layer()) + ".tiff", image);
+		std::cout << "Layer " << i + segments.front().layer() << " height map: " << pastHeights[i].numTiles() << " tiles, "
+			<< pastHeights[i].bytes() / 1024 << " kB (" << (size_t)pastHeights[i].size().area() * sizeof(float) / 1024 << " kB dense)" << std::endl;
 	}
 	std::cout << "All segments have been scanned. Ending scanning thread." << std::endl;
 }
@@ -89,12 +418,12 @@ void t_GetMatlErrors(Raster raster, std::vector<std::vector<Path>> path) {
 	edgeMsg inMsg;
 	errsMsg outMsg;
 	std::vector<cv::Point> waypoints;
-	std::vector<cv::Point> lEdgePts, rEdgePts;
+	std::vector<cv::Point2f> lEdgePts, rEdgePts;
 	std::vector<double> errCL, errWD, targetWidths;
 	bool doneScanning = false;
 	int layer = segments.front().layer();
-	cv::Mat unfiltEdges = cv::Mat::zeros(raster.size(layer), CV_8UC1);
-	std::vector<cv::Mat> pastEdges;
+	TiledImage unfiltEdges(raster.size(layer)); // only the tiles the edges fall in are allocated
+	std::vector<TiledImage> pastEdges;
 	int segNumError = 0; // segment that errors are being calculated for
 
 	while (!doneScanning){
@@ -109,7 +438,7 @@ void t_GetMatlErrors(Raster raster, std::vector<std::vector<Path>> path) {
 		if (!lEdgePts.empty() && !rEdgePts.empty()) {
 			std::for_each(path[segNumError].begin(), path[segNumError].end(), [&targetWidths](Path& pth) {targetWidths.push_back(pth.w); });
 			waypoints = segments[segNumError].waypoints();
-			getErrorsAt(waypoints, targetWidths, segments[segNumError].dir(), raster.size(segments[segNumError].layer()), lEdgePts, rEdgePts, errCL, errWD);
+			getErrorsAt(waypoints, targetWidths, segments[segNumError].dir(), lEdgePts, rEdgePts, errCL, errWD);
 		}
 
 		// Store the errors in the segment class
@@ -141,52 +470,65 @@ void t_GetMatlErrors(Raster raster, std::vector<std::vector<Path>> path) {
 		// if there was a layer change, clear all the edges
 		if (segments[segNumError].layer() != layer) {
 			layer = segments[segNumError].layer();
-			pastEdges.push_back(unfiltEdges);
-			unfiltEdges = cv::Mat::zeros(raster.size(layer), CV_8UC1);
+			pastEdges.push_back(std::move(unfiltEdges));
+			unfiltEdges.reset(raster.size(layer));
 		}
 		// copy the unfiltered points
-		inMsg.edges()(segments[segNumError].ROI()).copyTo(unfiltEdges(segments[segNumError].ROI()));
+		for (auto it = inMsg.edges().begin(); it != inMsg.edges().end(); ++it) {
+			if (segments[segNumError].ROI().contains(cv::Point(*it))) { unfiltEdges.set(cv::Point(*it), cv::Scalar(255)); }
+		}
 	}
-	pastEdges.push_back(unfiltEdges);
+	pastEdges.push_back(std::move(unfiltEdges));
 	// Save the data
+	size_t tiledBytes = 0, denseBytes = 0;
+	for (auto& edges : pastEdges) {
+		tiledBytes += edges.bytes();
+		denseBytes += (size_t)edges.size().area();
+	}
+	std::cout << "Unfiltered edges of " << pastEdges.size() << " layers: " << tiledBytes / 1024 << " kB in tiles (" << denseBytes / 1024 << " kB dense)" << std::endl;
 
 	// drawing the unfiltered edges
-	cv::Mat image = cv::Mat::zeros(raster.size(layer), CV_8UC3);
+	cv::Mat image;
+	std::vector<cv::Point> edgePts;
 	layer = segments.front().layer();
 	for (int i = 0; i < pastEdges.size(); i++)
 	{
+		pastEdges[i].findNonZero(edgePts);
 		image = cv::Mat::zeros(raster.size(i + segments.front().layer()), CV_8UC3);
 		raster.draw(image, image, i + segments.front().layer());
-		raster.drawBdry(image, image, i + segments.front().layer(), cv::Scalar(255, 0, 0), MM2PIX(0.05));
-		drawEdges(image, image, pastEdges[i], cv::Scalar(0, 0, 255), MM2PIX(0.1));
+		raster.drawBdry(image, image, i + segments.front().layer(), cv::Scalar(255, 0, 0), resolution.toPix(0.05));
+		drawEdges(image, image, edgePts, cv::Scalar(0, 0, 255), resolution.toPix(0.1));
 		cv::flip(image, image, 0); // flip the image to have standard coordinate system with origin in lower left corner
 		cv::imwrite(outDir + "edges_unfilt_" + std::to_string(i + segments.front().layer()) + ".png", image);
-		cv::imwrite(outDir + "edgedata_unfilt_" + std::to_string(i + segments.front().layer()) + ".png", pastEdges[i]);
+		pastEdges[i].writePNG(outDir + "edgedata_unfilt_" + std::to_string(i + segments.front().layer()) + ".png");
 	}
+	pastEdges.clear();
 
 	// drawing the filtered edges
 	layer = segments.front().layer();
-	cv::Mat filteredEdges = cv::Mat::zeros(raster.size(layer), CV_8UC1);
-	image = cv::Mat::zeros(raster.size(layer), CV_8UC3);
+	TiledImage filteredEdges(raster.size(layer));
 	for (auto it = segments.begin(); it != segments.end(); ++it) {
 		if ((*it).layer() != layer) {
-			cv::imwrite(outDir + "edgedata_filt_" + std::to_string(layer) + ".png", filteredEdges);
+			filteredEdges.writePNG(outDir + "edgedata_filt_" + std::to_string(layer) + ".png");
+			filteredEdges.findNonZero(edgePts);
+			image = cv::Mat::zeros(raster.size(layer), CV_8UC3);
 			raster.draw(image, image, layer);
-			raster.drawBdry(image, image, layer, cv::Scalar(255, 0, 0), MM2PIX(0.05));
-			drawEdges(image, image, filteredEdges, cv::Scalar(0, 0, 255), MM2PIX(0.1));
+			raster.drawBdry(image, image, layer, cv::Scalar(255, 0, 0), resolution.toPix(0.05));
+			drawEdges(image, image, edgePts, cv::Scalar(0, 0, 255), resolution.toPix(0.1));
 			cv::flip(image, image, 0); // flip the image to have standard coordinate system with origin in lower left corner
 			cv::imwrite(outDir + "edges_filt_" + std::to_string(layer) + ".png", image);
 			layer = (*it).layer();
-			filteredEdges = cv::Mat::zeros(raster.size(layer), CV_8UC1);
-			image = cv::Mat::zeros(raster.size(layer), CV_8UC3);
+			filteredEdges.reset(raster.size(layer));
 		}
-		for (auto it2 = (*it).lEdgePts().begin(); it2 != (*it).lEdgePts().end(); ++it2) { filteredEdges.at<uchar>((*it2)) = 255; }
-		for (auto it2 = (*it).rEdgePts().begin(); it2 != (*it).rEdgePts().end(); ++it2) { filteredEdges.at<uchar>((*it2)) = 255; }
+		for (auto it2 = (*it).lEdgePts().begin(); it2 != (*it).lEdgePts().end(); ++it2) { filteredEdges.set((*it2), cv::Scalar(255)); }
+		for (auto it2 = (*it).rEdgePts().begin(); it2 != (*it).rEdgePts().end(); ++it2) { filteredEdges.set((*it2), cv::Scalar(255)); }
 	}
-	cv::imwrite(outDir + "edgedata_filt_" + std::to_string(layer) + ".png", filteredEdges);
+	filteredEdges.writePNG(outDir + "edgedata_filt_" + std::to_string(layer) + ".png");
+	filteredEdges.findNonZero(edgePts);
+	image = cv::Mat::zeros(raster.size(layer), CV_8UC3);
 	raster.draw(image, image, layer);
-	raster.drawBdry(image, image, layer, cv::Scalar(255, 0, 0), MM2PIX(0.05));
-	drawEdges(image, image, filteredEdges, cv::Scalar(0, 0, 255), MM2PIX(0.1));
+	raster.drawBdry(image, image, layer, cv::Scalar(255, 0, 0), resolution.toPix(0.05));
+	drawEdges(image, image, edgePts, cv::Scalar(0, 0, 255), resolution.toPix(0.1));
 	cv::flip(image, image, 0); // flip the image to have standard coordinate system with origin in lower left corner
 	cv::imwrite(outDir + "edges_filt_" + std::to_string(layer) + ".png", image);
 
@@ -396,28 +738,3 @@ void t_printQueue(Path firstWpt, PrintOptions printOpts) {
 
 	std::cout << "Printing Complete. Ending printing thread." << std::endl;
 }
-
-
-/**
- * @brief 
- * @param rate rate at which to poll the position in [ms]
-*/
-void t_PollPositionFeedback(int rate) {
-	// setup polling of X and Y position feedback
-	WORD itemIndexArray[] = { AXISINDEX_00, AXISINDEX_01 };
-	STATUSITEM itemCodeArray[] = { STATUSITEM_PositionFeedback, STATUSITEM_PositionFeedback };
-	DWORD itemExtrasArray[] = { 0, 0 };
-	double itemValuesArray[2];
-	cv::Point2d curPos;
-
-	while (true) {
-		// get the position feedback simultaneously
-		if (!A3200StatusGetItems(handle, 2, itemIndexArray, itemCodeArray, itemExtrasArray, itemValuesArray)) {
-			curPos = cv::Point2d(itemValuesArray[0], itemValuesArray[1]);
-
-		} 
-		else { A3200Error(); }
-		std::this_thread::sleep_for(std::chrono::milliseconds(rate));
-	}
-
-}
\ No newline at end of file
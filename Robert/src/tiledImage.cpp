@@ -0,0 +1,194 @@
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "tiledImage.h"
+
+TiledImage::TiledImage(cv::Size size, int type, const cv::Scalar& background, int tileSize)
+	: _type(type), _bgValue(background), _background(1, 1, type, background), _tileSize(tileSize < 1 ? 1 : tileSize), _tilesX(0), _tilesY(0), _numTiles(0) {
+	reset(size);
+}
+
+void TiledImage::reset(cv::Size size) {
+	if (_background.empty()) { _background = cv::Mat(1, 1, _type, _bgValue); }
+	_size = size;
+	_tilesX = (size.width + _tileSize - 1) / _tileSize;
+	_tilesY = (size.height + _tileSize - 1) / _tileSize;
+	_tiles.assign((size_t)_tilesX * _tilesY, cv::Mat());
+	_numTiles = 0;
+}
+
+cv::Mat& TiledImage::_tile(int tx, int ty, bool allocate) {
+	cv::Mat& tile = _tiles[(size_t)ty * _tilesX + tx];
+	if (tile.empty() && allocate) {
+		tile = cv::Mat(_tileSize, _tileSize, _type, _bgValue);
+		_numTiles++;
+	}
+	return tile;
+}
+
+uchar* TiledImage::ptr(const cv::Point& pt, bool allocate) {
+	if (pt.x < 0 || pt.y < 0 || pt.x >= _size.width || pt.y >= _size.height) { return nullptr; }
+	cv::Mat& tile = _tile(pt.x / _tileSize, pt.y / _tileSize, allocate);
+	if (tile.empty()) { return nullptr; }
+	return tile.ptr(pt.y % _tileSize, pt.x % _tileSize);
+}
+
+const uchar* TiledImage::ptr(const cv::Point& pt) const {
+	if (pt.x < 0 || pt.y < 0 || pt.x >= _size.width || pt.y >= _size.height) { return nullptr; }
+	const cv::Mat& tile = _tiles[(size_t)(pt.y / _tileSize) * _tilesX + pt.x / _tileSize];
+	if (tile.empty()) { return nullptr; }
+	return tile.ptr(pt.y % _tileSize, pt.x % _tileSize);
+}
+
+template <typename T>
+static void setPixel(uchar* p, const cv::Scalar& value, int cn) {
+	T* px = reinterpret_cast<T*>(p);
+	for (int c = 0; c < cn; c++) { px[c] = cv::saturate_cast<T>(value[c]); }
+}
+
+void TiledImage::set(const cv::Point& pt, const cv::Scalar& value) {
+	uchar* p = ptr(pt, true);
+	int cn = CV_MAT_CN(_type);
+
+	if (!p) { return; }
+	switch (CV_MAT_DEPTH(_type)) {
+	case CV_8U: setPixel<uchar>(p, value, cn); break;
+	case CV_8S: setPixel<schar>(p, value, cn); break;
+	case CV_16U: setPixel<ushort>(p, value, cn); break;
+	case CV_16S: setPixel<short>(p, value, cn); break;
+	case CV_32S: setPixel<int>(p, value, cn); break;
+	case CV_32F: setPixel<float>(p, value, cn); break;
+	case CV_64F: setPixel<double>(p, value, cn); break;
+	default: break;
+	}
+}
+
+void TiledImage::copyTo(const cv::Rect& roi, cv::Mat& dst) const {
+	dst.create(roi.size(), _type);
+	dst.setTo(_bgValue);
+
+	// copy the overlap of each allocated tile with the region
+	cv::Rect r = roi & cv::Rect(cv::Point(0, 0), _size);
+	if (r.area() == 0) { return; }
+	for (int ty = r.y / _tileSize; ty <= (r.br().y - 1) / _tileSize; ty++) {
+		for (int tx = r.x / _tileSize; tx <= (r.br().x - 1) / _tileSize; tx++) {
+			const cv::Mat& tile = _tiles[(size_t)ty * _tilesX + tx];
+			if (tile.empty()) { continue; }
+			cv::Rect tileRect = _tileRect(tx, ty);
+			cv::Rect overlap = r & tileRect;
+			tile(overlap - tileRect.tl()).copyTo(dst(overlap - roi.tl()));
+		}
+	}
+}
+
+// Appends the non-zero pixels of a row of a tile, from x0 to x1 in image coordinates
+template <typename T>
+static void nonZeroRow(const uchar* row, int x0, int x1, int y, std::vector<cv::Point>& pts) {
+	const T* p = reinterpret_cast<const T*>(row);
+	for (int x = x0; x < x1; x++) {
+		if (p[x - x0] != 0) { pts.push_back(cv::Point(x, y)); }
+	}
+}
+
+void TiledImage::findNonZero(std::vector<cv::Point>& pts) const {
+	CV_Assert(CV_MAT_CN(_type) == 1);
+	bool backgroundSet = (_bgValue[0] != 0);
+	int x0, x1;
+
+	pts.clear();
+	for (int ty = 0; ty < _tilesY; ty++) {
+		for (int y = ty * _tileSize; y < std::min((ty + 1) * _tileSize, _size.height); y++) {
+			for (int tx = 0; tx < _tilesX; tx++) {
+				const cv::Mat& tile = _tiles[(size_t)ty * _tilesX + tx];
+				x0 = tx * _tileSize;
+				x1 = std::min(x0 + _tileSize, _size.width);
+				if (tile.empty()) {
+					if (backgroundSet) { for (int x = x0; x < x1; x++) { pts.push_back(cv::Point(x, y)); } }
+					continue;
+				}
+				const uchar* row = tile.ptr(y - ty * _tileSize);
+				switch (CV_MAT_DEPTH(_type)) {
+				case CV_8U: nonZeroRow<uchar>(row, x0, x1, y, pts); break;
+				case CV_8S: nonZeroRow<schar>(row, x0, x1, y, pts); break;
+				case CV_16U: nonZeroRow<ushort>(row, x0, x1, y, pts); break;
+				case CV_16S: nonZeroRow<short>(row, x0, x1, y, pts); break;
+				case CV_32S: nonZeroRow<int>(row, x0, x1, y, pts); break;
+				case CV_32F: nonZeroRow<float>(row, x0, x1, y, pts); break;
+				case CV_64F: nonZeroRow<double>(row, x0, x1, y, pts); break;
+				default: break;
+				}
+			}
+		}
+	}
+}
+
+void TiledImage::polylines(const std::vector<cv::Point>& pts, bool isClosed, const cv::Scalar& color, int thickness, int lineType) {
+	std::vector<std::vector<int>> tileLines((size_t)_tilesX * _tilesY);
+	std::vector<cv::Point> run;
+	int n = (int)pts.size();
+	int numLines = (n == 1) ? 1 : (isClosed ? n : n - 1);
+	int pad = std::max(thickness, 1) + 1; // more than the half thickness and anti-aliasing pixel that a line reaches around its ends
+	int first = 0, i;
+	cv::Rect imageRect(cv::Point(0, 0), _size), box;
+	cv::Point a, b;
+
+	if (n == 0) { return; }
+	// tiles that each line passes within pad of. The lines are listed in drawing order, starting after the closing line of a
+	// closed curve so that the runs of consecutive lines in a tile do not wrap around
+	if (isClosed && n > 1) { first = n - 1; }
+	for (int k = 0; k < numLines; k++) {
+		i = (first + k) % numLines;
+		const cv::Point& p0 = pts[i];
+		const cv::Point& p1 = pts[(i + 1) % n];
+		box = cv::Rect(cv::Point(std::min(p0.x, p1.x) - pad, std::min(p0.y, p1.y) - pad), cv::Point(std::max(p0.x, p1.x) + pad + 1, std::max(p0.y, p1.y) + pad + 1));
+		box &= imageRect;
+		if (box.area() == 0) { continue; }
+		for (int ty = box.y / _tileSize; ty <= (box.br().y - 1) / _tileSize; ty++) {
+			for (int tx = box.x / _tileSize; tx <= (box.br().x - 1) / _tileSize; tx++) {
+				a = p0;
+				b = p1;
+				cv::Rect padded = _tileRect(tx, ty);
+				padded = cv::Rect(padded.x - pad, padded.y - pad, padded.width + 2 * pad, padded.height + 2 * pad);
+				if (cv::clipLine(padded, a, b)) { tileLines[(size_t)ty * _tilesX + tx].push_back(i); }
+			}
+		}
+	}
+
+	// draw each run of consecutive lines that reach a tile as one open curve, so the joints are drawn as by cv::polylines.
+	// A run starts and ends at a point more than pad from the tile, where its end caps cannot reach the tile
+	for (int ty = 0; ty < _tilesY; ty++) {
+		for (int tx = 0; tx < _tilesX; tx++) {
+			const std::vector<int>& lines = tileLines[(size_t)ty * _tilesX + tx];
+			if (lines.empty()) { continue; }
+			cv::Mat& tile = _tile(tx, ty, true);
+			cv::Point tl = _tileRect(tx, ty).tl();
+			if (isClosed && (int)lines.size() == numLines) {
+				run.resize(n);
+				for (i = 0; i < n; i++) { run[i] = pts[i] - tl; }
+				cv::polylines(tile, run, true, color, thickness, lineType);
+				continue;
+			}
+			for (size_t k = 0; k < lines.size(); k++) {
+				if (k == 0 || lines[k] != (lines[k - 1] + 1) % numLines) {
+					if (!run.empty()) { cv::polylines(tile, run, false, color, thickness, lineType); }
+					run.assign(1, pts[lines[k]] - tl);
+				}
+				if (n > 1) { run.push_back(pts[(lines[k] + 1) % n] - tl); }
+			}
+			cv::polylines(tile, run, false, color, thickness, lineType);
+			run.clear();
+		}
+	}
+}
+
+bool TiledImage::writePNG(const std::string& filename, bool flip) const {
+	cv::Mat image;
+
+	copyTo(image);
+	if (flip) { cv::flip(image, image, 0); }
+	return cv::imwrite(filename, image);
+}
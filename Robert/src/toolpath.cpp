@@ -0,0 +1,113 @@
+#include <vector>
+#include <deque>
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "toolpath.h"
+#include "constants.h"
+#include "resolution.h"
+
+#define TRAVEL_GAP 1.5 // distance between consecutive waypoints, as a multiple of the waypoint spacing, above which the move between them is a travel move
+#define MAX_TURN 45.0 // change of direction in [deg] at a waypoint above which a new polyline is started
+
+Toolpath::Toolpath(const std::vector<std::vector<cv::Point2d>>& polylines, double width)
+	: _polylines(polylines), _width(width) {
+	std::vector<cv::Rect2d> boxes;
+	cv::Point2d lo, hi;
+	double pad = width / 2;
+
+	for (int p = 0; p < (int)_polylines.size(); p++) {
+		for (size_t i = 1; i < _polylines[p].size(); i++) {
+			const cv::Point2d& p0 = _polylines[p][i - 1];
+			const cv::Point2d& p1 = _polylines[p][i];
+			_lines.push_back(Line{ p0, p1, p });
+			lo = cv::Point2d(std::min(p0.x, p1.x) - pad, std::min(p0.y, p1.y) - pad);
+			hi = cv::Point2d(std::max(p0.x, p1.x) + pad, std::max(p0.y, p1.y) + pad);
+			boxes.push_back(cv::Rect2d(lo, hi));
+		}
+	}
+	_index = SegmentIndex(boxes);
+}
+
+Toolpath Toolpath::fromRaster(const Raster& raster, int layer) {
+	const std::vector<cv::Point>& px = raster.px(layer);
+	std::vector<std::vector<cv::Point2d>> polylines(1, std::vector<cv::Point2d>(px.begin(), px.end()));
+
+	return Toolpath(polylines, (double)resolution.toPix(raster.rodWidth()));
+}
+
+Toolpath Toolpath::fromPath(const std::deque<std::vector<double>>& path, cv::Point2d origin, double width, double wayptSpc) {
+	std::vector<std::vector<cv::Point2d>> polylines;
+	std::vector<cv::Point2d> polyline;
+	cv::Point2d pt, prevDir, dir;
+	double minCos = std::cos(MAX_TURN * CV_PI / 180), len;
+
+	for (auto& row : path) {
+		if (row.size() < 2) { continue; }
+		pt = cv::Point2d(row[0], row[1]);
+		if (!polyline.empty()) {
+			len = cv::norm(pt - polyline.back());
+			if (len == 0) { continue; }
+			dir = (pt - polyline.back()) / len;
+			// the printer travels without extruding between waypoints further apart than the waypoint spacing
+			if (len > TRAVEL_GAP * wayptSpc) {
+				if (polyline.size() > 1) { polylines.push_back(polyline); }
+				polyline.clear();
+			}
+			// a rod ends at a corner of the path, and the next one starts at the corner
+			else if (polyline.size() > 1 && dir.dot(prevDir) < minCos) {
+				polylines.push_back(polyline);
+				polyline.erase(polyline.begin(), polyline.end() - 1);
+			}
+			prevDir = dir;
+		}
+		polyline.push_back(pt);
+	}
+	if (polyline.size() > 1) { polylines.push_back(polyline); }
+
+	// from [mm] to the pixels of the layer's image
+	for (auto& line : polylines) {
+		for (auto& p : line) { p = (p - origin) / resolution.mmPerPix(); }
+	}
+	return Toolpath(polylines, width / resolution.mmPerPix());
+}
+
+double Toolpath::lineDistance(const cv::Point2d& pt, const Line& line, double& offset) {
+	cv::Point2d d = line.p1 - line.p0, v = pt - line.p0;
+	double len2 = d.dot(d), t;
+
+	if (len2 == 0) {
+		offset = 0;
+		return cv::norm(v);
+	}
+	offset = d.cross(v) / std::sqrt(len2);
+	t = d.dot(v) / len2;
+	t = (t < 0) ? 0 : (t > 1) ? 1 : t;
+	return cv::norm(v - t * d);
+}
+
+int Toolpath::nearest(const cv::Point2d& pt, double maxDist, double& offset) const {
+	double dist, unused;
+	int seg = _index.nearest(pt, maxDist, [&](int id) { return lineDistance(pt, _lines[id], unused); }, dist);
+
+	offset = 0;
+	if (seg >= 0) { lineDistance(pt, _lines[seg], offset); }
+	return seg;
+}
+
+void Toolpath::assign(const std::vector<cv::Point2f>& pts, double margin, std::vector<int>& segs) const {
+	double offset;
+
+	segs.resize(pts.size());
+	for (size_t i = 0; i < pts.size(); i++) { segs[i] = nearest(pts[i], _width / 2 + margin, offset); }
+}
+
+void Toolpath::draw(TiledImage& image, const cv::Scalar& color, int thickness) const {
+	std::vector<cv::Point> pts;
+
+	for (auto& polyline : _polylines) {
+		pts.assign(polyline.begin(), polyline.end());
+		image.polylines(pts, false, color, thickness, cv::LINE_8);
+	}
+}
@@ -0,0 +1,95 @@
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <opencv2/core.hpp>
+#include "opencv2/core/utils/logger.hpp"
+
+#include "scanBench.h"
+#include "profile1D.h"
+#include "myTypes.h"
+
+// Heap allocations made while the benchmarks run. OpenCV allocates its matrices in its own module, so they are counted by
+// the default cv::Mat allocator below and everything allocated by this executable is counted by operator new
+static std::atomic<long long> numAllocations(0);
+
+void* operator new(std::size_t size) {
+	numAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1)) { return p; }
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+class CountingMatAllocator : public cv::MatAllocator
+{
+public:
+	CountingMatAllocator() : _std(cv::Mat::getStdAllocator()) {}
+
+	cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override
+	{
+		if (!data) { numAllocations.fetch_add(1, std::memory_order_relaxed); }
+		return _std->allocate(dims, sizes, type, data, step, flags, usageFlags);
+	}
+	bool allocate(cv::UMatData* u, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override
+	{
+		return _std->allocate(u, flags, usageFlags);
+	}
+	void deallocate(cv::UMatData* u) const override
+	{
+		_std->deallocate(u);
+	}
+
+private:
+	cv::MatAllocator* _std;
+};
+
+int main(int argc, char* argv[]) {
+	// Disable openCV warning in console
+	cv::utils::logging::setLogLevel(cv::utils::logging::LogLevel::LOG_LEVEL_SILENT);
+	static CountingMatAllocator matAllocator;
+	cv::Mat::setDefaultAllocator(&matAllocator);
+	setAllocationCounter(&numAllocations);
+
+	// Scan log recorded by t_CollectScans
+	std::string logFile;
+	if (argc > 1) { logFile = argv[1]; }
+	else {
+		std::cout << "Scan log: ";
+		std::getline(std::cin, logFile);
+	}
+
+	int numFailed = 0; // number of checks that failed
+
+	std::cout << "AVX2 profile kernels " << (profileSIMD() ? "enabled" : "not supported") << std::endl;
+	if (verifyProfileKernels(logFile)) { std::cout << "Profile kernels match OpenCV." << std::endl; }
+	else {
+		std::cout << "Profile kernels DO NOT match OpenCV." << std::endl;
+		numFailed++;
+	}
+	benchGetScan(logFile);
+	if (!benchScan2ROI()) { std::cout << "scan2ROI DOES NOT match the per-sample implementation." << std::endl; numFailed++; }
+	compareScanDepth(logFile);
+	if (!benchMultiOtsu(logFile)) { std::cout << "multiOtsu1D DOES NOT give the same peak masks as the cv::threshold loop." << std::endl; numFailed++; }
+	if (!benchEdgeWrites()) { std::cout << "The cached boundary mask DOES NOT give the same edges." << std::endl; numFailed++; }
+	compareRodWindows();
+	comparePriorWindows();
+	reportSubPixelAccuracy();
+	compareEdgeDetectors(logFile, edgeMethod::OTSU);
+	benchHeightMap(logFile);
+	comparePrefilters(logFile);
+	if (!benchTiledImage()) { std::cout << "Tiled images DO NOT match the dense images." << std::endl; numFailed++; }
+	if (!compareSegmentIndex()) { std::cout << "The segment index DOES NOT match testing every segment." << std::endl; numFailed++; }
+	if (!verifyToolpathFromPath()) { std::cout << "The toolpath of a path file DOES NOT have only its printed rods." << std::endl; numFailed++; }
+	if (!benchResolution()) { std::cout << "The resolution DOES NOT round the same as std::lround." << std::endl; numFailed++; }
+	if (!benchErrorsAt()) { std::cout << "getErrorsAt DOES NOT give the same errors with the indexed edges or the cropped distance transforms." << std::endl; numFailed++; }
+	if (!benchScanScheduler()) { std::cout << "The scan scheduler DOES NOT find the feed rate of the printed segment." << std::endl; numFailed++; }
+	if (!benchScanWorkers(logFile)) { std::cout << "Parallel scan processing DOES NOT match the serial edges." << std::endl; numFailed++; }
+
+	if (numFailed > 0) { std::cout << numFailed << " checks failed." << std::endl; }
+	system("pause");
+	return (numFailed > 0) ? 1 : 0;
+}
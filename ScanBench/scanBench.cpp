@@ -0,0 +1,1742 @@
+#include "scanBench.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <climits>
+#include <thread>
+#include <memory>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "scanning.h"
+#include "scanLog.h"
+#include "profile1D.h"
+#include "constants.h"
+#include "resolution.h"
+#include "raster.h"
+#include "edgeDetector.h"
+#include "scanWorkers.h"
+#include "heightMap.h"
+#include "tiledImage.h"
+#include "toolpath.h"
+#include "errors.h"
+#include "path.h"
+#include "scanScheduler.h"
+
+///////////////////////////////////////  Kernel verification  ///////////////////////////////////////
+
+struct KernelMismatches {
+	int profiles = 0;
+	int trigger = 0;
+	int blackhat = 0;
+	int normalize = 0;
+	int otsu = 0;
+	int threshold = 0;
+	int dilate = 0;
+	int edges = 0;
+	int getScan = 0;
+
+	int total() const { return trigger + blackhat + normalize + otsu + threshold + dilate + edges + getScan; }
+};
+
+static bool sameBits(const void* a, const void* b, size_t n) {
+	return std::memcmp(a, b, n) == 0;
+}
+
+/**
+ * @brief Compares the kernels with the OpenCV operations in getScan() on a single window of data
+*/
+static void compareKernels(const cv::Mat& dataMat, ProfileWorkspace& ws, KernelMismatches& bad) {
+	int fbIdx[2], voltHead[2];
+	cv::Mat scan, morph, scanVoltage_8U, scanEdges, scanDilated, sobel, kern;
+	std::vector<cv::Point> scanEdgesIdx;
+	int edgeIdx[3], numEdges;
+	double thresh;
+	int len;
+
+	bad.profiles++;
+	kern = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5));
+
+	cv::minMaxIdx(dataMat.row(1), NULL, NULL, fbIdx, NULL);
+	if (argMax1D(dataMat.ptr<double>(1), dataMat.cols) != fbIdx[1]) { bad.trigger++; }
+
+	scan = dataMat(cv::Range(0, 1), cv::Range(fbIdx[1], dataMat.cols)).clone();
+	len = scan.cols;
+	ws.reserve(len);
+
+	cv::morphologyEx(scan, morph, cv::MORPH_BLACKHAT, kern, cv::Point(-1, -1), 2);
+	blackhat1D(scan.ptr<double>(), ws.morph.data(), len, 4, ws);
+	cv::minMaxIdx(morph, NULL, NULL, NULL, voltHead);
+	if (!sameBits(morph.ptr<double>(), ws.morph.data(), len * sizeof(double)) || argMax1D(ws.morph.data(), len) != voltHead[1]) { bad.blackhat++; }
+
+	cv::normalize(scan, scanVoltage_8U, 0, 255, cv::NORM_MINMAX, CV_8U);
+	normalize1D(scan.ptr<double>(), ws.norm.data(), len);
+	if (!sameBits(scanVoltage_8U.ptr<uchar>(), ws.norm.data(), len)) { bad.normalize++; }
+
+	// the rest of the kernels start from the OpenCV output so each kernel is checked on its own
+	thresh = cv::threshold(scanVoltage_8U, scanEdges, 2, 255, cv::THRESH_BINARY + cv::THRESH_OTSU);
+	if (otsu1D(scanVoltage_8U.ptr<uchar>(), len) != (int)thresh) { bad.otsu++; }
+	threshold1D(scanVoltage_8U.ptr<uchar>(), ws.mask.data(), len, (int)thresh);
+	if (!sameBits(scanEdges.ptr<uchar>(), ws.mask.data(), len)) { bad.threshold++; }
+
+	cv::morphologyEx(scanEdges, scanDilated, cv::MORPH_DILATE, kern, cv::Point(-1, -1), 2);
+	maxFilter1D(scanEdges.ptr<uchar>(), ws.dilMask.data(), len, 4);
+	if (!sameBits(scanDilated.ptr<uchar>(), ws.dilMask.data(), len)) { bad.dilate++; }
+
+	cv::Sobel(scanDilated, sobel, -1, 2, 0, 3, 1, 0, cv::BORDER_REPLICATE);
+	cv::findNonZero(sobel, scanEdgesIdx);
+	numEdges = edgePoints1D(scanDilated.ptr<uchar>(), len, edgeIdx, 3);
+	if (numEdges != (int)scanEdgesIdx.size()) { bad.edges++; }
+	else {
+		for (int i = 0; i < numEdges && i < 3; i++) {
+			if (edgeIdx[i] != scanEdgesIdx[i].x) { bad.edges++; break; }
+		}
+	}
+}
+
+/**
+ * @brief Compares the outputs of the OpenCV and kernel versions of getScan() on a single window of data
+*/
+static void compareGetScan(const cv::Mat& dataMat, ProfileWorkspace& ws, KernelMismatches& bad) {
+	Coords fbkCV, fbk1D;
+	cv::Mat scanCV, scan1D;
+	int offsetCV = 0, offset1D = 0;
+	bool retCV, ret1D;
+
+	retCV = getScan(dataMat, &fbkCV, scanCV, offsetCV);
+	ret1D = getScan(dataMat, &fbk1D, scan1D, offset1D, ws);
+
+	if (retCV != ret1D || !sameBits(&fbkCV, &fbk1D, sizeof(Coords))) { bad.getScan++; }
+	else if (retCV) {
+		if (offsetCV != offset1D || scanCV.cols != scan1D.cols || !sameBits(scanCV.ptr<double>(), scan1D.ptr<double>(), scanCV.cols * sizeof(double))) {
+			bad.getScan++;
+		}
+	}
+}
+
+static void printMismatches(std::string name, const KernelMismatches& bad) {
+	std::cout << std::left << std::setw(8) << name << std::right
+		<< " trigger " << bad.trigger
+		<< ", blackhat " << bad.blackhat
+		<< ", normalize " << bad.normalize
+		<< ", otsu " << bad.otsu
+		<< ", threshold " << bad.threshold
+		<< ", dilate " << bad.dilate
+		<< ", edges " << bad.edges
+		<< ", getScan " << bad.getScan
+		<< " (of " << bad.profiles << " profiles)" << std::endl;
+}
+
+bool verifyProfileKernels(std::string logFile) {
+	ScanLogReader reader;
+	ProfileWorkspace ws(NUM_DATA_SAMPLES);
+	std::vector<double> data;
+	std::vector<cv::Mat> windows;
+	KernelMismatches bad[2];
+	bool simd = profileSIMD();
+	int numTriggers;
+
+	if (!reader.open(logFile)) { return false; }
+	if (reader.numSignals() != NUM_DATA_SIGNALS || reader.numSamples() % NUM_DATA_SAMPLES != 0) {
+		std::cout << "Scan log " << logFile << " does not match the data collection configuration." << std::endl;
+		return false;
+	}
+	numTriggers = reader.numSamples() / NUM_DATA_SAMPLES;
+	data.resize((size_t)reader.numSignals() * reader.numSamples());
+
+	// check the AVX2 kernels (if supported) and then the scalar kernels
+	for (int pass = 0; pass < 2; pass++) {
+		if (setProfileSIMD(pass == 0) != (pass == 0)) { continue; }
+		for (uint64_t r = 0; r < reader.size(); r++) {
+			std::memcpy(data.data(), reader.record(r), data.size() * sizeof(double));
+			splitScans(data.data(), numTriggers, windows);
+			for (int i = 0; i < numTriggers; i++) {
+				compareKernels(windows[i], ws, bad[pass]);
+				compareGetScan(windows[i], ws, bad[pass]);
+			}
+		}
+	}
+	setProfileSIMD(simd);
+
+	std::cout << "Profile kernel mismatches against OpenCV in " << logFile << std::endl;
+	if (bad[0].profiles > 0) { printMismatches("AVX2", bad[0]); }
+	printMismatches("scalar", bad[1]);
+	// OpenCV uses FMA in the AVX2 conversion, so the scalar normalize is only expected to match on CPUs without AVX2
+	if (bad[0].profiles > 0 && bad[1].normalize > 0) {
+		std::cout << "The scalar normalize differs from the AVX2 build of OpenCV in the last bit; this is expected on this CPU." << std::endl;
+	}
+	if (bad[0].otsu + bad[1].otsu > 0) {
+		std::cout << "Otsu mismatches can come from the IPP version of cv::threshold. Try again with cv::ipp::setUseIPP(false)." << std::endl;
+	}
+	return (simd ? bad[0].total() : bad[1].total()) == 0;
+}
+
+///////////////////////////////////////  getScan timing  ///////////////////////////////////////
+
+/**
+ * @brief Copies a scan log into memory so the timings do not include reading the file
+ * @param[out] data Scanner data of every block in the log
+ * @param[out] windows Window of data of each profile in each block. Points into data
+ * @return Number of profiles in the log, or -1 if the log could not be read
+*/
+static int loadScanLog(std::string logFile, std::vector<double>& data, std::vector<std::vector<cv::Mat>>& windows) {
+	ScanLogReader reader;
+	int numTriggers, numScans = 0;
+
+	if (!reader.open(logFile)) { return -1; }
+	if (reader.numSignals() != NUM_DATA_SIGNALS || reader.numSamples() % NUM_DATA_SAMPLES != 0) {
+		std::cout << "Scan log " << logFile << " does not match the data collection configuration." << std::endl;
+		return -1;
+	}
+	numTriggers = reader.numSamples() / NUM_DATA_SAMPLES;
+
+	data.resize(reader.size() * reader.numSignals() * reader.numSamples());
+	windows.resize(reader.size());
+	for (uint64_t r = 0; r < reader.size(); r++) {
+		double* block = &data[r * reader.numSignals() * reader.numSamples()];
+		std::memcpy(block, reader.record(r), (size_t)reader.numSignals() * reader.numSamples() * sizeof(double));
+		splitScans(block, numTriggers, windows[r]);
+		numScans += numTriggers;
+	}
+	return numScans;
+}
+
+/**
+ * @brief Finds a print ROI and raster size that covers every profile in the windows
+ * @return FALSE if none of the windows has a profile
+*/
+static bool scanArea(const std::vector<std::vector<cv::Mat>>& windows, ProfileWorkspace& ws, cv::Rect2d& printROI, cv::Size& rasterSize) {
+	Coords fbk;
+	cv::Mat scan;
+	int locXoffset = 0;
+	cv::Point2d minPos(DBL_MAX, DBL_MAX), maxPos(-DBL_MAX, -DBL_MAX);
+
+	for (auto& block : windows) {
+		for (auto& window : block) {
+			if (getScan(window, &fbk, scan, locXoffset, ws)) {
+				minPos = cv::Point2d(std::min(minPos.x, fbk.x), std::min(minPos.y, fbk.y));
+				maxPos = cv::Point2d(std::max(maxPos.x, fbk.x), std::max(maxPos.y, fbk.y));
+			}
+		}
+	}
+	if (minPos.x > maxPos.x) { return false; }
+	// the scanner footprint can reach half the scan width plus the offset of the scanner from the feedback point
+	double reach = SCAN_WIDTH / 2 + std::abs(SCAN_OFFSET_X) + std::abs(SCAN_OFFSET_Y);
+	printROI = cv::Rect2d(minPos - cv::Point2d(reach, reach), maxPos + cv::Point2d(reach, reach));
+	rasterSize = cv::Size(resolution.toPix(printROI.width), resolution.toPix(printROI.height));
+	return true;
+}
+
+void benchGetScan(std::string logFile, int repeats) {
+	ProfileWorkspace ws(NUM_DATA_SAMPLES);
+	std::vector<double> data;
+	std::vector<std::vector<cv::Mat>> windows;
+	Coords fbk;
+	cv::Mat scan;
+	int locXoffset = 0, numScans;
+	bool simd = profileSIMD();
+	std::chrono::steady_clock::time_point t0;
+	double tCV, tSIMD = -1, tScalar;
+
+	if ((numScans = loadScanLog(logFile, data, windows)) <= 0) { return; }
+
+	auto run = [&](bool useKernels) {
+		t0 = std::chrono::steady_clock::now();
+		for (int k = 0; k < repeats; k++) {
+			for (auto& block : windows) {
+				for (auto& window : block) {
+					if (useKernels) { getScan(window, &fbk, scan, locXoffset, ws); }
+					else { getScan(window, &fbk, scan, locXoffset); }
+				}
+			}
+		}
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / ((double)numScans * repeats);
+	};
+
+	tCV = run(false);
+	if (setProfileSIMD(true)) { tSIMD = run(true); }
+	setProfileSIMD(false);
+	tScalar = run(true);
+	setProfileSIMD(simd);
+
+	std::cout << "getScan timing on " << numScans << " profiles x " << repeats << " repeats from " << logFile << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "  OpenCV:         " << tCV << " us/scan" << std::endl;
+	if (tSIMD > 0) { std::cout << "  AVX2 kernels:   " << tSIMD << " us/scan (" << tCV / tSIMD << "x)" << std::endl; }
+	std::cout << "  scalar kernels: " << tScalar << " us/scan (" << tCV / tScalar << "x)" << std::endl;
+	std::cout << std::defaultfloat;
+}
+
+///////////////////////////////////////  scan2ROI timing  ///////////////////////////////////////
+
+// Original implementation of scan2ROI(), which transforms and checks every point of the scan
+static bool scan2ROI_reference(cv::Mat& scan, const Coords fbk, const int locXoffset, const cv::Rect2d printROI, cv::Size rasterSize, cv::Mat& scanROI, cv::Point& scanStart, cv::Point& scanEnd) {
+	cv::Point2d XY_start, XY_end;
+	double X, Y;
+	double local_x;
+	int startIdx = -1, endIdx = -1;
+	double dx = SCAN_WIDTH / (NUM_PROFILE_PTS - 1);
+
+	for (int i = 0; i < scan.cols; i++) {
+		// Local coordinate of the scanned point (with respect to the scanner)
+		local_x = -SCAN_WIDTH / 2 + dx * (i + locXoffset) + SCAN_OFFSET_Y;
+		// Transforming local coordinate to global coordinates
+		X = fbk.x + SCAN_OFFSET_X * cos(fbk.T * PI / -180) - (local_x) * sin(fbk.T * PI / -180);
+		Y = fbk.y + SCAN_OFFSET_X * sin(fbk.T * PI / -180) + (local_x) * cos(fbk.T * PI / -180);
+		// Check if scanned point in outside the print ROI 
+		if (!printROI.contains(cv::Point2d(X, Y))) {
+		}
+		else if (startIdx == -1) {
+			startIdx = i;
+			XY_start = cv::Point2d(X, Y);
+		}
+		else {
+			endIdx = i;
+			XY_end = cv::Point2d(X, Y);
+		}
+	}
+
+	// Check to see if the scan was in the ROI
+	if ((startIdx != -1) && (endIdx != -1)) {
+		//convert the start and end (X,Y) coordinates of the scan to points on the image
+		scanStart = cv::Point(resolution.toPix(XY_start.x - printROI.tl().x), resolution.toPix(XY_start.y - printROI.tl().y));
+		scanEnd = cv::Point(resolution.toPix(XY_end.x - printROI.tl().x), resolution.toPix(XY_end.y - printROI.tl().y));
+		cv::Range scanROIRange = cv::Range(startIdx, endIdx);
+
+		// Interpolate scan so it is the same scale as the raster reference image
+		cv::LineIterator it(rasterSize, scanStart, scanEnd, 8); // make a line iterator between the start and end points of the scan
+		if (it.count == 0) {
+			return false;
+		}
+		cv::resize(scan.colRange(scanROIRange), scanROI, cv::Size(it.count, scan.rows), cv::INTER_LINEAR);
+		return true;
+	}
+	else {
+		//TODO: Remove outputting junk scan start and end points
+		scanStart = cv::Point(-1, -1);
+		scanEnd = cv::Point(-1, -1);
+		return false;
+	}
+
+	return false;
+}
+
+bool benchScan2ROI(int numScans, int repeats) {
+	std::mt19937 gen(0);
+	std::uniform_real_distribution<double> uni(0, 1);
+	cv::Rect2d printROI(100, 50, 60, 40);
+	cv::Size rasterSize(resolution.toPix(printROI.width), resolution.toPix(printROI.height));
+	std::vector<cv::Mat> scans(numScans);
+	std::vector<Coords> fbk(numScans);
+	std::vector<int> locXoffset(numScans);
+	cv::Mat scanROI, refROI;
+	cv::Point scanStart, scanEnd, refStart, refEnd;
+	int numInROI = 0, numDisagree = 0, maxPixDiff = 0;
+	double maxValDiff = 0, tRef, tNew;
+	bool ret, refRet;
+	std::chrono::steady_clock::time_point t0;
+
+	// random scans near the ROI. Half are along the print directions, the rest at random angles
+	for (int i = 0; i < numScans; i++) {
+		fbk[i].x = printROI.x - 30 + uni(gen) * (printROI.width + 60);
+		fbk[i].y = printROI.y - 30 + uni(gen) * (printROI.height + 60);
+		fbk[i].z = 0;
+		fbk[i].T = (i % 2 == 0) ? 90 * std::floor(uni(gen) * 4) : 360 * uni(gen);
+		locXoffset[i] = (int)(uni(gen) * 200);
+		scans[i] = cv::Mat(1, 800 + (int)(uni(gen) * 900), CV_64F);
+		cv::randu(scans[i], -1, 1);
+	}
+
+	// check the outputs agree
+	for (int i = 0; i < numScans; i++) {
+		refRet = scan2ROI_reference(scans[i], fbk[i], locXoffset[i], printROI, rasterSize, refROI, refStart, refEnd);
+		ret = scan2ROI(scans[i], fbk[i], locXoffset[i], printROI, rasterSize, scanROI, scanStart, scanEnd);
+		if (ret != refRet) { numDisagree++; continue; }
+		if (!ret) { continue; }
+		numInROI++;
+		int pixDiff = std::max({ std::abs(scanStart.x - refStart.x), std::abs(scanStart.y - refStart.y), std::abs(scanEnd.x - refEnd.x), std::abs(scanEnd.y - refEnd.y) });
+		maxPixDiff = std::max(maxPixDiff, pixDiff);
+		if (pixDiff > 1) { numDisagree++; }
+		else if (scanROI.cols == refROI.cols) { maxValDiff = std::max(maxValDiff, cv::norm(scanROI, refROI, cv::NORM_INF)); }
+	}
+
+	t0 = std::chrono::steady_clock::now();
+	for (int k = 0; k < repeats; k++) {
+		for (int i = 0; i < numScans; i++) { scan2ROI_reference(scans[i], fbk[i], locXoffset[i], printROI, rasterSize, refROI, refStart, refEnd); }
+	}
+	tRef = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / ((double)numScans * repeats);
+	t0 = std::chrono::steady_clock::now();
+	for (int k = 0; k < repeats; k++) {
+		for (int i = 0; i < numScans; i++) { scan2ROI(scans[i], fbk[i], locXoffset[i], printROI, rasterSize, scanROI, scanStart, scanEnd); }
+	}
+	tNew = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / ((double)numScans * repeats);
+
+	std::cout << "scan2ROI on " << numScans << " random scans (" << numInROI << " in the ROI) x " << repeats << " repeats" << std::endl;
+	std::cout << "  disagreements: " << numDisagree << ", max end point difference: " << maxPixDiff << " px, max profile difference: " << maxValDiff << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "  per-sample: " << tRef << " us/scan" << std::endl;
+	std::cout << "  clipped:    " << tNew << " us/scan (" << tRef / tNew << "x)" << std::endl;
+	std::cout << std::defaultfloat;
+	return numDisagree == 0;
+}
+
+///////////////////////////////////////  Scan depth accuracy  ///////////////////////////////////////
+
+/**
+ * @brief Distance in [px] from each edge pixel in edges to the closest edge pixel in refEdges
+*/
+static void edgeDistances(const cv::Mat& edges, const cv::Mat& refEdges, double& meanDist, double& maxDist, double& exact) {
+	cv::Mat dist;
+	std::vector<cv::Point> pts;
+	cv::distanceTransform(refEdges == 0, dist, cv::DIST_L2, cv::DIST_MASK_PRECISE);
+	cv::findNonZero(edges, pts);
+	meanDist = maxDist = exact = 0;
+	if (pts.empty()) { return; }
+	for (auto& pt : pts) {
+		double d = dist.at<float>(pt);
+		meanDist += d;
+		maxDist = std::max(maxDist, d);
+		exact += (d == 0);
+	}
+	meanDist /= pts.size();
+	exact /= pts.size();
+}
+
+void compareScanDepth(std::string logFile) {
+	ProfileWorkspace ws(NUM_DATA_SAMPLES);
+	std::vector<double> data;
+	std::vector<std::vector<cv::Mat>> windows;
+	Coords fbk;
+	cv::Mat scan, scanROI;
+	cv::Point scanStart, scanEnd;
+	int locXoffset = 0;
+	int depths[2] = { CV_64F, CV_32F };
+	cv::Mat edges[2];
+	double t[2];
+	cv::Rect2d printROI;
+	cv::Size rasterSize;
+	std::chrono::steady_clock::time_point t0;
+
+	if (loadScanLog(logFile, data, windows) <= 0) { return; }
+	if (!scanArea(windows, ws, printROI, rasterSize)) {
+		std::cout << "No profiles found in " << logFile << std::endl;
+		return;
+	}
+	cv::Mat edgeBoundary(rasterSize, CV_8UC1, cv::Scalar(255));
+
+	// find the edges with each depth
+	for (int k = 0; k < 2; k++) {
+		edges[k] = cv::Mat::zeros(rasterSize, CV_8UC1);
+		t0 = std::chrono::steady_clock::now();
+		for (auto& block : windows) {
+			for (auto& window : block) {
+				if (getScan(window, &fbk, scan, locXoffset, ws, depths[k])) {
+					if (scan2ROI(scan, fbk, locXoffset, printROI, rasterSize, scanROI, scanStart, scanEnd)) {
+						findEdges2(edgeBoundary, scanStart, scanEnd, scanROI, edges[k]);
+					}
+				}
+			}
+		}
+		t[k] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+	}
+
+	double meanDist, maxDist, exact;
+	std::cout << "Edge positions of CV_32F vs CV_64F scan processing on " << logFile << std::endl;
+	std::cout << "  edge pixels: CV_64F " << cv::countNonZero(edges[0]) << ", CV_32F " << cv::countNonZero(edges[1]) << std::endl;
+	edgeDistances(edges[1], edges[0], meanDist, maxDist, exact);
+	std::cout << "  CV_32F edges: " << 100 * exact << "% at the same pixel, mean distance " << resolution.toMM(meanDist) << " mm, max distance " << resolution.toMM(maxDist) << " mm from a CV_64F edge" << std::endl;
+	edgeDistances(edges[0], edges[1], meanDist, maxDist, exact);
+	std::cout << "  CV_64F edges: " << 100 * exact << "% at the same pixel, mean distance " << resolution.toMM(meanDist) << " mm, max distance " << resolution.toMM(maxDist) << " mm from a CV_32F edge" << std::endl;
+	std::cout << "  time: CV_64F " << t[0] << " ms, CV_32F " << t[1] << " ms (" << t[0] / t[1] << "x)" << std::endl;
+}
+
+///////////////////////////////////////  Recursive Otsu timing  ///////////////////////////////////////
+
+// Original recursive Otsu loop of findEdges2(), which thresholds and floors the whole profile at every level.
+// The loop floors the profile in place, so it works on a copy to leave the input for the next repeat
+static void multiOtsu_reference(const cv::Mat& src, cv::Mat& pkMask) {
+	cv::Mat ROInorm, threshMask;
+	double thresh, floorVal;
+
+	src.copyTo(ROInorm);
+	pkMask = cv::Mat::zeros(ROInorm.size(), CV_8U);
+	for (int i = 0; i < 7; i++)
+	{
+		thresh = cv::threshold(ROInorm, threshMask, 2, 255, cv::THRESH_BINARY_INV + cv::THRESH_OTSU);
+		floorVal = (thresh) / ((double)i + 1);
+		if (floorVal < 1) { break; }
+		cv::Mat(ROInorm.size(), ROInorm.type(), cv::Scalar(floorVal)).copyTo(ROInorm, threshMask);
+		cv::bitwise_or(threshMask, pkMask, pkMask);
+	}
+}
+
+static void multiOtsu_histogram(const cv::Mat& ROInorm, cv::Mat& pkMask) {
+	int thresh = multiOtsu1D(ROInorm.ptr<uchar>(), (int)ROInorm.total(), 7);
+	if (thresh < 0) { pkMask = cv::Mat::zeros(ROInorm.size(), CV_8U); }
+	else { cv::threshold(ROInorm, pkMask, thresh, 255, cv::THRESH_BINARY_INV); }
+}
+
+bool benchMultiOtsu(std::string logFile, int repeats) {
+	ProfileWorkspace ws(NUM_DATA_SAMPLES);
+	std::vector<double> data;
+	std::vector<std::vector<cv::Mat>> windows;
+	std::vector<cv::Mat> norms;
+	Coords fbk;
+	cv::Mat scan, scanROI, ROIblur, refMask, pkMask;
+	cv::Point scanStart, scanEnd;
+	cv::Scalar mean, stddev;
+	cv::Rect2d printROI;
+	cv::Size rasterSize;
+	int locXoffset = 0, numDisagree = 0;
+	double tRef, tNew;
+	std::chrono::steady_clock::time_point t0;
+
+	if (loadScanLog(logFile, data, windows) <= 0) { return false; }
+	if (!scanArea(windows, ws, printROI, rasterSize)) {
+		std::cout << "No profiles found in " << logFile << std::endl;
+		return false;
+	}
+
+	// normalized scan ROIs as they reach the thresholding in findEdges2()
+	for (auto& block : windows) {
+		for (auto& window : block) {
+			if (getScan(window, &fbk, scan, locXoffset, ws) && scan2ROI(scan, fbk, locXoffset, printROI, rasterSize, scanROI, scanStart, scanEnd)) {
+				cv::GaussianBlur(scanROI, ROIblur, cv::Size(9, 9), 6.1);
+				cv::meanStdDev(ROIblur, mean, stddev);
+				if (stddev.val[0] > 0.015) {
+					norms.push_back(cv::Mat());
+					cv::normalize(ROIblur, norms.back(), 0, 255, cv::NORM_MINMAX, CV_8U);
+				}
+			}
+		}
+	}
+	if (norms.empty()) {
+		std::cout << "No profiles with edges found in " << logFile << std::endl;
+		return false;
+	}
+
+	for (auto& norm : norms) {
+		multiOtsu_reference(norm, refMask);
+		multiOtsu_histogram(norm, pkMask);
+		if (cv::countNonZero(refMask != pkMask) > 0) { numDisagree++; }
+	}
+
+	t0 = std::chrono::steady_clock::now();
+	for (int k = 0; k < repeats; k++) {
+		for (auto& norm : norms) { multiOtsu_reference(norm, refMask); }
+	}
+	tRef = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / ((double)norms.size() * repeats);
+	t0 = std::chrono::steady_clock::now();
+	for (int k = 0; k < repeats; k++) {
+		for (auto& norm : norms) { multiOtsu_histogram(norm, pkMask); }
+	}
+	tNew = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / ((double)norms.size() * repeats);
+
+	std::cout << "Recursive Otsu on " << norms.size() << " scan ROIs x " << repeats << " repeats from " << logFile << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "  threshold loop:   " << tRef << " us/scan" << std::endl;
+	std::cout << "  single histogram: " << tNew << " us/scan (" << tRef / tNew << "x)" << std::endl;
+	std::cout << std::defaultfloat;
+	std::cout << "  pkMask differs on " << numDisagree << " scan ROIs" << std::endl;
+	return numDisagree == 0;
+}
+
+///////////////////////////////////////  Edge write timing  ///////////////////////////////////////
+
+bool benchEdgeWrites(double length, int numScans) {
+	std::mt19937 gen(0);
+	std::uniform_real_distribution<double> uni(0, 1);
+	std::normal_distribution<double> noise(0, 0.005);
+	Raster raster(length, 1.0, 0.9, 2);
+	cv::Size rasterSize = raster.size(0);
+	cv::Mat cachedBoundary = raster.boundaryMask(0).clone();
+	cv::Mat oldEdges = cv::Mat::zeros(rasterSize, CV_8UC1), newEdges = cv::Mat::zeros(rasterSize, CV_8UC1);
+	std::vector<cv::Mat> scanROIs(numScans);
+	std::vector<cv::Point> scanStarts(numScans), scanEnds(numScans);
+	int scanLen = resolution.toPix(SCAN_WIDTH);
+	int border = resolution.toPix(raster.border()), spacing = resolution.toPix(raster.spacing()), halfWidth = resolution.toPix(raster.rodWidth() / 2), pixLen = resolution.toPix(length);
+	double tOld, tNew;
+	std::chrono::steady_clock::time_point t0;
+
+	// scans across the horizontal rods at random positions, with a bump wherever the scan crosses a rod
+	for (int i = 0; i < numScans; i++) {
+		int x = border + (int)(uni(gen) * pixLen);
+		int y = (int)(uni(gen) * (rasterSize.height - scanLen));
+		scanStarts[i] = cv::Point(x, y);
+		scanEnds[i] = cv::Point(x, y + scanLen - 1);
+		scanROIs[i] = cv::Mat(1, scanLen, CV_64F);
+		for (int j = 0; j < scanLen; j++) {
+			int d = (y + j - border) % spacing;
+			d = std::min(std::abs(d), spacing - std::abs(d));
+			scanROIs[i].at<double>(0, j) = ((y + j >= border - halfWidth && y + j <= border + pixLen + halfWidth && d <= halfWidth) ? 0.3 : 0) + noise(gen);
+		}
+	}
+
+	// original: redraw the boundary mask, as Raster::boundaryMask() did before it was cached, and AND it with the whole layer image for every scan
+	t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < numScans; i++) {
+		cv::Mat edgeBoundary = cv::Mat::zeros(rasterSize, CV_8UC1);
+		cv::polylines(edgeBoundary, raster.px(0), false, cv::Scalar(255), resolution.toPix(raster.rodWidth()), 8);
+		findEdges2(edgeBoundary, scanStarts[i], scanEnds[i], scanROIs[i], oldEdges);
+		cv::bitwise_and(edgeBoundary, oldEdges, oldEdges);
+	}
+	tOld = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / numScans;
+
+	// boundary drawn once per layer and only the new edge pixels checked against it
+	t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < numScans; i++) {
+		findEdges2(cachedBoundary, scanStarts[i], scanEnds[i], scanROIs[i], newEdges);
+	}
+	tNew = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / numScans;
+
+	int numDiff = cv::countNonZero(oldEdges != newEdges);
+	std::cout << "Edge writes on a " << length << " x " << length << " mm raster (" << rasterSize.width << " x " << rasterSize.height
+		<< " px at " << resolution.mmPerPix() << " mm/px), " << numScans << " scans" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "  mask per scan + full image AND: " << tOld << " us/scan" << std::endl;
+	std::cout << "  cached mask + per pixel test:   " << tNew << " us/scan (" << tOld / tNew << "x)" << std::endl;
+	std::cout << std::defaultfloat;
+	std::cout << "  " << cv::countNonZero(newEdges) << " edge pixels, " << numDiff << " differ" << std::endl;
+	return numDiff == 0;
+}
+
+///////////////////////////////////////  Rod windows  ///////////////////////////////////////
+
+void compareRodWindows(double length, int numScans) {
+	std::mt19937 gen(0);
+	std::uniform_real_distribution<double> uni(0, 1);
+	Raster raster(length, 1.0, 0.9, 2);
+	int scanLen = resolution.toPix(SCAN_WIDTH);
+	std::vector<int> maskPts, rodPts;
+	std::chrono::steady_clock::time_point t0;
+	double tMask = 0, tRods = 0;
+	int sameCount = 0, exact = 0, maxDiff = 0, numWindows = 0;
+
+	for (int layer = 0; layer < 2; layer++) {
+		EdgeBoundary rods(raster, layer);
+		EdgeBoundary mask(rods.mask());
+		cv::Size rasterSize = rods.mask().size();
+		for (int i = 0; i < numScans / 2; i++) {
+			// scan within 30 deg of across the rods, with both ends inside the raster image
+			cv::Point scanStart, scanEnd;
+			do {
+				double angle = CV_PI / 2 * (1 - layer) + (uni(gen) - 0.5) * CV_PI / 3 + (uni(gen) < 0.5 ? 0 : CV_PI);
+				scanStart = cv::Point((int)(uni(gen) * rasterSize.width), (int)(uni(gen) * rasterSize.height));
+				scanEnd = scanStart + cv::Point((int)std::lround(scanLen * std::cos(angle)), (int)std::lround(scanLen * std::sin(angle)));
+			} while (!cv::Rect(cv::Point(0, 0), rasterSize).contains(scanEnd));
+
+			t0 = std::chrono::steady_clock::now();
+			mask.windows(scanStart, scanEnd, maskPts);
+			tMask += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+			t0 = std::chrono::steady_clock::now();
+			rods.windows(scanStart, scanEnd, rodPts);
+			tRods += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+
+			numWindows += (int)maskPts.size() / 2;
+			if (maskPts.size() != rodPts.size()) { continue; }
+			sameCount++;
+			int diff = 0;
+			for (size_t k = 0; k < maskPts.size(); k++) { diff = std::max(diff, std::abs(maskPts[k] - rodPts[k])); }
+			maxDiff = std::max(maxDiff, diff);
+			if (diff == 0) { exact++; }
+		}
+	}
+	numScans = numScans / 2 * 2;
+	std::cout << "Rod windows of " << numScans << " scans across a " << length << " x " << length << " mm raster, " << numWindows << " windows on the mask" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "  mask walk: " << tMask / numScans << " us/scan, rod geometry: " << tRods / numScans << " us/scan (" << tMask / tRods << "x)" << std::endl;
+	std::cout << "  " << 100.0 * sameCount / numScans << "% of the scans have the same windows, " << 100.0 * exact / numScans
+		<< "% the same points. Largest difference " << maxDiff << " points" << std::endl;
+	std::cout << std::defaultfloat;
+}
+
+///////////////////////////////////////  Prior layer windows  ///////////////////////////////////////
+
+void comparePriorWindows(double length, int numScans) {
+	std::mt19937 gen(0);
+	std::uniform_real_distribution<double> uni(0, 1);
+	std::normal_distribution<double> noise(0, 0.005);
+	Raster raster(length, 1.0, 0.9, 2);
+	EdgeBoundary full(raster, 0), narrowed(raster, 0);
+	cv::Size rasterSize = full.mask().size();
+	int scanLen = resolution.toPix(SCAN_WIDTH);
+	int halfRod = resolution.toPix(0.3); // half the width of the printed rods, narrower than the boundary
+	int spurious = resolution.toPix(0.05); // half the width of the debris on the substrate
+	double tolerance = resolution.toPix(0.1); // distance from a rod edge that counts as finding it
+	std::vector<int> centers; // y of the horizontal rods
+	std::vector<cv::Point2f> edgePts, priorEdges;
+	std::vector<int> windowPts;
+
+	const std::vector<cv::Point>& px = raster.px(0);
+	for (size_t i = 1; i < px.size(); i++) {
+		if (px[i].y == px[i - 1].y) { centers.push_back(px[i].y); }
+	}
+	int xMin = std::min(px[0].x, px[1].x) + halfRod, xMax = std::max(px[0].x, px[1].x) - halfRod;
+
+	// vertical scan across the horizontal rods with some debris between them
+	auto makeScan = [&](cv::Point& scanStart, cv::Point& scanEnd, cv::Mat& scanROI) {
+		int x = xMin + (int)(uni(gen) * (xMax - xMin));
+		int y = (int)(uni(gen) * (rasterSize.height - scanLen));
+		scanStart = cv::Point(x, y);
+		scanEnd = cv::Point(x, y + scanLen - 1);
+		scanROI = cv::Mat(1, scanLen, CV_64F);
+		int debris = y + (int)(uni(gen) * scanLen);
+		for (int j = 0; j < scanLen; j++) {
+			int d = INT_MAX;
+			for (int c : centers) { d = std::min(d, std::abs(y + j - c)); }
+			scanROI.at<double>(0, j) = ((d <= halfRod || std::abs(y + j - debris) <= spurious) ? 0.3 : 0) + noise(gen);
+		}
+	};
+	// TRUE if an edge is not at the edge of a rod
+	auto isSpurious = [&](const cv::Point2f& pt) {
+		double d = DBL_MAX;
+		for (int c : centers) { d = std::min(d, std::abs(std::abs((double)pt.y - c) - halfRod)); }
+		return d > tolerance;
+	};
+
+	// edges of the earlier layer with the same path
+	std::unique_ptr<EdgeDetector> otsu = makeEdgeDetector(edgeMethod::OTSU);
+	cv::Point scanStart, scanEnd;
+	cv::Mat scanROI;
+	for (int i = 0; i < numScans; i++) {
+		makeScan(scanStart, scanEnd, scanROI);
+		otsu->find(full, scanStart, scanEnd, scanROI, edgePts);
+		priorEdges.insert(priorEdges.end(), edgePts.begin(), edgePts.end());
+	}
+	int numBins = narrowed.setPrior(priorEdges, resolution.toPix(0.25));
+
+	// same scans searched in the full and the narrowed boundary
+	const int methods[] = { edgeMethod::OTSU, edgeMethod::DERIVATIVE };
+	const EdgeBoundary* boundaries[] = { &full, &narrowed };
+	long long samples[2] = { 0, 0 }, numEdges[2][2] = { {0, 0}, {0, 0} }, numSpurious[2][2] = { {0, 0}, {0, 0} };
+	std::vector<std::unique_ptr<EdgeDetector>> detectors;
+	for (int method : methods) { detectors.push_back(makeEdgeDetector(method)); }
+	for (int i = 0; i < numScans; i++) {
+		makeScan(scanStart, scanEnd, scanROI);
+		for (int b = 0; b < 2; b++) {
+			boundaries[b]->windows(scanStart, scanEnd, windowPts);
+			for (size_t k = 0; k < windowPts.size(); k += 2) { samples[b] += windowPts[k + 1] - windowPts[k]; }
+			for (int m = 0; m < 2; m++) {
+				detectors[m]->find(*boundaries[b], scanStart, scanEnd, scanROI, edgePts);
+				numEdges[m][b] += edgePts.size();
+				for (auto& pt : edgePts) { numSpurious[m][b] += isSpurious(pt); }
+			}
+		}
+	}
+
+	std::cout << "Edge search narrowed to the edges of layer - 2 on " << numScans << " scans across a " << length << " x " << length
+		<< " mm raster, " << numBins << " rod sections narrowed" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "  window samples/scan: full " << (double)samples[0] / numScans << ", narrowed " << (double)samples[1] / numScans
+		<< " (" << 100.0 * samples[1] / std::max(samples[0], 1LL) << "%)" << std::endl;
+	for (int m = 0; m < 2; m++) {
+		std::cout << "  " << std::left << std::setw(12) << edgeMethod::name(methods[m]) << std::right << " edges/scan: full " << (double)numEdges[m][0] / numScans
+			<< " (" << numSpurious[m][0] << " spurious), narrowed " << (double)numEdges[m][1] / numScans << " (" << numSpurious[m][1] << " spurious)" << std::endl;
+	}
+	std::cout << std::defaultfloat;
+}
+
+///////////////////////////////////////  Sub-pixel edge accuracy  ///////////////////////////////////////
+
+// Height in [mm] at x from the center of a rod with a circular cross section seen through a Gaussian blur, like the smoothed profile in findEdges2()
+static double rodHeight(double x, double width, double height, double blur) {
+	const double step = 0.002; // [mm]
+	double sum = 0, sumK = 0, k, u;
+
+	for (double t = -3 * blur; t <= 3 * blur; t += step) {
+		k = std::exp(-t * t / (2 * blur * blur));
+		u = 2 * (x - t) / width;
+		sum += k * ((std::abs(u) < 1) ? height * std::sqrt(1 - u * u) : 0);
+		sumK += k;
+	}
+	return sum / sumK;
+}
+
+// Position from the center of the rod between lo and hi where the rod height crosses the level
+static double rodCrossing(double lo, double hi, double width, double height, double blur, double level) {
+	bool loAbove = rodHeight(lo, width, height, blur) > level;
+	double mid;
+
+	for (int i = 0; i < 40; i++) {
+		mid = (lo + hi) / 2;
+		if ((rodHeight(mid, width, height, blur) > level) == loAbove) { lo = mid; }
+		else { hi = mid; }
+	}
+	return (lo + hi) / 2;
+}
+
+// Position from the center of the rod between lo and hi where the rod height falls the fastest, which the derivative of findEdges() finds
+static double rodSteepest(double lo, double hi, double width, double height, double blur) {
+	const double h = 0.001; // [mm]
+	auto slope = [&](double x) { return (rodHeight(x + h, width, height, blur) - rodHeight(x - h, width, height, blur)) / (2 * h); };
+	double m1, m2;
+
+	for (int i = 0; i < 60; i++) {
+		m1 = lo + (hi - lo) / 3;
+		m2 = hi - (hi - lo) / 3;
+		if (slope(m1) < slope(m2)) { hi = m2; }
+		else { lo = m1; }
+	}
+	return (lo + hi) / 2;
+}
+
+void reportSubPixelAccuracy(int numRods) {
+	const double resolutions[] = { 0.02, 0.03, 0.05, 0.075, 0.1 };
+	const double height = 0.3, level = 0.005, blur = 0.05, halfLength = 1.0; // [mm]
+	std::mt19937 gen(0);
+	std::uniform_real_distribution<double> uni(0, 1);
+	std::normal_distribution<double> noise(0, 0.001);
+	std::vector<double> profile, deriv;
+	std::vector<double> sums(8);
+
+	std::cout << "Width error of the edges of " << numRods << " synthetic rods 0.8-1.2 mm wide and " << height << " mm high, "
+		<< blur << " mm blur, 0.001 mm noise" << std::endl;
+	std::cout << "  threshold crossings (findEdges2) and derivative extrema (findEdges), bias / rms [mm]" << std::endl;
+	std::cout << "  res [mm]  px/layer     threshold whole pixel       sub-pixel    derivative whole pixel       sub-pixel" << std::endl;
+	std::cout << std::fixed;
+	for (double res : resolutions) {
+		int n = (int)std::lround(2 * halfLength / res) + 1;
+		double errInt, errSub, errDerInt, errDerSub;
+		int numFound = 0;
+		profile.resize(n);
+		deriv.assign(n, 0);
+		std::fill(sums.begin(), sums.end(), 0);
+
+		for (int k = 0; k < numRods; k++) {
+			// circular cap at a random offset from the sample grid
+			double width = 0.8 + 0.4 * uni(gen);
+			double center = halfLength + res * uni(gen);
+			double trueWidth = 2 * rodCrossing(0, halfLength, width, height, blur, level); // distance between the threshold crossings
+			double steepWidth = 2 * rodSteepest(0, halfLength, width, height, blur); // distance between the extrema of the derivative
+			for (int i = 0; i < n; i++) {
+				profile[i] = rodHeight(i * res - center, width, height, blur) + noise(gen);
+			}
+			// outer edge pixels on either side of the samples above the threshold
+			int first = -1, last = -1;
+			for (int i = 0; i < n; i++) {
+				if (profile[i] > level) {
+					if (first < 0) { first = i; }
+					last = i;
+				}
+			}
+			if (first < 1 || last > n - 2) { continue; }
+			errInt = ((last + 1) - (first - 1)) * res - trueWidth;
+			errSub = ((last + crossing1D(profile[last], profile[last + 1], level)) - (first - 1 + crossing1D(profile[first - 1], profile[first], level))) * res - trueWidth;
+
+			// largest rise and fall of the central difference, at whole pixels and at the vertex of the parabola through them
+			int rise = 1, fall = 1;
+			for (int i = 1; i < n - 1; i++) {
+				deriv[i] = (profile[i + 1] - profile[i - 1]) / 2;
+				if (deriv[i] > deriv[rise]) { rise = i; }
+				if (deriv[i] < deriv[fall]) { fall = i; }
+			}
+			if (rise < 2 || fall < 2 || rise > n - 3 || fall > n - 3) { continue; }
+			errDerInt = (fall - rise) * res - steepWidth;
+			errDerSub = ((fall + peak1D(deriv[fall - 1], deriv[fall], deriv[fall + 1])) - (rise + peak1D(deriv[rise - 1], deriv[rise], deriv[rise + 1]))) * res - steepWidth;
+
+			const double errs[] = { errInt, errSub, errDerInt, errDerSub };
+			for (int e = 0; e < 4; e++) {
+				sums[2 * e] += errs[e];
+				sums[2 * e + 1] += errs[e] * errs[e];
+			}
+			numFound++;
+		}
+		if (numFound == 0) { continue; }
+		std::cout << std::setprecision(3) << "  " << std::setw(8) << res << std::setprecision(2) << std::setw(9) << (DefaultResolution::MM / res) * (DefaultResolution::MM / res)
+			<< std::setprecision(4);
+		for (int e = 0; e < 4; e++) { std::cout << "   " << std::setw(9) << sums[2 * e] / numFound << " / " << std::sqrt(sums[2 * e + 1] / numFound); }
+		std::cout << std::endl;
+	}
+	std::cout << std::defaultfloat;
+}
+
+///////////////////////////////////////  Edge detector comparison  ///////////////////////////////////////
+
+static const std::atomic<long long>* allocCounter = nullptr;
+
+void setAllocationCounter(const std::atomic<long long>* counter) {
+	allocCounter = counter;
+}
+
+static long long allocations() {
+	return allocCounter ? allocCounter->load(std::memory_order_relaxed) : 0;
+}
+
+// Value at the fraction p of the sorted values
+static double percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) { return 0; }
+	return sorted[std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5))];
+}
+
+void compareEdgeDetectors(std::string logFile, int reference) {
+	const int methods[] = { edgeMethod::OTSU, edgeMethod::DERIVATIVE, edgeMethod::DERIVATIVE2 };
+	const double heightThresh = 0.1; // [mm] height above the substrate that is material when making the edge boundary
+	ProfileWorkspace ws(NUM_DATA_SAMPLES);
+	std::vector<double> data;
+	std::vector<std::vector<cv::Mat>> windows;
+	std::vector<cv::Point2f> edgePts;
+	std::vector<double> latency;
+	Coords fbk;
+	cv::Mat scan, scanROI;
+	cv::Point scanStart, scanEnd;
+	int locXoffset = 0, numScans = 0;
+	cv::Rect2d printROI;
+	cv::Size rasterSize;
+	std::chrono::steady_clock::time_point t0;
+
+	if (loadScanLog(logFile, data, windows) <= 0) { return; }
+	if (!scanArea(windows, ws, printROI, rasterSize)) {
+		std::cout << "No profiles found in " << logFile << std::endl;
+		return;
+	}
+
+	// runs fn on every profile that reaches the edge detection
+	auto forEachScan = [&](auto fn) {
+		for (auto& block : windows) {
+			for (auto& window : block) {
+				if (getScan(window, &fbk, scan, locXoffset, ws) && scan2ROI(scan, fbk, locXoffset, printROI, rasterSize, scanROI, scanStart, scanEnd)) {
+					fn();
+				}
+			}
+		}
+	};
+
+	// edge boundary around the material seen by the scans
+	cv::Mat boundaryMask = cv::Mat::zeros(rasterSize, CV_8UC1);
+	forEachScan([&]() {
+		cv::LineIterator lineit(boundaryMask, scanStart, scanEnd, 8);
+		for (int i = 0; i < lineit.count && i < scanROI.cols; i++, ++lineit) {
+			double z = (scanROI.depth() == CV_32F) ? scanROI.at<float>(0, i) : scanROI.at<double>(0, i);
+			if (z > heightThresh) { boundaryMask.at<uchar>(lineit.pos()) = 255; }
+		}
+		numScans++;
+	});
+	cv::morphologyEx(boundaryMask, boundaryMask, cv::MORPH_CLOSE, cv::Mat::ones(resolution.toPix(0.5), resolution.toPix(0.5), CV_8UC1));
+	cv::morphologyEx(boundaryMask, boundaryMask, cv::MORPH_DILATE, cv::Mat::ones(resolution.toPix(0.5), resolution.toPix(0.5), CV_8UC1));
+	EdgeBoundary edgeBoundary(boundaryMask);
+
+	// run each detector and keep its edges
+	std::vector<cv::Mat> edges;
+	std::cout << "Edge detectors on " << numScans << " profiles from " << logFile << std::endl;
+	if (!allocCounter) { std::cout << "  (no allocation counter set)" << std::endl; }
+	std::cout << "  detector      p50 / p90 / p99 / max [us/scan]      allocs/scan (max)   edges" << std::endl;
+	for (int method : methods) {
+		std::unique_ptr<EdgeDetector> detector = makeEdgeDetector(method);
+		cv::Mat found = cv::Mat::zeros(rasterSize, CV_8UC1);
+		long long allocs = 0, maxAllocs = 0, a0;
+		size_t numEdges = 0;
+		latency.clear();
+		latency.reserve(numScans);
+
+		forEachScan([&]() {
+			a0 = allocations();
+			t0 = std::chrono::steady_clock::now();
+			detector->find(edgeBoundary, scanStart, scanEnd, scanROI, edgePts);
+			latency.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+			a0 = allocations() - a0;
+			allocs += a0;
+			maxAllocs = std::max(maxAllocs, a0);
+			numEdges += edgePts.size();
+			for (auto& pt : edgePts) {
+				cv::Point pix = pt;
+				if (pix.x >= 0 && pix.y >= 0 && pix.x < rasterSize.width && pix.y < rasterSize.height) { found.at<uchar>(pix) = 255; }
+			}
+		});
+		edges.push_back(found);
+
+		std::sort(latency.begin(), latency.end());
+		std::cout << std::fixed << std::setprecision(1) << "  " << std::left << std::setw(12) << detector->name() << std::right
+			<< std::setw(8) << percentile(latency, 0.5) << " / " << percentile(latency, 0.9) << " / " << percentile(latency, 0.99) << " / " << percentile(latency, 1.0);
+		if (allocCounter) { std::cout << "      " << std::setw(8) << (double)allocs / std::max(numScans, 1) << " (" << maxAllocs << ")"; }
+		else { std::cout << "      " << std::setw(8) << "n/a"; }
+		std::cout << "   " << numEdges << std::endl;
+	}
+	std::cout << std::defaultfloat;
+
+	// agreement with the reference edges
+	int ref = (int)(std::find(std::begin(methods), std::end(methods), reference) - std::begin(methods));
+	if (ref >= (int)edges.size()) {
+		std::cout << "Unknown reference edge detector " << reference << std::endl;
+		return;
+	}
+	double meanDist, maxDist, exact;
+	std::cout << "  agreement with the " << edgeMethod::name(reference) << " edges" << std::endl;
+	for (int k = 0; k < (int)edges.size(); k++) {
+		if (k == ref) { continue; }
+		edgeDistances(edges[k], edges[ref], meanDist, maxDist, exact);
+		std::cout << "  " << edgeMethod::name(methods[k]) << ": " << 100 * exact << "% at a reference pixel, mean distance " << resolution.toMM(meanDist)
+			<< " mm, max " << resolution.toMM(maxDist) << " mm";
+		edgeDistances(edges[ref], edges[k], meanDist, maxDist, exact);
+		std::cout << "; " << 100 * exact << "% of the reference pixels found, mean distance " << resolution.toMM(meanDist) << " mm" << std::endl;
+	}
+}
+
+///////////////////////////////////////  Parallel scan processing  ///////////////////////////////////////
+
+bool benchScanWorkers(std::string logFile, int maxWorkers, int repeats) {
+	ProfileWorkspace ws(NUM_DATA_SAMPLES);
+	std::vector<double> data;
+	std::vector<std::vector<cv::Mat>> windows;
+	std::vector<cv::Mat> scans; // every profile of the log in acquisition order
+	cv::Rect2d printROI;
+	cv::Size rasterSize;
+	std::chrono::steady_clock::time_point t0;
+	double tSerial, t;
+	bool match = true;
+
+	if (loadScanLog(logFile, data, windows) <= 0) { return false; }
+	if (!scanArea(windows, ws, printROI, rasterSize)) {
+		std::cout << "No profiles found in " << logFile << std::endl;
+		return false;
+	}
+	for (auto& block : windows) {
+		for (auto& window : block) { scans.push_back(window); }
+	}
+	EdgeBoundary edgeBoundary(cv::Mat(rasterSize, CV_8UC1, cv::Scalar(255)));
+	unsigned cores = std::thread::hardware_concurrency();
+	if (maxWorkers <= 0) { maxWorkers = std::max(1, (int)cores); }
+	long long total = (long long)scans.size() * repeats;
+
+	// processed on this thread, as t_CollectScans() does with a single worker
+	ScanWorkspace sw(edgeMethod::OTSU);
+	ScanResult result;
+	std::vector<std::vector<cv::Point2f>> refEdges(scans.size());
+	t0 = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats; r++) {
+		for (size_t i = 0; i < scans.size(); i++) {
+			processScan(scans[i], printROI, rasterSize, edgeBoundary, CV_64F, sw, result);
+			if (r == 0) { refEdges[i] = result.edges; }
+		}
+	}
+	tSerial = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	std::cout << "Scan processing of " << scans.size() << " profiles from " << logFile << " x" << repeats << " on " << cores << " hardware threads" << std::endl;
+	std::cout << "  workers     scans/s   speedup   efficiency" << std::endl;
+	std::cout << std::fixed << std::setprecision(2) << "  serial " << std::setw(12) << total / tSerial << std::endl;
+
+	std::vector<int> counts;
+	for (int n = 1; n < maxWorkers; n *= 2) { counts.push_back(n); }
+	counts.push_back(maxWorkers);
+	for (int n : counts) {
+		std::vector<std::unique_ptr<ScanWorkspace>> spaces;
+		std::vector<ScanResult> results(4 * n); // job slots, reused once their result has been committed
+		long long numSubmitted = 0, numCommitted = 0, mismatched = 0;
+		for (int i = 0; i < n; i++) { spaces.push_back(std::make_unique<ScanWorkspace>(edgeMethod::OTSU)); }
+		{
+			ScanWorkers workers(n, [&](long long ticket, int worker) {
+				processScan(scans[ticket % scans.size()], printROI, rasterSize, edgeBoundary, CV_64F, *spaces[worker], results[ticket % results.size()]);
+				});
+			t0 = std::chrono::steady_clock::now();
+			while (numCommitted < total) {
+				while (numSubmitted < total && numSubmitted - numCommitted < (long long)results.size()) { numSubmitted = workers.submit() + 1; }
+				// commit in acquisition order
+				if (!workers.wait(numCommitted, std::chrono::milliseconds(100))) { continue; }
+				if (results[numCommitted % results.size()].edges != refEdges[numCommitted % scans.size()]) { mismatched++; }
+				numCommitted++;
+			}
+			t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		}
+		std::cout << "  " << std::setw(6) << n << std::setw(12) << total / t << std::setw(9) << tSerial / t << "x" << std::setw(11) << 100 * tSerial / t / n << "%";
+		if (mismatched > 0) { std::cout << "   " << mismatched << " scans differ from the serial edges"; }
+		std::cout << std::endl;
+		match = match && mismatched == 0;
+	}
+	std::cout << std::defaultfloat;
+	return match;
+}
+
+///////////////////////////////////////  Height map  ///////////////////////////////////////
+
+void benchHeightMap(std::string logFile) {
+	ProfileWorkspace ws(NUM_DATA_SAMPLES);
+	std::vector<double> data;
+	std::vector<std::vector<cv::Mat>> windows;
+	cv::Rect2d printROI;
+	cv::Size rasterSize;
+	std::chrono::steady_clock::time_point t0;
+	double t = 0;
+	long long numPts = 0;
+	int numScans = 0;
+
+	if (loadScanLog(logFile, data, windows) <= 0) { return; }
+	if (!scanArea(windows, ws, printROI, rasterSize)) {
+		std::cout << "No profiles found in " << logFile << std::endl;
+		return;
+	}
+	EdgeBoundary edgeBoundary(cv::Mat(rasterSize, CV_8UC1, cv::Scalar(255)));
+	ScanWorkspace sw(edgeMethod::OTSU);
+	ScanResult result;
+	HeightMap heightMap(rasterSize);
+
+	for (auto& block : windows) {
+		for (auto& window : block) {
+			processScan(window, printROI, rasterSize, edgeBoundary, CV_64F, sw, result);
+			if (!result.valid) { continue; }
+			t0 = std::chrono::steady_clock::now();
+			heightMap.addScan(result.scanStart, result.scanEnd, result.heights);
+			t += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+			numPts += result.heights.size();
+			numScans++;
+		}
+	}
+
+	// the map must give back the last height written to each pixel of the last scan
+	std::vector<float> check;
+	heightMap.profile(result.scanStart, result.scanEnd, check);
+	bool match = result.valid ? (check == result.heights) : true;
+
+	std::cout << "Height map of " << numScans << " scans from " << logFile << " (" << rasterSize.width << " x " << rasterSize.height << " px)" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "  update: " << t / std::max(numScans, 1) << " us/scan, " << 1000 * t / std::max(numPts, 1LL) << " ns/point" << std::endl;
+	std::cout << std::defaultfloat;
+	std::cout << "  memory: " << heightMap.numTiles() << " tiles, " << heightMap.bytes() / 1024 << " kB ("
+		<< (size_t)rasterSize.width * rasterSize.height * sizeof(float) / 1024 << " kB dense)" << std::endl;
+	if (!match) { std::cout << "  The heights read back from the map DO NOT match the last scan." << std::endl; }
+}
+
+///////////////////////////////////////  Profile prefilters  ///////////////////////////////////////
+
+// Sliding median that sorts each window, the reference for medianFilter1D()
+static void medianFilter_reference(const double* src, double* dst, int n, int radius, std::vector<double>& win) {
+	int lo, hi;
+
+	for (int i = 0; i < n; i++) {
+		lo = std::max(0, i - radius);
+		hi = std::min(n - 1, i + radius);
+		win.assign(src + lo, src + hi + 1);
+		std::nth_element(win.begin(), win.begin() + (hi - lo) / 2, win.end());
+		dst[i] = win[(hi - lo) / 2];
+	}
+}
+
+void comparePrefilters(std::string logFile, double spikeRate, int radius) {
+	const int radii[] = { 2, 5, 10, 25, 50 };
+	const int filters[] = { profileFilter::NONE, profileFilter::MEDIAN, profileFilter::HAMPEL };
+	const double farDist = 2; // [px] edges further than this from a reference edge are spurious
+	ProfileWorkspace ws(NUM_DATA_SAMPLES);
+	std::vector<double> data, win;
+	std::vector<std::vector<cv::Mat>> windows;
+	std::vector<cv::Mat> rois, spiked; // scan ROIs of the log and the same ROIs with dropout spikes
+	std::vector<cv::Point> starts, ends;
+	std::vector<cv::Point2f> edgePts;
+	Coords fbk;
+	cv::Mat scan, scanROI;
+	cv::Point scanStart, scanEnd;
+	int locXoffset = 0;
+	long long numSamples = 0, numSpikes = 0;
+	cv::Rect2d printROI;
+	cv::Size rasterSize;
+	std::chrono::steady_clock::time_point t0;
+
+	if (loadScanLog(logFile, data, windows) <= 0) { return; }
+	if (!scanArea(windows, ws, printROI, rasterSize)) {
+		std::cout << "No profiles found in " << logFile << std::endl;
+		return;
+	}
+	for (auto& block : windows) {
+		for (auto& window : block) {
+			if (getScan(window, &fbk, scan, locXoffset, ws) && scan2ROI(scan, fbk, locXoffset, printROI, rasterSize, scanROI, scanStart, scanEnd)) {
+				rois.push_back(scanROI.clone());
+				starts.push_back(scanStart);
+				ends.push_back(scanEnd);
+				numSamples += scanROI.total();
+			}
+		}
+	}
+	if (rois.empty()) {
+		std::cout << "No profiles of " << logFile << " cross the print" << std::endl;
+		return;
+	}
+
+	// single sample dropouts of either sign, as the scanner gives when the laser line is lost or reflected
+	std::mt19937 gen(0);
+	std::uniform_real_distribution<double> uni(0, 1);
+	for (auto& roi : rois) {
+		cv::Mat s = roi.clone();
+		for (int i = 0; i < (int)s.total(); i++) {
+			if (uni(gen) < spikeRate) {
+				s.at<double>(0, i) += ((uni(gen) < 0.5) ? -1 : 1) * (0.1 + 0.9 * uni(gen));
+				numSpikes++;
+			}
+		}
+		spiked.push_back(s);
+	}
+
+	// cost per scan against the window radius
+	std::cout << "Profile prefilters on " << rois.size() << " scan ROIs (" << numSamples / rois.size() << " samples on average) from " << logFile << std::endl;
+	std::cout << "  radius    median   hampel   sorted median [us/scan]   max median error [quantization steps]" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	for (int r : radii) {
+		double tMed = 0, tHampel = 0, tRef = 0, maxErr = 0, smin, smax;
+		for (auto& roi : spiked) {
+			int n = (int)roi.total();
+			cv::Mat med(roi.size(), CV_64F), ref(roi.size(), CV_64F);
+			t0 = std::chrono::steady_clock::now();
+			medianFilter1D(roi.ptr<double>(), med.ptr<double>(), n, r, ws);
+			tMed += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+			t0 = std::chrono::steady_clock::now();
+			hampel1D(roi.ptr<double>(), ref.ptr<double>(), n, r, 3, ws);
+			tHampel += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+			t0 = std::chrono::steady_clock::now();
+			medianFilter_reference(roi.ptr<double>(), ref.ptr<double>(), n, r, win);
+			tRef += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+
+			// a quantization step is (max - min) / (RANK_LEVELS - 1), so the medians are within half a step
+			cv::minMaxLoc(roi, &smin, &smax);
+			if (smax > smin) { maxErr = std::max(maxErr, cv::norm(med, ref, cv::NORM_INF) * (ProfileWorkspace::RANK_LEVELS - 1) / (smax - smin)); }
+		}
+		std::cout << "  " << std::setw(6) << r << std::setw(10) << tMed / rois.size() << std::setw(9) << tHampel / rois.size()
+			<< std::setw(16) << tRef / rois.size() << std::setw(28) << maxErr << std::endl;
+	}
+
+	// edges of the clean profiles without a prefilter are the reference
+	EdgeBoundary edgeBoundary(cv::Mat(rasterSize, CV_8UC1, cv::Scalar(255)));
+	cv::Mat refEdges, refDist;
+	auto findAll = [&](EdgeDetector& detector, std::vector<cv::Mat>& profiles, cv::Mat& found, double& t) {
+		found = cv::Mat::zeros(rasterSize, CV_8UC1);
+		t = 0;
+		for (size_t k = 0; k < profiles.size(); k++) {
+			t0 = std::chrono::steady_clock::now();
+			detector.find(edgeBoundary, starts[k], ends[k], profiles[k], edgePts);
+			t += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+			for (auto& pt : edgePts) {
+				cv::Point pix = pt;
+				if (pix.x >= 0 && pix.y >= 0 && pix.x < rasterSize.width && pix.y < rasterSize.height) { found.at<uchar>(pix) = 255; }
+			}
+		}
+		t /= profiles.size();
+	};
+	// edge pixels further than farDist from a reference edge
+	auto numFar = [&](const cv::Mat& found) {
+		std::vector<cv::Point> pts;
+		int count = 0;
+		cv::findNonZero(found, pts);
+		for (auto& pt : pts) { count += (refDist.at<float>(pt) > farDist); }
+		return count;
+	};
+	double t;
+	std::unique_ptr<EdgeDetector> reference = makeEdgeDetector(edgeMethod::OTSU);
+	findAll(*reference, rois, refEdges, t);
+	cv::distanceTransform(refEdges == 0, refDist, cv::DIST_L2, cv::DIST_MASK_PRECISE);
+
+	std::cout << std::defaultfloat << "  " << numSpikes << " dropout spikes of 0.1-1 mm added (" << 100 * spikeRate << "% of the samples), "
+		<< edgeMethod::name(edgeMethod::OTSU) << " detector, radius " << radius << " px, " << cv::countNonZero(refEdges) << " reference edge pixels" << std::endl;
+	std::cout << "  prefilter     clean / spiked [us/scan]   edges further than " << farDist << " px from the reference: clean / spiked" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+	for (int filter : filters) {
+		std::unique_ptr<EdgeDetector> detector = makeEdgeDetector(edgeMethod::OTSU, filter, radius);
+		cv::Mat clean, dirty;
+		double tClean, tDirty;
+		findAll(*detector, rois, clean, tClean);
+		findAll(*detector, spiked, dirty, tDirty);
+		std::cout << "  " << std::left << std::setw(10) << profileFilter::name(filter) << std::right << std::setw(10) << tClean << " / " << std::setw(6) << tDirty
+			<< std::setw(30) << numFar(clean) << " / " << numFar(dirty) << std::endl;
+	}
+	std::cout << std::defaultfloat;
+}
+
+///////////////////////////////////////  Tiled images  ///////////////////////////////////////
+
+bool benchTiledImage(double length, double spacing, int numLayers) {
+	Raster raster(length, spacing, 0.9, 2);
+	int halfWidth = (int)resolution.toPix(0.4); // edges of 0.8 mm wide rods
+	std::vector<cv::Point> densePts, tiledPts;
+	std::chrono::steady_clock::time_point t0;
+	double tSetDense = 0, tSetTiled = 0, tFindDense = 0, tFindTiled = 0, tLinesDense = 0, tLinesTiled = 0;
+	size_t denseBytes = 0, tiledBytes = 0;
+	long long numPts = 0;
+	bool match = true;
+
+	for (int layer = 0; layer < numLayers; layer++) {
+		const std::vector<cv::Point>& px = raster.px(layer);
+		cv::Mat dense = cv::Mat::zeros(raster.size(layer), CV_8UC1);
+		TiledImage tiled(raster.size(layer));
+
+		// edge pixels on both sides of every line of the raster path, as t_GetMatlErrors() marks them
+		std::vector<cv::Point> edgePts;
+		for (size_t i = 1; i < px.size(); i++) {
+			cv::Point d = px[i] - px[i - 1];
+			cv::Point step(d.x > 0 ? 1 : d.x < 0 ? -1 : 0, d.y > 0 ? 1 : d.y < 0 ? -1 : 0);
+			cv::Point normal(-step.y * halfWidth, step.x * halfWidth);
+			for (cv::Point p = px[i - 1]; p != px[i]; p += step) {
+				edgePts.push_back(p + normal);
+				edgePts.push_back(p - normal);
+			}
+		}
+		numPts += edgePts.size();
+
+		t0 = std::chrono::steady_clock::now();
+		for (auto& pt : edgePts) {
+			if (pt.x >= 0 && pt.y >= 0 && pt.x < dense.cols && pt.y < dense.rows) { dense.at<uchar>(pt) = 255; }
+		}
+		tSetDense += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		t0 = std::chrono::steady_clock::now();
+		for (auto& pt : edgePts) { tiled.set(pt, cv::Scalar(255)); }
+		tSetTiled += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+		// the raster path drawn over the edges
+		t0 = std::chrono::steady_clock::now();
+		cv::polylines(dense, px, false, cv::Scalar(128), 3, 8);
+		tLinesDense += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		t0 = std::chrono::steady_clock::now();
+		tiled.polylines(px, false, cv::Scalar(128), 3, 8);
+		tLinesTiled += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+		t0 = std::chrono::steady_clock::now();
+		cv::findNonZero(dense, densePts);
+		tFindDense += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		t0 = std::chrono::steady_clock::now();
+		tiled.findNonZero(tiledPts);
+		tFindTiled += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+		cv::Mat copy;
+		tiled.copyTo(copy);
+		if (densePts != tiledPts || cv::countNonZero(copy != dense) > 0) { match = false; }
+		denseBytes += dense.total();
+		tiledBytes += tiled.bytes();
+	}
+
+	std::cout << "Tiled edge images of " << numLayers << " layers of a " << length << " x " << length << " mm raster with " << spacing << " mm rod spacing ("
+		<< raster.size(0).width << " x " << raster.size(0).height << " px), " << numPts << " edge points" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "              dense      tiled [ms]" << std::endl;
+	std::cout << "  set     " << std::setw(10) << tSetDense << std::setw(11) << tSetTiled << std::endl;
+	std::cout << "  lines   " << std::setw(10) << tLinesDense << std::setw(11) << tLinesTiled << std::endl;
+	std::cout << "  find    " << std::setw(10) << tFindDense << std::setw(11) << tFindTiled << std::endl;
+	std::cout << std::defaultfloat;
+	std::cout << "  memory: " << tiledBytes / 1024 << " kB in tiles, " << denseBytes / 1024 << " kB dense" << std::endl;
+	if (!match) { std::cout << "  The tiled images DO NOT match the dense images." << std::endl; }
+	return match;
+}
+
+///////////////////////////////////////  Segment index  ///////////////////////////////////////
+
+bool compareSegmentIndex(int numSegments, int numPts) {
+	const double angle = CV_PI / 6, length = 2000, spacing = 40, width = 40, margin = 12; // [px]
+	cv::Point2d dir(std::cos(angle), std::sin(angle)), normal(-std::sin(angle), std::cos(angle));
+	std::vector<std::vector<cv::Point2d>> polylines(1);
+	std::vector<cv::Point2d> pts(numPts);
+	std::vector<cv::Rect2d> boxes;
+	std::vector<int> hits, bruteHits;
+	std::mt19937 rng(1);
+	std::chrono::steady_clock::time_point t0;
+	double tBuild, tQueryIndex = 0, tQueryBrute = 0, tNearestIndex = 0, tNearestBrute = 0;
+	double offset, d, bestDist, maxDist = width / 2 + margin;
+	int seg, best, containMismatches = 0, nearestMismatches = 0;
+	long long numHits = 0, numNear = 0;
+
+	// serpentine raster rotated by 30 degrees, so the segment boxes overlap their neighbours
+	for (int i = 0; i <= numSegments / 2; i++) {
+		cv::Point2d start = i * spacing * normal + ((i % 2) ? length * dir : cv::Point2d(0, 0));
+		polylines[0].push_back(start);
+		polylines[0].push_back(start + ((i % 2) ? -length : length) * dir);
+	}
+	polylines[0].resize(numSegments + 1);
+
+	t0 = std::chrono::steady_clock::now();
+	Toolpath toolpath(polylines, width);
+	tBuild = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+	for (int i = 0; i < toolpath.numSegments(); i++) {
+		const Toolpath::Line& line = toolpath.segment(i);
+		boxes.push_back(cv::Rect2d(cv::Point2d(std::min(line.p0.x, line.p1.x), std::min(line.p0.y, line.p1.y)) - cv::Point2d(width / 2, width / 2),
+			cv::Point2d(std::max(line.p0.x, line.p1.x), std::max(line.p0.y, line.p1.y)) + cv::Point2d(width / 2, width / 2)));
+	}
+
+	// random points around the rods, as the edge points of a scan are
+	std::uniform_int_distribution<int> randSeg(0, toolpath.numSegments() - 1);
+	std::uniform_real_distribution<double> randT(0, 1), randOffset(-2 * maxDist, 2 * maxDist);
+	for (auto& pt : pts) {
+		const Toolpath::Line& line = toolpath.segment(randSeg(rng));
+		cv::Point2d d = line.p1 - line.p0;
+		pt = line.p0 + randT(rng) * d + randOffset(rng) * cv::Point2d(-d.y, d.x) / std::max(cv::norm(d), 1.0);
+	}
+
+	for (auto& pt : pts) {
+		t0 = std::chrono::steady_clock::now();
+		toolpath.index().query(pt, hits);
+		tQueryIndex += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+
+		t0 = std::chrono::steady_clock::now();
+		bruteHits.clear();
+		for (int i = 0; i < (int)boxes.size(); i++) {
+			if (boxes[i].contains(pt)) { bruteHits.push_back(i); }
+		}
+		tQueryBrute += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+		if (hits != bruteHits) { containMismatches++; }
+		numHits += hits.size();
+
+		t0 = std::chrono::steady_clock::now();
+		seg = toolpath.nearest(pt, maxDist, offset);
+		tNearestIndex += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+
+		t0 = std::chrono::steady_clock::now();
+		best = -1;
+		bestDist = maxDist;
+		for (int i = 0; i < toolpath.numSegments(); i++) {
+			d = Toolpath::lineDistance(pt, toolpath.segment(i), offset);
+			if (d < bestDist || (d == bestDist && best < 0)) {
+				bestDist = d;
+				best = i;
+			}
+		}
+		tNearestBrute += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+		if (seg != best) { nearestMismatches++; }
+		if (best >= 0) { numNear++; }
+	}
+
+	std::cout << "Segment index of a serpentine raster rotated by 30 deg with " << toolpath.numSegments() << " segments, "
+		<< numPts << " random points around the rods (" << numNear << " within " << maxDist << " px of a segment)" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "  build: " << tBuild << " ms" << std::endl;
+	std::cout << "              R-tree    brute force [us/point]" << std::endl;
+	std::cout << "  contains" << std::setw(10) << tQueryIndex / numPts << std::setw(15) << tQueryBrute / numPts << std::endl;
+	std::cout << "  nearest " << std::setw(10) << tNearestIndex / numPts << std::setw(15) << tNearestBrute / numPts << std::endl;
+	std::cout << std::defaultfloat;
+	std::cout << "  " << (double)numHits / numPts << " boxes contain each point on average" << std::endl;
+	if (containMismatches > 0) { std::cout << "  " << containMismatches << " points DO NOT have the same containing boxes." << std::endl; }
+	if (nearestMismatches > 0) { std::cout << "  " << nearestMismatches << " points DO NOT have the same nearest segment." << std::endl; }
+	return containMismatches == 0 && nearestMismatches == 0;
+}
+
+// rows of a path file along the line from a to b, spaced wayptSpc apart. b is not included
+static void appendPathRows(const cv::Point2d& a, const cv::Point2d& b, double wayptSpc, std::deque<std::vector<double>>& path) {
+	int n = (int)std::ceil(cv::norm(b - a) / wayptSpc);
+
+	for (int i = 0; i < n; i++) {
+		cv::Point2d pt = a + (b - a) * ((double)i / n);
+		path.push_back({ pt.x, pt.y, 0 });
+	}
+}
+
+bool verifyToolpathFromPath(int numRods, double wayptSpc) {
+	const double length = 20, spacing = 1.5, width = 1, travel = 10; // [mm]
+	const cv::Point2d origin(-5, -5);
+	std::deque<std::vector<double>> path;
+	cv::Point2d start, end, gap;
+	double offset, maxDist = 0, d;
+	int numBent = 0;
+	bool ok;
+
+	// two serpentine patches, the second one above the first, joined by a travel move from the end of the last rod of the first
+	for (int i = 0; i < 2 * numRods; i++) {
+		start = cv::Point2d((i % 2) ? length : 0, i * spacing + (i < numRods ? 0 : travel));
+		end = cv::Point2d((i % 2) ? 0 : length, start.y);
+		appendPathRows(start, end, wayptSpc, path);
+		if (i == numRods - 1) { gap = end + cv::Point2d(0, (spacing + travel) / 2); }
+		else if (i < 2 * numRods - 1) { appendPathRows(end, end + cv::Point2d(0, spacing), wayptSpc, path); }
+		else { path.push_back({ end.x, end.y, 0 }); }
+	}
+
+	Toolpath toolpath = Toolpath::fromPath(path, origin, width, wayptSpc);
+	for (auto& polyline : toolpath.polylines()) {
+		// every point of a polyline is on the line through its ends
+		cv::Point2d dir = polyline.back() - polyline.front();
+		for (auto& pt : polyline) {
+			d = std::abs(dir.cross(pt - polyline.front())) / cv::norm(dir);
+			if (d > 1e-6) {
+				numBent++;
+				break;
+			}
+		}
+	}
+	for (int i = 0; i < toolpath.numSegments(); i++) { maxDist = std::max(maxDist, cv::norm(toolpath.segment(i).p1 - toolpath.segment(i).p0)); }
+	// a point half way along the travel move
+	gap = (gap - origin) / resolution.mmPerPix();
+
+	ok = toolpath.polylines().size() == 2 * (2 * numRods - 1) && numBent == 0 && toolpath.nearest(gap, toolpath.width() / 2, offset) < 0;
+	std::cout << "Toolpath of a path file of two " << numRods << " rod patches joined by a " << travel << " mm travel move: "
+		<< path.size() << " rows, " << toolpath.polylines().size() << " polylines (" << 2 * (2 * numRods - 1) << " expected), "
+		<< toolpath.numSegments() << " lines, longest " << maxDist * resolution.mmPerPix() << " mm" << std::endl;
+	if (numBent > 0) { std::cout << "  " << numBent << " polylines ARE NOT straight." << std::endl; }
+	if (!ok) { std::cout << "  The toolpath DOES NOT split the path into its rods and connecting lines." << std::endl; }
+	return ok;
+}
+
+///////////////////////////////////////  Resolution  ///////////////////////////////////////
+
+bool benchResolution(int numValues) {
+	const double resolutions[] = { DefaultResolution::MM, 0.05 };
+	static_assert(DefaultResolution::toPix(0.5) == 25, "conversions of constants are done at compile time");
+	Resolution saved = resolution;
+	std::vector<double> lengths(numValues);
+	std::mt19937 gen(0);
+	std::uniform_real_distribution<double> uni(-50, 300);
+	std::chrono::steady_clock::time_point t0;
+	double tMacro, tRuntime, tFixed;
+	long long sumMacro, sumRuntime, sumFixed;
+	int mismatches = 0;
+
+	std::cout << "Conversion of " << numValues << " lengths from [mm] to [px]" << std::endl;
+	std::cout << "  res [mm]   lround(mm / res)   Resolution   FixedResolution [ns/value]" << std::endl;
+	for (double res : resolutions) {
+		resolution.set(res);
+		// half of the lengths are exactly half way between two pixels, where the rounding has to agree
+		for (int i = 0; i < numValues; i++) { lengths[i] = (i % 2) ? uni(gen) : (std::floor(uni(gen) / res) + 0.5) * res; }
+
+		sumMacro = sumRuntime = sumFixed = 0;
+		t0 = std::chrono::steady_clock::now();
+		for (double mm : lengths) { sumMacro += std::lround(mm / res); }
+		tMacro = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+		t0 = std::chrono::steady_clock::now();
+		for (double mm : lengths) { sumRuntime += resolution.toPix(mm); }
+		tRuntime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+		t0 = std::chrono::steady_clock::now();
+		for (double mm : lengths) { sumFixed += DefaultResolution::toPix(mm); }
+		tFixed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+
+		for (double mm : lengths) {
+			if (resolution.toPix(mm) != std::lround(mm / res)) { mismatches++; }
+		}
+		if (res == DefaultResolution::MM && sumFixed != sumMacro) { mismatches++; }
+		std::cout << std::fixed << std::setprecision(3) << "  " << std::setw(8) << res << std::setprecision(2) << std::setw(19) << tMacro / numValues
+			<< std::setw(13) << tRuntime / numValues;
+		// the fixed resolution only converts at the default scale
+		if (res == DefaultResolution::MM) { std::cout << std::setw(18) << tFixed / numValues; }
+		else { std::cout << std::setw(18) << "-"; }
+		std::cout << std::defaultfloat << std::endl;
+	}
+	resolution = saved;
+
+	if (mismatches > 0) { std::cout << "  " << mismatches << " lengths DO NOT round to the same pixel as std::lround." << std::endl; }
+	return mismatches == 0;
+}
+
+///////////////////////////////////////  Error distance transforms  ///////////////////////////////////////
+
+// getErrorsAt() as it was, with the edges drawn and transformed on the whole raster image
+static void getErrorsAt_reference(std::vector<cv::Point>& waypoints, std::vector<double> targetWidths, cv::Size rasterSize, const std::vector<cv::Point>& lEdgePts,
+	const std::vector<cv::Point>& rEdgePts, std::vector<double>& errCL, std::vector<double>& errWD) {
+	cv::Mat lEdge = cv::Mat(rasterSize, CV_8UC1, cv::Scalar(255));
+	cv::Mat rEdge = cv::Mat(rasterSize, CV_8UC1, cv::Scalar(255));
+	auto byX = [](const cv::Point& pt1, const cv::Point& pt2) { return pt1.x < pt2.x; };
+	auto byY = [](const cv::Point& pt1, const cv::Point& pt2) { return pt1.y < pt2.y; };
+	errCL.clear();
+	errWD.clear();
+
+	// rectangle with material on both sides of a rod along x
+	const auto Lval = std::minmax_element(lEdgePts.begin(), lEdgePts.end(), byX);
+	const auto Rval = std::minmax_element(rEdgePts.begin(), rEdgePts.end(), byX);
+	int minX = std::max((*Lval.first).x, (*Rval.first).x), maxX = std::min((*Lval.second).x, (*Rval.second).x);
+	int minY = (*std::min_element(lEdgePts.begin(), lEdgePts.end(), byY)).y, maxY = (*std::max_element(rEdgePts.begin(), rEdgePts.end(), byY)).y;
+	cv::Rect edgeRoi = cv::Rect(minX, minY, maxX - minX, maxY - minY);
+
+	cv::polylines(lEdge, lEdgePts, false, cv::Scalar(0), 1);
+	cv::polylines(rEdge, rEdgePts, false, cv::Scalar(0), 1);
+	cv::distanceTransform(lEdge, lEdge, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F);
+	cv::distanceTransform(rEdge, rEdge, cv::DIST_L2, cv::DIST_MASK_PRECISE, CV_32F);
+	for (size_t i = 0; i < waypoints.size(); i++) {
+		const cv::Point& pt = waypoints[i];
+		if (edgeRoi.contains(pt)) {
+			errCL.push_back((resolution.toMM(static_cast<__int64>(rEdge.at<float>(pt)) - static_cast<__int64>(lEdge.at<float>(pt)))) / 2);
+			errWD.push_back(targetWidths[i] - resolution.toMM(static_cast<__int64>(lEdge.at<float>(pt)) + static_cast<__int64>(rEdge.at<float>(pt))));
+		}
+		else {
+			errCL.push_back(NAN);
+			errWD.push_back(NAN);
+		}
+	}
+}
+
+// getErrorsAt() of the sub-pixel edges as it was, measuring the distance from each waypoint to every line of the edges of a rod along x
+static void getErrorsAt_bruteForce(const std::vector<cv::Point>& waypoints, std::vector<double> targetWidths, const std::vector<cv::Point2f>& lEdgePts,
+	const std::vector<cv::Point2f>& rEdgePts, std::vector<double>& errCL, std::vector<double>& errWD) {
+	auto byX = [](const cv::Point2f& pt1, const cv::Point2f& pt2) { return pt1.x < pt2.x; };
+	auto byY = [](const cv::Point2f& pt1, const cv::Point2f& pt2) { return pt1.y < pt2.y; };
+	auto distToCurve = [](const cv::Point2d& pt, const std::vector<cv::Point2f>& curve) {
+		double minDist = DBL_MAX, t, len2;
+		cv::Point2d a, ab;
+		for (size_t i = 1; i < curve.size(); i++) {
+			a = curve[i - 1];
+			ab = cv::Point2d(curve[i]) - a;
+			len2 = ab.dot(ab);
+			t = (len2 > 0) ? std::clamp((pt - a).dot(ab) / len2, 0.0, 1.0) : 0;
+			minDist = std::min(minDist, cv::norm(pt - (a + t * ab)));
+		}
+		return minDist;
+	};
+	double lDist, rDist;
+	errCL.clear();
+	errWD.clear();
+
+	const auto Lval = std::minmax_element(lEdgePts.begin(), lEdgePts.end(), byX);
+	const auto Rval = std::minmax_element(rEdgePts.begin(), rEdgePts.end(), byX);
+	double minX = std::max((*Lval.first).x, (*Rval.first).x), maxX = std::min((*Lval.second).x, (*Rval.second).x);
+	double minY = (*std::min_element(lEdgePts.begin(), lEdgePts.end(), byY)).y, maxY = (*std::max_element(rEdgePts.begin(), rEdgePts.end(), byY)).y;
+	cv::Rect2d edgeRoi = cv::Rect2d(minX, minY, maxX - minX, maxY - minY);
+	for (size_t i = 0; i < waypoints.size(); i++) {
+		if (edgeRoi.contains(waypoints[i])) {
+			lDist = distToCurve(waypoints[i], lEdgePts);
+			rDist = distToCurve(waypoints[i], rEdgePts);
+			errCL.push_back(resolution.toMM(rDist - lDist) / 2);
+			errWD.push_back(targetWidths[i] - resolution.toMM(lDist + rDist));
+		}
+		else {
+			errCL.push_back(NAN);
+			errWD.push_back(NAN);
+		}
+	}
+}
+
+// TRUE if the errors are within a tolerance of each other or both NAN
+static bool sameErrors(const std::vector<double>& a, const std::vector<double>& b, double tolerance = 0) {
+	if (a.size() != b.size()) { return false; }
+	for (size_t i = 0; i < a.size(); i++) {
+		if (!(std::abs(a[i] - b[i]) <= tolerance || (std::isnan(a[i]) && std::isnan(b[i])))) { return false; }
+	}
+	return true;
+}
+
+bool benchErrorsAt(int numSegments) {
+	const double segLengths[] = { 5, 10, 25, 50, 100 }; // [mm]
+	const double printSizes[] = { 10, 25, 50, 100, 200 }; // [mm]
+	const double segLength = 5, width = 0.8, wayptSpc = 0.5; // [mm]
+	std::mt19937 gen(0);
+	std::uniform_real_distribution<double> uni(0, 1);
+	std::vector<cv::Point> waypoints, lEdgePts, rEdgePts;
+	std::vector<cv::Point2f> lSubPix, rSubPix;
+	std::vector<double> targetWidths, errCL, errWD, refCL, refWD;
+	std::chrono::steady_clock::time_point t0;
+	double tFull, tCrop;
+	int mismatches = 0, subPixMismatches = 0;
+
+	// sub-pixel edges, as t_GetMatlErrors() measures them. The cost depends on the length of the segment and not the print
+	std::cout << "getErrorsAt() of sub-pixel edges on " << numSegments << " random segments of " << width << " mm rods" << std::endl;
+	std::cout << "  segment [mm]   edge points   every line [ms/segment]   indexed [ms/segment]" << std::endl;
+	for (double length : segLengths) {
+		int len = (int)resolution.toPix(length), halfWidth = (int)resolution.toPix(width / 2);
+		int spc = std::max(1, (int)resolution.toPix(wayptSpc));
+		tFull = tCrop = 0;
+
+		for (int k = 0; k < numSegments; k++) {
+			double phase = 2 * CV_PI * uni(gen);
+			lSubPix.clear();
+			rSubPix.clear();
+			waypoints.clear();
+			for (int x = 0; x < len; x++) {
+				double wobble = 2 * std::sin(phase + x / 15.0);
+				lSubPix.push_back(cv::Point2f((float)(x + 0.3 * uni(gen)), (float)(-halfWidth + wobble + 0.5 * uni(gen))));
+				rSubPix.push_back(cv::Point2f((float)(x + 0.3 * uni(gen)), (float)(halfWidth + wobble / 2 + 0.5 * uni(gen))));
+			}
+			for (int x = 0; x < len; x += spc) { waypoints.push_back(cv::Point(x, 0)); }
+			targetWidths.assign(waypoints.size(), width);
+
+			t0 = std::chrono::steady_clock::now();
+			getErrorsAt_bruteForce(waypoints, targetWidths, lSubPix, rSubPix, refCL, refWD);
+			tFull += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+			t0 = std::chrono::steady_clock::now();
+			getErrorsAt(waypoints, targetWidths, printDir::X_POS, lSubPix, rSubPix, errCL, errWD);
+			tCrop += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+			if (!sameErrors(errCL, refCL, 1e-9) || !sameErrors(errWD, refWD, 1e-9)) { subPixMismatches++; }
+		}
+		std::cout << std::fixed << std::setprecision(3) << "  " << std::setw(12) << length << std::setw(14) << 2 * len << std::setw(26) << tFull / numSegments
+			<< std::setw(23) << tCrop / numSegments << std::defaultfloat << std::endl;
+	}
+	if (subPixMismatches > 0) { std::cout << "  " << subPixMismatches << " segments DO NOT have the same errors with the indexed edges." << std::endl; }
+
+	// whole pixel edges drawn on the raster image, the path of getMatlErrors() and the cv::Point getErrorsAt()
+	std::cout << "getErrorsAt() of whole pixel edges on " << numSegments << " random " << segLength << " mm segments of " << width << " mm rods" << std::endl;
+	std::cout << "  print [mm]   image [px]   whole image [ms/segment]   cropped [ms/segment]" << std::endl;
+	for (double printSize : printSizes) {
+		int side = (int)resolution.toPix(printSize), len = (int)resolution.toPix(segLength), halfWidth = (int)resolution.toPix(width / 2);
+		int spc = std::max(1, (int)resolution.toPix(wayptSpc));
+		cv::Size rasterSize(side, side);
+		tFull = tCrop = 0;
+
+		for (int k = 0; k < numSegments; k++) {
+			// rod along x at a random place in the print, with wavy edges
+			cv::Point start((int)(uni(gen) * (side - len)), halfWidth + 2 + (int)(uni(gen) * (side - 2 * halfWidth - 4)));
+			double phase = 2 * CV_PI * uni(gen);
+			lEdgePts.clear();
+			rEdgePts.clear();
+			waypoints.clear();
+			for (int x = 0; x < len; x++) {
+				int wobble = (int)std::lround(2 * std::sin(phase + x / 15.0));
+				lEdgePts.push_back(start + cv::Point(x, -halfWidth + wobble));
+				rEdgePts.push_back(start + cv::Point(x, halfWidth + wobble / 2));
+			}
+			for (int x = 0; x < len; x += spc) { waypoints.push_back(start + cv::Point(x, 0)); }
+			targetWidths.assign(waypoints.size(), width);
+
+			t0 = std::chrono::steady_clock::now();
+			getErrorsAt_reference(waypoints, targetWidths, rasterSize, lEdgePts, rEdgePts, refCL, refWD);
+			tFull += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+			t0 = std::chrono::steady_clock::now();
+			getErrorsAt(waypoints, targetWidths, printDir::X_POS, rasterSize, lEdgePts, rEdgePts, errCL, errWD);
+			tCrop += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+			if (!sameErrors(errCL, refCL) || !sameErrors(errWD, refWD)) { mismatches++; }
+		}
+		std::cout << std::fixed << std::setprecision(3) << "  " << std::setw(10) << printSize << std::setw(13) << side << std::setw(27) << tFull / numSegments
+			<< std::setw(23) << tCrop / numSegments << std::defaultfloat << std::endl;
+	}
+	if (mismatches > 0) { std::cout << "  " << mismatches << " segments DO NOT have the same errors with the cropped transforms." << std::endl; }
+	return mismatches == 0 && subPixMismatches == 0;
+}
+
+///////////////////////////////////////  Scan scheduler  ///////////////////////////////////////
+
+// feed rate of the nearest waypoint on the segment being scanned and the next one, as ScanScheduler looked it up before
+static double feedRate_scannedSegment(const std::vector<std::vector<Path>>& path, int seg, const cv::Point2d& pos) {
+	double minDist = DBL_MAX, dist, feed = 0;
+
+	for (int i = seg; i < (int)path.size() && i <= seg + 1; i++) {
+		for (auto it = path[i].begin(); it != path[i].end(); ++it) {
+			dist = std::hypot((*it).x - pos.x, (*it).y - pos.y);
+			if (dist < minDist) {
+				minDist = dist;
+				feed = (*it).f;
+			}
+		}
+	}
+	return (minDist < 1.0) ? feed : 0;
+}
+
+bool benchScanScheduler(double length, double spacing) {
+	const double wayptSpc = 0.5; // [mm]
+	Raster raster(length, spacing, 0.9, 2);
+	std::vector<Segment> segs;
+	std::vector<std::vector<Path>> path;
+	std::chrono::steady_clock::time_point t0;
+	double tOld = 0, tNew = 0, feed;
+	int numPts = 0, foundOld = 0, foundNew = 0, mismatches = 0;
+
+	makePath(raster, wayptSpc, 0, cv::Point3d(0, 0, 0), 5, 0, segs, path);
+	for (int i = 0; i < (int)path.size(); i++) {
+		for (auto& wp : path[i]) { wp.f = 1 + i; }
+	}
+	ScanScheduler scheduler(path, 0.1);
+
+	for (int seg = 0; seg + 2 < (int)path.size(); seg++) {
+		scheduler.setSegment(seg);
+		for (auto& wp : path[seg + 2]) {
+			cv::Point2d pos(wp.x, wp.y);
+			numPts++;
+
+			t0 = std::chrono::steady_clock::now();
+			feed = feedRate_scannedSegment(path, seg, pos);
+			tOld += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+			if (feed > 0) { foundOld++; }
+
+			t0 = std::chrono::steady_clock::now();
+			scheduler.triggered(pos, t0, 0);
+			tNew += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+			if (scheduler.lastFeed() > 0) { foundNew++; }
+			if (scheduler.lastFeed() != wp.f) { mismatches++; }
+		}
+	}
+
+	std::cout << "Scan scheduler feed lookup on a " << length << " x " << length << " mm raster with " << spacing << " mm spacing, "
+		<< path.size() << " segments, " << numPts << " positions two segments ahead of the segment being scanned" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "  scanned + next segment:  " << tOld / numPts << " us/lookup, " << foundOld << " positions on the path" << std::endl;
+	std::cout << "  printed segment:         " << tNew / numPts << " us/lookup, " << foundNew << " positions on the path" << std::endl;
+	std::cout << std::defaultfloat;
+	if (mismatches > 0) { std::cout << "  " << mismatches << " positions DO NOT have the feed rate of their waypoint." << std::endl; }
+	return mismatches == 0;
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include <string>
+#include <atomic>
+
+#ifndef SCAN_BENCH_H
+#define SCAN_BENCH_H
+
+// Offline checks and timings of the scan processing on recorded scan logs (see scanLog.h)
+
+/**
+ * @brief Runs every profile in a scan log through the OpenCV version of getScan() and the 1D profile kernels
+ * and checks that each kernel and the final outputs match bit for bit. Both the AVX2 and scalar kernels are checked
+ * @param[in] logFile Name of the scan log
+ * @return TRUE if the kernels selected for this CPU match OpenCV on every profile
+*/
+bool verifyProfileKernels(std::string logFile);
+
+/**
+ * @brief Times getScan() on every profile in a scan log using OpenCV, the AVX2 kernels and the scalar kernels
+ * @param[in] logFile Name of the scan log
+ * @param[in] repeats Number of times each profile is processed
+*/
+void benchGetScan(std::string logFile, int repeats = 10);
+
+/**
+ * @brief Times scan2ROI() against the original per-sample implementation on random scans around a print ROI
+ * and checks that the outputs agree within one pixel
+ * @param[in] numScans Number of random scans
+ * @param[in] repeats Number of times each scan is processed
+ * @return TRUE if the outputs agree on every scan
+*/
+bool benchScan2ROI(int numScans = 10000, int repeats = 10);
+
+/**
+ * @brief Finds the edges in every profile of a scan log with the CV_64F and CV_32F scan processing
+ * and reports how far the CV_32F edges are from the CV_64F edges and the time taken by each
+ * @param[in] logFile Name of the scan log
+*/
+void compareScanDepth(std::string logFile);
+
+/**
+ * @brief Times the recursive Otsu thresholding of findEdges2() with the cv::threshold loop and with multiOtsu1D()
+ * on the scan ROIs of a scan log and checks that both give the same peak mask
+ * @param[in] logFile Name of the scan log
+ * @param[in] repeats Number of times each scan ROI is processed
+ * @return TRUE if the peak masks match on every scan ROI
+*/
+bool benchMultiOtsu(std::string logFile, int repeats = 100);
+
+/**
+ * @brief Times findEdges2() on synthetic scans across a square raster with the boundary mask redrawn and ANDed with the
+ * whole layer image for every scan, as it was, and with a cached mask that only the new edge pixels are checked against
+ * @param[in] length Length of the raster in [mm]
+ * @param[in] numScans Number of scans
+ * @return TRUE if both give the same edges
+*/
+bool benchEdgeWrites(double length = 100, int numScans = 2000);
+
+/**
+ * @brief Finds the search windows of findEdges() on random scans across a square raster by walking the boundary mask and from the rod
+ * geometry (see EdgeBoundary) and reports how often they agree and the time taken by each. The mask has round caps at the ends of the
+ * lines of the raster path, so the windows can differ near the corners
+ * @param[in] length Length of the raster in [mm]
+ * @param[in] numScans Number of scans, half of them across each orientation of the rods
+*/
+void compareRodWindows(double length = 100, int numScans = 20000);
+
+/**
+ * @brief Finds the edges of synthetic scans across a square raster with rods narrower than the boundary and debris between them, in the
+ * full edge boundary and in the boundary narrowed to the edges found on an earlier pass (see EdgeBoundary::setPrior()). Reports the
+ * samples in the search windows and the edges that are not at a rod edge with each boundary
+ * @param[in] length Length of the raster in [mm]
+ * @param[in] numScans Number of scans in each pass
+*/
+void comparePriorWindows(double length = 50, int numScans = 4000);
+
+/**
+ * @brief Reports the width error of the edges of synthetic rod profiles sampled at several raster resolutions, with the edges at
+ * the whole pixels just outside the threshold, as findEdges2() used to give them, and with the sub-pixel threshold crossings. Then the
+ * same for the extrema of the profile derivative that findEdges() finds, at the whole pixels and at the vertex of the parabola fit
+ * @param[in] numRods Number of rods at each resolution
+*/
+void reportSubPixelAccuracy(int numRods = 2000);
+
+/**
+ * @brief Sets the count of heap allocations read by compareEdgeDetectors(). The ScanBench executable counts them by replacing the
+ * global operator new. Without a counter the allocations are not reported
+*/
+void setAllocationCounter(const std::atomic<long long>* counter);
+
+/**
+ * @brief Runs every edge detector (see edgeDetector.h) on the profiles of a scan log and reports the per-scan latency percentiles,
+ * the heap allocations per scan and how well the edges agree with the edges of the reference detector. The log does not record
+ * the raster, so the edge boundary is made by dilating the parts of the scans that are above the substrate
+ * @param[in] logFile Name of the scan log
+ * @param[in] reference Detector the others are compared with, one of edgeMethod::method
+*/
+void compareEdgeDetectors(std::string logFile, int reference = 0);
+
+/**
+ * @brief Processes every profile of a scan log with the scan workers of t_CollectScans() (see scanWorkers.h) and reports how the
+ * throughput scales with the number of workers. The results are taken back in acquisition order and checked against the serial edges
+ * @param[in] logFile Name of the scan log
+ * @param[in] maxWorkers Largest number of workers. Values <= 0 use the number of hardware threads
+ * @param[in] repeats Number of times the log is processed
+ * @return TRUE if every worker count gives the same edges as the serial processing
+*/
+bool benchScanWorkers(std::string logFile, int maxWorkers = 0, int repeats = 5);
+
+/**
+ * @brief Writes the resampled profiles of a scan log into a HeightMap and reports the time per scan and per point and the memory used
+ * by the tiles compared with a dense map
+ * @param[in] logFile Name of the scan log
+*/
+void benchHeightMap(std::string logFile);
+
+/**
+ * @brief Times the median and Hampel prefilters (see profileFilter) on the scan ROIs of a scan log against a median that sorts each window,
+ * for several window radii. Then adds single sample dropout spikes to the ROIs and reports the edges each prefilter gives that are
+ * not near the edges of the clean ROIs without a prefilter
+ * @param[in] logFile Name of the scan log
+ * @param[in] spikeRate Fraction of the samples that are replaced by a spike
+ * @param[in] radius Half width of the prefilter window in [px] used for the edges
+*/
+void comparePrefilters(std::string logFile, double spikeRate = 0.005, int radius = 5);
+
+/**
+ * @brief Marks the edges of every rod and draws the raster path of several layers of a square raster on dense images and on TiledImages,
+ * and reports the time of each operation and the memory used by each. The tiled images are checked against the dense images.
+ * The tiles save memory where the rods are further apart than the tiles, so a tight infill allocates nearly every tile
+ * @param[in] length Length of the raster in [mm]
+ * @param[in] spacing Spacing between the rods in [mm]
+ * @param[in] numLayers Number of layers
+ * @return TRUE if the tiled images match the dense images
+*/
+bool benchTiledImage(double length = 100, double spacing = 4, int numLayers = 20);
+
+/**
+ * @brief Finds the boxes that contain random points around the rods and the nearest segment to them on a serpentine raster rotated by 30 degrees
+ * with the R-tree of a Toolpath (see SegmentIndex) and by testing every segment, and reports the time per point of each
+ * @param[in] numSegments Number of segments of the raster
+ * @param[in] numPts Number of random points
+ * @return TRUE if the R-tree gives the same boxes and nearest segments as testing every segment
+*/
+bool compareSegmentIndex(int numSegments = 20000, int numPts = 100000);
+
+/**
+ * @brief Makes the Toolpath of a path file of two serpentine patches joined by a travel move, with the rows of a path loaded by readPath(),
+ * and checks that each rod and connecting line is its own straight polyline and that the travel move is not part of the toolpath
+ * @param[in] numRods Number of rods of each patch
+ * @param[in] wayptSpc Spacing of the waypoints in [mm]
+ * @return TRUE if the toolpath has the rods and connecting lines of both patches and nothing else
+*/
+bool verifyToolpathFromPath(int numRods = 10, double wayptSpc = 0.5);
+
+/**
+ * @brief Converts random lengths and lengths half way between two pixels from [mm] to [px] with std::lround, as the MM2PIX macro did,
+ * with the runtime Resolution and with DefaultResolution, and reports the time per value of each at the default and a coarse resolution.
+ * The resolution of the job is restored afterwards
+ * @param[in] numValues Number of lengths at each resolution
+ * @return TRUE if the Resolution rounds every length to the same pixel as std::lround
+*/
+bool benchResolution(int numValues = 1000000);
+
+/**
+ * @brief Times getErrorsAt() on random segments of rods with wavy edges. The sub-pixel edges, which t_GetMatlErrors() uses, are timed for
+ * several segment lengths measuring every line of the edges, as they were, and through the index of the edges. The whole pixel edges are
+ * timed in square prints of several sizes with the distance transforms taken over the whole raster image, as they were, and over only the
+ * region around the edges. Each is checked against the way it was
+ * @param[in] numSegments Number of segments at each segment length and print size
+ * @return TRUE if both give the same errors as before on every segment
+*/
+bool benchErrorsAt(int numSegments = 50);
+
+/**
+ * @brief Looks up the planned feed rate of the ScanScheduler while each segment of a raster is being scanned and the gantry is printing
+ * the segment two ahead, as it is until the scanDonePt of a horizontal rod. The lookup is timed and counted on the segment being scanned
+ * and the next one, as it was, and on the segment the gantry is printing. Each segment is given its own feed rate to tell them apart
+ * @param[in] length Length of the raster in [mm]
+ * @param[in] spacing Spacing of the rods in [mm]
+ * @return TRUE if the scheduler finds the feed rate of the waypoint the gantry is on at every position
+*/
+bool benchScanScheduler(double length = 20, double spacing = 1.5);
+
+#endif // SCAN_BENCH_H
@@ -53,6 +53,7 @@ int main() {
 	// setting the print options
 	double leadin = 5;
 	PrintOptions printOpts(leadin);
+	ScanOptions scanOpts;
 
 	//Load the raster path generated in Matlab
 	double rodLen, rodSpc, rodWidth, wayptSpc;
@@ -108,7 +109,8 @@ int main() {
 	//t_CollectScans(raster);
 	//goto cleanup;
 
-	t_scan = std::thread{ t_CollectScans, raster };
+	scanOpts.recordFile = outDir + "scans.rlog";
+	t_scan = std::thread{ t_CollectScans, raster, path, scanOpts };
 	t_process = std::thread{ t_GetMatlErrors, raster, path };
 	t_control = std::thread{ t_noController, path };
 	t_print = std::thread{ t_printQueue, path[0][0], printOpts };